@@ -50,36 +50,589 @@
   2017-09-26   implemented segment and reverse features
   2017-11-16   changed speed calc, reduced memory footprint
   2018-02-24   added hooks for user created custom effects
+  2026-10-18   mode names in flash, streaming JSON mode catalog and state
+  2026-10-18   added pattern playlists, switched at a frame boundary without blackout
+  2026-10-18   separate render buffer, brightness/gamma/white balance applied in show()
+  2026-10-18   added power estimate and current limiter
+  2026-10-18   added matrix layouts with a precomputed index map and 2D modes
+  2026-10-18   added segment options: pixel groups, mirror and clone
+  2026-10-18   added layers: segments with their own buffer, blended on output
+  2026-10-18   added a per instance registry of custom modes with user context
+  2026-10-18   frames without changed pixels are not sent to the LEDs again
+  2026-10-18   added service(budget_us), which spreads a frame over several calls
+  2026-10-18   added shift(), running random moves its pixels with a single memmove
+  2026-10-18   added an opt-in cache for the frames of periodic modes
+  2026-10-18   no divisions left in the per pixel loops of the modes
+  2026-10-18   added mode flags, static frames are not rendered again
+  2026-10-18   added output channels: one engine driving strips on several pins
+  2026-10-18   added output drivers: NeoPixel, APA102, RAM, file and UDP (DDP)
+  2026-10-18   added StaticWS2812FX, sized at compile time and without heap use
+  2026-10-18   added setPixelBuffer(), resizing without allocation
+  2026-10-18   trigger() queues events for chosen segments, with intensity and latency stats
+  2026-10-18   added audio analysis (WS2812FXAudio) and the Spectrum, Beat Pulse and Bass Fire modes
+  2026-10-18   added palettes, expanded once into a lookup table, with crossfades spread over frames
+  2026-10-18   added gradient noise (WS2812FXNoise) and the Noise Lava, Noise Ocean and Noise Clouds modes
+  2026-10-18   added particles and the Multi Comet, Meteor Shower, Bouncing Balls and Fireworks Rockets modes
+  2026-10-18   added per segment mode memory and the Fire mode (heat diffusion)
 */
 
 #include "WS2812FX.h"
+#include "WS2812FXOutput.h"
+#include "WS2812FXAudio.h"
+#include "WS2812FXNoise.h"
+
+#if defined(ESP8266) || defined(ESP32)
+  #define TRIGGER_ATTR IRAM_ATTR // trigger() may be called by an interrupt handler
+#else
+  #define TRIGGER_ATTR
+#endif
+
+// trigger() claims its slot of the queue with interrupts off, so the loop and
+// interrupt handlers can call it at the same time. The previous state is
+// restored, interrupts stay off when called by an interrupt handler.
+#if defined(__AVR__)
+  #define TRIGGER_LOCK()   uint8_t trigger_sreg = SREG; cli()
+  #define TRIGGER_UNLOCK() SREG = trigger_sreg
+#elif defined(ESP8266)
+  #define TRIGGER_LOCK()   uint32_t trigger_ps = xt_rsil(15)
+  #define TRIGGER_UNLOCK() xt_wsr_ps(trigger_ps)
+#elif defined(ESP32)
+  static portMUX_TYPE trigger_mux = portMUX_INITIALIZER_UNLOCKED;
+  #define TRIGGER_LOCK()   portENTER_CRITICAL_SAFE(&trigger_mux)
+  #define TRIGGER_UNLOCK() portEXIT_CRITICAL_SAFE(&trigger_mux)
+#else
+  #define TRIGGER_LOCK()   noInterrupts()
+  #define TRIGGER_UNLOCK() interrupts()
+#endif
+
+/*
+ * Mode names and flags (see getModeFlags()), in mode number order. Every
+ * name is stored in flash exactly once and is shared by getModeName() and
+ * the JSON mode catalog, which is assembled by the compiler from the same list.
+ */
+#define FX_MODE_NAMES(X, LAST) \
+  X(FX_MODE_STATIC,                      "Static",                     FX_COLORS(1) | FX_STATIC) \
+  X(FX_MODE_BLINK,                       "Blink",                      FX_COLORS(2)) \
+  X(FX_MODE_BREATH,                      "Breath",                     FX_COLORS(1)) \
+  X(FX_MODE_COLOR_WIPE,                  "Color Wipe",                 FX_COLORS(2) | FX_SPARSE) \
+  X(FX_MODE_COLOR_WIPE_INV,              "Color Wipe Inverse",         FX_COLORS(2) | FX_SPARSE) \
+  X(FX_MODE_COLOR_WIPE_REV,              "Color Wipe Reverse",         FX_COLORS(2) | FX_SPARSE) \
+  X(FX_MODE_COLOR_WIPE_REV_INV,          "Color Wipe Reverse Inverse", FX_COLORS(2) | FX_SPARSE) \
+  X(FX_MODE_COLOR_WIPE_RANDOM,           "Color Wipe Random",          FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_RANDOM_COLOR,                "Random Color",               FX_RANDOM) \
+  X(FX_MODE_SINGLE_DYNAMIC,              "Single Dynamic",             FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_MULTI_DYNAMIC,               "Multi Dynamic",              FX_RANDOM) \
+  X(FX_MODE_RAINBOW,                     "Rainbow",                    0) \
+  X(FX_MODE_RAINBOW_CYCLE,               "Rainbow Cycle",              FX_PERIODIC) \
+  X(FX_MODE_SCAN,                        "Scan",                       FX_COLORS(1)) \
+  X(FX_MODE_DUAL_SCAN,                   "Dual Scan",                  FX_COLORS(1)) \
+  X(FX_MODE_FADE,                        "Fade",                       FX_COLORS(1)) \
+  X(FX_MODE_THEATER_CHASE,               "Theater Chase",              FX_COLORS(1) | FX_PERIODIC) \
+  X(FX_MODE_THEATER_CHASE_RAINBOW,       "Theater Chase Rainbow",      0) \
+  X(FX_MODE_RUNNING_LIGHTS,              "Running Lights",             FX_COLORS(1) | FX_PERIODIC) \
+  X(FX_MODE_TWINKLE,                     "Twinkle",                    FX_COLORS(1) | FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_TWINKLE_RANDOM,              "Twinkle Random",             FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_TWINKLE_FADE,                "Twinkle Fade",               FX_COLORS(1) | FX_READS_PIXELS | FX_RANDOM) \
+  X(FX_MODE_TWINKLE_FADE_RANDOM,         "Twinkle Fade Random",        FX_READS_PIXELS | FX_RANDOM) \
+  X(FX_MODE_SPARKLE,                     "Sparkle",                    FX_COLORS(1) | FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_FLASH_SPARKLE,               "Flash Sparkle",              FX_COLORS(1) | FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_HYPER_SPARKLE,               "Hyper Sparkle",              FX_COLORS(1) | FX_RANDOM) \
+  X(FX_MODE_STROBE,                      "Strobe",                     FX_COLORS(2)) \
+  X(FX_MODE_STROBE_RAINBOW,              "Strobe Rainbow",             FX_COLORS(2)) \
+  X(FX_MODE_MULTI_STROBE,                "Multi Strobe",               FX_COLORS(1)) \
+  X(FX_MODE_BLINK_RAINBOW,               "Blink Rainbow",              FX_COLORS(2)) \
+  X(FX_MODE_CHASE_WHITE,                 "Chase White",                FX_COLORS(1) | FX_SPARSE) \
+  X(FX_MODE_CHASE_COLOR,                 "Chase Color",                FX_COLORS(1) | FX_SPARSE) \
+  X(FX_MODE_CHASE_RANDOM,                "Chase Random",               FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_CHASE_RAINBOW,               "Chase Rainbow",              FX_SPARSE) \
+  X(FX_MODE_CHASE_FLASH,                 "Chase Flash",                FX_COLORS(1)) \
+  X(FX_MODE_CHASE_FLASH_RANDOM,          "Chase Flash Random",         FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_CHASE_RAINBOW_WHITE,         "Chase Rainbow White",        FX_SPARSE) \
+  X(FX_MODE_CHASE_BLACKOUT,              "Chase Blackout",             FX_COLORS(1) | FX_SPARSE) \
+  X(FX_MODE_CHASE_BLACKOUT_RAINBOW,      "Chase Blackout Rainbow",     FX_SPARSE) \
+  X(FX_MODE_COLOR_SWEEP_RANDOM,          "Color Sweep Random",         FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_RUNNING_COLOR,               "Running Color",              FX_COLORS(1) | FX_PERIODIC) \
+  X(FX_MODE_RUNNING_RED_BLUE,            "Running Red Blue",           FX_PERIODIC) \
+  X(FX_MODE_RUNNING_RANDOM,              "Running Random",             FX_READS_PIXELS | FX_RANDOM) \
+  X(FX_MODE_LARSON_SCANNER,              "Larson Scanner",             FX_COLORS(1) | FX_READS_PIXELS) \
+  X(FX_MODE_COMET,                       "Comet",                      FX_COLORS(1) | FX_READS_PIXELS) \
+  X(FX_MODE_FIREWORKS,                   "Fireworks",                  FX_COLORS(1) | FX_READS_PIXELS | FX_RANDOM) \
+  X(FX_MODE_FIREWORKS_RANDOM,            "Fireworks Random",           FX_READS_PIXELS | FX_RANDOM) \
+  X(FX_MODE_MERRY_CHRISTMAS,             "Merry Christmas",            FX_PERIODIC) \
+  X(FX_MODE_FIRE_FLICKER,                "Fire Flicker",               FX_COLORS(1) | FX_RANDOM) \
+  X(FX_MODE_FIRE_FLICKER_SOFT,           "Fire Flicker (soft)",        FX_COLORS(1) | FX_RANDOM) \
+  X(FX_MODE_FIRE_FLICKER_INTENSE,        "Fire Flicker (intense)",     FX_COLORS(1) | FX_RANDOM) \
+  X(FX_MODE_CIRCUS_COMBUSTUS,            "Circus Combustus",           FX_PERIODIC) \
+  X(FX_MODE_HALLOWEEN,                   "Halloween",                  FX_PERIODIC) \
+  X(FX_MODE_BICOLOR_CHASE,               "Bicolor Chase",              FX_COLORS(3) | FX_SPARSE) \
+  X(FX_MODE_TRICOLOR_CHASE,              "Tricolor Chase",             FX_COLORS(3) | FX_PERIODIC) \
+  X(FX_MODE_ICU,                         "ICU",                        FX_COLORS(1) | FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_CUSTOM,                      "Custom",                     FX_CUSTOM_FLAGS) \
+  X(FX_MODE_PLASMA_2D,                   "Plasma 2D",                  FX_MATRIX) \
+  X(FX_MODE_TEXT_2D,                     "Scrolling Text 2D",          FX_COLORS(2) | FX_MATRIX) \
+  X(FX_MODE_RAINBOW_2D,                  "Rainbow 2D",                 FX_MATRIX) \
+  X(FX_MODE_SPECTRUM,                    "Spectrum",                   0) \
+  X(FX_MODE_BEAT_PULSE,                  "Beat Pulse",                 FX_COLORS(1) | FX_READS_PIXELS) \
+  X(FX_MODE_BASS_FIRE,                   "Bass Fire",                  FX_COLORS(1) | FX_RANDOM) \
+  X(FX_MODE_NOISE_LAVA,                  "Noise Lava",                 0) \
+  X(FX_MODE_NOISE_OCEAN,                 "Noise Ocean",                0) \
+  X(FX_MODE_NOISE_CLOUDS,                "Noise Clouds",               0) \
+  X(FX_MODE_MULTI_COMET,                 "Multi Comet",                FX_COLORS(1) | FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_METEOR_SHOWER,               "Meteor Shower",              FX_SPARSE | FX_RANDOM) \
+  X(FX_MODE_BOUNCING_BALLS,              "Bouncing Balls",             FX_COLORS(3) | FX_SPARSE) \
+  X(FX_MODE_FIREWORKS_ROCKETS,           "Fireworks Rockets",          FX_SPARSE | FX_RANDOM) \
+  LAST(FX_MODE_FIRE,                     "Fire",                       FX_RANDOM)
+
+#define FX_NAME_DECLARE(m, name, flags)   static const char _name_##m[] PROGMEM = name;
+#define FX_NAME_POINTER(m, name, flags)   _name_##m,
+#define FX_NAME_JSON(m, name, flags)      "\"" name "\","
+#define FX_NAME_JSON_LAST(m, name, flags) "\"" name "\""
+#define FX_FLAGS(m, name, flags)          (flags),
+
+FX_MODE_NAMES(FX_NAME_DECLARE, FX_NAME_DECLARE)
+
+static const char* const _names[] PROGMEM = { // flash only, no SRAM footprint
+  FX_MODE_NAMES(FX_NAME_POINTER, FX_NAME_POINTER)
+};
+
+static_assert(sizeof(_names) / sizeof(_names[0]) == MODE_COUNT, "mode name list does not match MODE_COUNT");
+
+static const uint8_t _mode_flags[] PROGMEM = {
+  FX_MODE_NAMES(FX_FLAGS, FX_FLAGS)
+};
+
+static const char _modes_json[] PROGMEM = "[" FX_MODE_NAMES(FX_NAME_JSON, FX_NAME_JSON_LAST) "]";
+
+/*
+ * 5x7 font for the scrolling text, ASCII 32 to 126. Five columns per
+ * character, the lowest bit is the top row.
+ */
+static const uint8_t _font5x7[] PROGMEM = {
+  0x00, 0x00, 0x00, 0x00, 0x00, // space
+  0x00, 0x00, 0x5F, 0x00, 0x00, // !
+  0x00, 0x07, 0x00, 0x07, 0x00, // "
+  0x14, 0x7F, 0x14, 0x7F, 0x14, // #
+  0x24, 0x2A, 0x7F, 0x2A, 0x12, // $
+  0x23, 0x13, 0x08, 0x64, 0x62, // %
+  0x36, 0x49, 0x55, 0x22, 0x50, // &
+  0x00, 0x05, 0x03, 0x00, 0x00, // '
+  0x00, 0x1C, 0x22, 0x41, 0x00, // (
+  0x00, 0x41, 0x22, 0x1C, 0x00, // )
+  0x14, 0x08, 0x3E, 0x08, 0x14, // *
+  0x08, 0x08, 0x3E, 0x08, 0x08, // +
+  0x00, 0x50, 0x30, 0x00, 0x00, // ,
+  0x08, 0x08, 0x08, 0x08, 0x08, // -
+  0x00, 0x60, 0x60, 0x00, 0x00, // .
+  0x20, 0x10, 0x08, 0x04, 0x02, // /
+  0x3E, 0x51, 0x49, 0x45, 0x3E, // 0
+  0x00, 0x42, 0x7F, 0x40, 0x00, // 1
+  0x42, 0x61, 0x51, 0x49, 0x46, // 2
+  0x21, 0x41, 0x45, 0x4B, 0x31, // 3
+  0x18, 0x14, 0x12, 0x7F, 0x10, // 4
+  0x27, 0x45, 0x45, 0x45, 0x39, // 5
+  0x3C, 0x4A, 0x49, 0x49, 0x30, // 6
+  0x01, 0x71, 0x09, 0x05, 0x03, // 7
+  0x36, 0x49, 0x49, 0x49, 0x36, // 8
+  0x06, 0x49, 0x49, 0x29, 0x1E, // 9
+  0x00, 0x36, 0x36, 0x00, 0x00, // :
+  0x00, 0x56, 0x36, 0x00, 0x00, // ;
+  0x08, 0x14, 0x22, 0x41, 0x00, // <
+  0x14, 0x14, 0x14, 0x14, 0x14, // =
+  0x00, 0x41, 0x22, 0x14, 0x08, // >
+  0x02, 0x01, 0x51, 0x09, 0x06, // ?
+  0x32, 0x49, 0x79, 0x41, 0x3E, // @
+  0x7E, 0x11, 0x11, 0x11, 0x7E, // A
+  0x7F, 0x49, 0x49, 0x49, 0x36, // B
+  0x3E, 0x41, 0x41, 0x41, 0x22, // C
+  0x7F, 0x41, 0x41, 0x22, 0x1C, // D
+  0x7F, 0x49, 0x49, 0x49, 0x41, // E
+  0x7F, 0x09, 0x09, 0x09, 0x01, // F
+  0x3E, 0x41, 0x49, 0x49, 0x7A, // G
+  0x7F, 0x08, 0x08, 0x08, 0x7F, // H
+  0x00, 0x41, 0x7F, 0x41, 0x00, // I
+  0x20, 0x40, 0x41, 0x3F, 0x01, // J
+  0x7F, 0x08, 0x14, 0x22, 0x41, // K
+  0x7F, 0x40, 0x40, 0x40, 0x40, // L
+  0x7F, 0x02, 0x0C, 0x02, 0x7F, // M
+  0x7F, 0x04, 0x08, 0x10, 0x7F, // N
+  0x3E, 0x41, 0x41, 0x41, 0x3E, // O
+  0x7F, 0x09, 0x09, 0x09, 0x06, // P
+  0x3E, 0x41, 0x51, 0x21, 0x5E, // Q
+  0x7F, 0x09, 0x19, 0x29, 0x46, // R
+  0x46, 0x49, 0x49, 0x49, 0x31, // S
+  0x01, 0x01, 0x7F, 0x01, 0x01, // T
+  0x3F, 0x40, 0x40, 0x40, 0x3F, // U
+  0x1F, 0x20, 0x40, 0x20, 0x1F, // V
+  0x3F, 0x40, 0x38, 0x40, 0x3F, // W
+  0x63, 0x14, 0x08, 0x14, 0x63, // X
+  0x07, 0x08, 0x70, 0x08, 0x07, // Y
+  0x61, 0x51, 0x49, 0x45, 0x43, // Z
+  0x00, 0x7F, 0x41, 0x41, 0x00, // [
+  0x02, 0x04, 0x08, 0x10, 0x20, // backslash
+  0x00, 0x41, 0x41, 0x7F, 0x00, // ]
+  0x04, 0x02, 0x01, 0x02, 0x04, // ^
+  0x40, 0x40, 0x40, 0x40, 0x40, // _
+  0x00, 0x01, 0x02, 0x04, 0x00, // `
+  0x20, 0x54, 0x54, 0x54, 0x78, // a
+  0x7F, 0x48, 0x44, 0x44, 0x38, // b
+  0x38, 0x44, 0x44, 0x44, 0x20, // c
+  0x38, 0x44, 0x44, 0x48, 0x7F, // d
+  0x38, 0x54, 0x54, 0x54, 0x18, // e
+  0x08, 0x7E, 0x09, 0x01, 0x02, // f
+  0x0C, 0x52, 0x52, 0x52, 0x3E, // g
+  0x7F, 0x08, 0x04, 0x04, 0x78, // h
+  0x00, 0x44, 0x7D, 0x40, 0x00, // i
+  0x20, 0x40, 0x44, 0x3D, 0x00, // j
+  0x7F, 0x10, 0x28, 0x44, 0x00, // k
+  0x00, 0x41, 0x7F, 0x40, 0x00, // l
+  0x7C, 0x04, 0x18, 0x04, 0x78, // m
+  0x7C, 0x08, 0x04, 0x04, 0x78, // n
+  0x38, 0x44, 0x44, 0x44, 0x38, // o
+  0x7C, 0x14, 0x14, 0x14, 0x08, // p
+  0x08, 0x14, 0x14, 0x18, 0x7C, // q
+  0x7C, 0x08, 0x04, 0x04, 0x08, // r
+  0x48, 0x54, 0x54, 0x54, 0x20, // s
+  0x04, 0x3F, 0x44, 0x40, 0x20, // t
+  0x3C, 0x40, 0x40, 0x20, 0x7C, // u
+  0x1C, 0x20, 0x40, 0x20, 0x1C, // v
+  0x3C, 0x40, 0x30, 0x40, 0x3C, // w
+  0x44, 0x28, 0x10, 0x28, 0x44, // x
+  0x0C, 0x50, 0x50, 0x50, 0x3C, // y
+  0x44, 0x64, 0x54, 0x4C, 0x44, // z
+  0x00, 0x08, 0x36, 0x41, 0x00, // {
+  0x00, 0x00, 0x7F, 0x00, 0x00, // |
+  0x00, 0x41, 0x36, 0x08, 0x00, // }
+  0x08, 0x04, 0x08, 0x10, 0x08, // ~
+};
+
+/*
+ * A quarter sine wave, scaled to 0..127.
+ */
+static const uint8_t _sine_quarter[] PROGMEM = {
+    0,   3,   6,   9,  12,  16,  19,  22,  25,  28,  31,  34,  37,  40,  43,  46,
+   49,  51,  54,  57,  60,  63,  65,  68,  71,  73,  76,  78,  81,  83,  85,  88,
+   90,  92,  94,  96,  98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+  117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+  127
+};
+
+/*
+ * Storage supplied by the caller (see StaticWS2812FX): the NeoPixel buffer
+ * and the render buffer (n LEDs each) and the segment tables, with
+ * max_segments entries each. Nothing is allocated.
+ */
+WS2812FX::WS2812FX(uint16_t n, uint8_t p, neoPixelType t, uint8_t* buf, uint8_t* render, uint8_t max_segments,
+  segment* segments, segment_runtime* runtimes, layer* layers, frame_cache** caches, palette** palettes,
+  particle_pool** pools, segment_arena* arenas) : Adafruit_NeoPixel() {
+  updateType(t);
+  setPin(p);
+  pixels = buf;
+  numLEDs = n;
+  numBytes = n * ((wOffset == rOffset) ? 3 : 4);
+  _pixels = render;
+  _capacity = n;
+
+  _max_segments = max_segments;
+  _segment_table = _segments = segments;
+  _segment_runtimes = runtimes;
+  _layers = layers;
+  _caches = caches;
+  _palettes = palettes;
+  _pools = pools;
+  _arenas = arenas;
+  setup(n);
+}
+
+/*
+ * Mode table and default settings, shared by the constructors.
+ */
+void WS2812FX::setup(uint16_t n) {
+  _mode[FX_MODE_STATIC]                  = &WS2812FX::mode_static;
+  _mode[FX_MODE_BLINK]                   = &WS2812FX::mode_blink;
+  _mode[FX_MODE_COLOR_WIPE]              = &WS2812FX::mode_color_wipe;
+  _mode[FX_MODE_COLOR_WIPE_INV]          = &WS2812FX::mode_color_wipe_inv;
+  _mode[FX_MODE_COLOR_WIPE_REV]          = &WS2812FX::mode_color_wipe_rev;
+  _mode[FX_MODE_COLOR_WIPE_REV_INV]      = &WS2812FX::mode_color_wipe_rev_inv;
+  _mode[FX_MODE_COLOR_WIPE_RANDOM]       = &WS2812FX::mode_color_wipe_random;
+  _mode[FX_MODE_RANDOM_COLOR]            = &WS2812FX::mode_random_color;
+  _mode[FX_MODE_SINGLE_DYNAMIC]          = &WS2812FX::mode_single_dynamic;
+  _mode[FX_MODE_MULTI_DYNAMIC]           = &WS2812FX::mode_multi_dynamic;
+  _mode[FX_MODE_RAINBOW]                 = &WS2812FX::mode_rainbow;
+  _mode[FX_MODE_RAINBOW_CYCLE]           = &WS2812FX::mode_rainbow_cycle;
+  _mode[FX_MODE_SCAN]                    = &WS2812FX::mode_scan;
+  _mode[FX_MODE_DUAL_SCAN]               = &WS2812FX::mode_dual_scan;
+  _mode[FX_MODE_FADE]                    = &WS2812FX::mode_fade;
+  _mode[FX_MODE_THEATER_CHASE]           = &WS2812FX::mode_theater_chase;
+  _mode[FX_MODE_THEATER_CHASE_RAINBOW]   = &WS2812FX::mode_theater_chase_rainbow;
+  _mode[FX_MODE_TWINKLE]                 = &WS2812FX::mode_twinkle;
+  _mode[FX_MODE_TWINKLE_RANDOM]          = &WS2812FX::mode_twinkle_random;
+  _mode[FX_MODE_TWINKLE_FADE]            = &WS2812FX::mode_twinkle_fade;
+  _mode[FX_MODE_TWINKLE_FADE_RANDOM]     = &WS2812FX::mode_twinkle_fade_random;
+  _mode[FX_MODE_SPARKLE]                 = &WS2812FX::mode_sparkle;
+  _mode[FX_MODE_FLASH_SPARKLE]           = &WS2812FX::mode_flash_sparkle;
+  _mode[FX_MODE_HYPER_SPARKLE]           = &WS2812FX::mode_hyper_sparkle;
+  _mode[FX_MODE_STROBE]                  = &WS2812FX::mode_strobe;
+  _mode[FX_MODE_STROBE_RAINBOW]          = &WS2812FX::mode_strobe_rainbow;
+  _mode[FX_MODE_MULTI_STROBE]            = &WS2812FX::mode_multi_strobe;
+  _mode[FX_MODE_BLINK_RAINBOW]           = &WS2812FX::mode_blink_rainbow;
+  _mode[FX_MODE_CHASE_WHITE]             = &WS2812FX::mode_chase_white;
+  _mode[FX_MODE_CHASE_COLOR]             = &WS2812FX::mode_chase_color;
+  _mode[FX_MODE_CHASE_RANDOM]            = &WS2812FX::mode_chase_random;
+  _mode[FX_MODE_CHASE_RAINBOW]           = &WS2812FX::mode_chase_rainbow;
+  _mode[FX_MODE_CHASE_FLASH]             = &WS2812FX::mode_chase_flash;
+  _mode[FX_MODE_CHASE_FLASH_RANDOM]      = &WS2812FX::mode_chase_flash_random;
+  _mode[FX_MODE_CHASE_RAINBOW_WHITE]     = &WS2812FX::mode_chase_rainbow_white;
+  _mode[FX_MODE_CHASE_BLACKOUT]          = &WS2812FX::mode_chase_blackout;
+  _mode[FX_MODE_CHASE_BLACKOUT_RAINBOW]  = &WS2812FX::mode_chase_blackout_rainbow;
+  _mode[FX_MODE_COLOR_SWEEP_RANDOM]      = &WS2812FX::mode_color_sweep_random;
+  _mode[FX_MODE_RUNNING_COLOR]           = &WS2812FX::mode_running_color;
+  _mode[FX_MODE_RUNNING_RED_BLUE]        = &WS2812FX::mode_running_red_blue;
+  _mode[FX_MODE_RUNNING_RANDOM]          = &WS2812FX::mode_running_random;
+  _mode[FX_MODE_LARSON_SCANNER]          = &WS2812FX::mode_larson_scanner;
+  _mode[FX_MODE_COMET]                   = &WS2812FX::mode_comet;
+  _mode[FX_MODE_FIREWORKS]               = &WS2812FX::mode_fireworks;
+  _mode[FX_MODE_FIREWORKS_RANDOM]        = &WS2812FX::mode_fireworks_random;
+  _mode[FX_MODE_MERRY_CHRISTMAS]         = &WS2812FX::mode_merry_christmas;
+  _mode[FX_MODE_HALLOWEEN]               = &WS2812FX::mode_halloween;
+  _mode[FX_MODE_FIRE_FLICKER]            = &WS2812FX::mode_fire_flicker;
+  _mode[FX_MODE_FIRE_FLICKER_SOFT]       = &WS2812FX::mode_fire_flicker_soft;
+  _mode[FX_MODE_FIRE_FLICKER_INTENSE]    = &WS2812FX::mode_fire_flicker_intense;
+  _mode[FX_MODE_CIRCUS_COMBUSTUS]        = &WS2812FX::mode_circus_combustus;
+  _mode[FX_MODE_BICOLOR_CHASE]           = &WS2812FX::mode_bicolor_chase;
+  _mode[FX_MODE_TRICOLOR_CHASE]          = &WS2812FX::mode_tricolor_chase;
+// if flash memory is constrained (I'm looking at you Arduino Nano), replace modes
+// that use a lot of flash with mode_static (reduces flash footprint by about 3600 bytes)
+#ifdef REDUCED_MODES
+  _mode[FX_MODE_BREATH]                  = &WS2812FX::mode_static;
+  _mode[FX_MODE_RUNNING_LIGHTS]          = &WS2812FX::mode_static;
+  _mode[FX_MODE_ICU]                     = &WS2812FX::mode_static;
+  _mode[FX_MODE_PLASMA_2D]               = &WS2812FX::mode_static;
+  _mode[FX_MODE_TEXT_2D]                 = &WS2812FX::mode_static;
+  _mode[FX_MODE_RAINBOW_2D]              = &WS2812FX::mode_static;
+  _mode[FX_MODE_SPECTRUM]                = &WS2812FX::mode_static;
+  _mode[FX_MODE_BEAT_PULSE]              = &WS2812FX::mode_static;
+  _mode[FX_MODE_BASS_FIRE]               = &WS2812FX::mode_static;
+  _mode[FX_MODE_NOISE_LAVA]              = &WS2812FX::mode_static;
+  _mode[FX_MODE_NOISE_OCEAN]             = &WS2812FX::mode_static;
+  _mode[FX_MODE_NOISE_CLOUDS]            = &WS2812FX::mode_static;
+  _mode[FX_MODE_MULTI_COMET]             = &WS2812FX::mode_static;
+  _mode[FX_MODE_METEOR_SHOWER]           = &WS2812FX::mode_static;
+  _mode[FX_MODE_BOUNCING_BALLS]          = &WS2812FX::mode_static;
+  _mode[FX_MODE_FIREWORKS_ROCKETS]       = &WS2812FX::mode_static;
+  _mode[FX_MODE_FIRE]                    = &WS2812FX::mode_static;
+#else
+  _mode[FX_MODE_BREATH]                  = &WS2812FX::mode_breath;
+  _mode[FX_MODE_RUNNING_LIGHTS]          = &WS2812FX::mode_running_lights;
+  _mode[FX_MODE_ICU]                     = &WS2812FX::mode_icu;
+  _mode[FX_MODE_PLASMA_2D]               = &WS2812FX::mode_plasma_2d;
+  _mode[FX_MODE_TEXT_2D]                 = &WS2812FX::mode_text_2d;
+  _mode[FX_MODE_RAINBOW_2D]              = &WS2812FX::mode_rainbow_2d;
+  _mode[FX_MODE_SPECTRUM]                = &WS2812FX::mode_spectrum;
+  _mode[FX_MODE_BEAT_PULSE]              = &WS2812FX::mode_beat_pulse;
+  _mode[FX_MODE_BASS_FIRE]               = &WS2812FX::mode_bass_fire;
+  _mode[FX_MODE_NOISE_LAVA]              = &WS2812FX::mode_noise_lava;
+  _mode[FX_MODE_NOISE_OCEAN]             = &WS2812FX::mode_noise_ocean;
+  _mode[FX_MODE_NOISE_CLOUDS]            = &WS2812FX::mode_noise_clouds;
+  _mode[FX_MODE_MULTI_COMET]             = &WS2812FX::mode_multi_comet;
+  _mode[FX_MODE_METEOR_SHOWER]           = &WS2812FX::mode_meteor_shower;
+  _mode[FX_MODE_BOUNCING_BALLS]          = &WS2812FX::mode_bouncing_balls;
+  _mode[FX_MODE_FIREWORKS_ROCKETS]       = &WS2812FX::mode_fireworks_rockets;
+  _mode[FX_MODE_FIRE]                    = &WS2812FX::mode_fire;
+#endif
+  _mode[FX_MODE_CUSTOM]                  = &WS2812FX::mode_custom;
+
+  _brightness = DEFAULT_BRIGHTNESS;
+  _running = false;
+  _num_segments = 1;
+  if(_max_segments == 0) { // out of memory
+    _num_segments = 0;
+    return;
+  }
+  _segments[0].mode = DEFAULT_MODE;
+  _segments[0].colors[0] = DEFAULT_COLOR;
+  _segments[0].start = 0;
+  _segments[0].stop = n - 1;
+  _segments[0].speed = DEFAULT_SPEED;
+  RESET_RUNTIME;
+}
+
+/*
+ * Allocates the segment tables of the runtime sized WS2812FX in one block of
+ * MAX_NUM_SEGMENTS entries. If that fails, there are no segments at all
+ * (getMaxSegments() returns 0). The tables are ordered by alignment
+ * (pointers first), so every one of them starts aligned.
+ */
+void WS2812FX::alloc_segments(void) {
+  size_t size = sizeof(layer) + sizeof(frame_cache*) + sizeof(palette*) + sizeof(particle_pool*) + sizeof(segment_arena) + sizeof(segment_runtime) + sizeof(segment);
+  uint8_t n = MAX_NUM_SEGMENTS;
+  uint8_t *p = (uint8_t*)calloc(n, size);
+  if(p == NULL) return; // out of memory, _max_segments stays 0
+
+  _max_segments = n;
+  _own_segments = true;
+  _layers = (layer*)p;
+  _caches = (frame_cache**)(p += n * sizeof(layer));
+  _palettes = (palette**)(p += n * sizeof(frame_cache*));
+  _pools = (particle_pool**)(p += n * sizeof(palette*));
+  _arenas = (segment_arena*)(p += n * sizeof(particle_pool*));
+  _segment_runtimes = (segment_runtime*)(p += n * sizeof(segment_arena));
+  _segment_table = _segments = (segment*)(p += n * sizeof(segment_runtime));
+}
+
+WS2812FX::~WS2812FX() {
+  free(_lut);
+  free(_matrix_map);
+  free(_pattern_segments);
+  for(uint8_t i=0; i < _max_segments; i++) {
+    free(_layers[i].pixels);
+    setFrameCache(i, 0);
+    free(_palettes[i]);
+    free(_pools[i]);
+    free(_arenas[i].data);
+  }
+  if(_own_segments) free(_layers); // the start of the block
+  if(_capacity > 0) {
+    pixels = NULL; // not ours, keep Adafruit_NeoPixel from freeing it
+  } else {
+    free(_pixels);
+  }
+}
 
 void WS2812FX::init() {
   RESET_RUNTIME;
   Adafruit_NeoPixel::begin();
   setBrightness(_brightness);
-  Adafruit_NeoPixel::show();
+  show();
 }
 
-void WS2812FX::service() {
-  if(_running || _triggered) {
+/*
+ * Renders the segments which are due and sends the frame to the LEDs.
+ * With a budget (in us), rendering stops once the budget is used up and
+ * continues with the next segment on the next call. The frame is sent when
+ * all segments are done (by the next call, if the budget is used up by
+ * then), so e.g. a web server gets to run in between. At least one segment
+ * is rendered per call, the budget is not a hard limit.
+ */
+void WS2812FX::service(uint16_t budget_us) {
+  if(_running || _trigger_head != _trigger_tail || _service_segment > 0) {
+    unsigned long start = micros();
     unsigned long now = millis(); // Be aware, millis() rolls over every 49 days
-    bool doShow = false;
-    for(uint8_t i=0; i < _num_segments; i++) {
+    if(_service_segment == 0 || _service_segment > _num_segments) {
+      _service_segment = 0;
+      _service_show = false;
+      _service_time = now;
+      if(_drawn) { // the sketch drew over the LEDs, static segments draw theirs again
+        for(uint8_t i=0; i < _num_segments; i++) {
+          if(getModeFlags(_segments[i].mode) & FX_STATIC) _segment_runtimes[i].counter_mode_call = 0;
+        }
+        _drawn = false;
+      }
+      if(_limit_changed) { // the current limiter changed the brightness, send the frame again
+        _service_show = true;
+        _limit_changed = false;
+      }
+      if(_audio != NULL) _audio->analyze(); // once for all segments
+      process_triggers();
+      if(_playlist_len > 0) {
+        uint32_t duration = _playlist[_pattern_index].duration * 1000UL;
+        if(_pattern_switch || (duration > 0 && now - _pattern_time >= duration)) {
+          load_pattern((_pattern_index + 1) % _playlist_len, now);
+        }
+      }
+    }
+    now = _service_time; // segments of a frame stay in step, even if it takes several calls
+    uint8_t first = _service_segment;
+    for(uint8_t i=first; i <= _num_segments; i++) {
+      if(budget_us > 0 && i > first && micros() - start >= budget_us) {
+        _service_segment = i; // out of time, continue here next time
+        service_time(start);
+        return;
+      }
+      if(i == _num_segments) break; // all rendered, send the frame
       _segment_index = i;
-      if(now > SEGMENT_RUNTIME.next_time || _triggered) {
-        doShow = true;
-        uint16_t delay = (this->*_mode[SEGMENT.mode])();
+      if(SEGMENT_CLONE(SEGMENT)) continue; // nothing to render, show() copies the source
+      // a stopped strip only renders what was triggered, the others stay as they are
+      if(SEGMENT_RUNTIME.trigger > 0 || (_running && now > SEGMENT_RUNTIME.next_time)) {
+        bool is_static = getModeFlags(SEGMENT.mode) & FX_STATIC;
+        uint32_t signature = is_static ? segment_signature() : 0;
+        if(is_static && SEGMENT_RUNTIME.counter_mode_call > 0 && SEGMENT_RUNTIME.counter_mode_step == signature) {
+          SEGMENT_RUNTIME.trigger = 0;
+          if(_changed) _service_show = true; // e.g. gamma changed, send the frame anyway
+          continue; // nothing changed, the frame drawn last time is still there
+        }
+        _service_show = true;
+        if(_palettes[i] != NULL && _palettes[i]->fade_step > 0) palette_fade(i);
+        // grouped or mirrored segments render fewer pixels, show() expands them
+        uint16_t stop = SEGMENT.stop;
+        SEGMENT.stop = SEGMENT.start + segment_logical_length(SEGMENT) - 1;
+        if(_layers[i].blend != BLEND_NONE && _layers[i].pixels != NULL) {
+          _target = _layers[i].pixels; // the mode draws into the layer
+          _target_start = SEGMENT.start;
+          _target_len = _layers[i].len;
+        }
+        _arenas[i].used = 0; // the mode takes its state in the same order as last frame
+        _rendering = true;
+        uint16_t delay = (SEGMENT.mode < MODE_COUNT) ? (this->*_mode[SEGMENT.mode])() : run_custom_mode();
+        _rendering = false;
+        _target = NULL;
+        SEGMENT.stop = stop;
+        SEGMENT_RUNTIME.trigger = 0;
+        if(is_static) SEGMENT_RUNTIME.counter_mode_step = signature;
         SEGMENT_RUNTIME.next_time = now + max((int)delay, SPEED_MIN);
         SEGMENT_RUNTIME.counter_mode_call++;
       }
     }
-    if(doShow) {
-      delay(1); // for ESP32 (see https://forums.adafruit.com/viewtopic.php?f=47&t=117327)
-      Adafruit_NeoPixel::show();
+    _service_segment = 0;
+    if(_service_show) {
+      if(_changed && !outputs_ready()) {
+        _service_segment = _num_segments; // an output is still busy, send the frame next time
+        service_time(start);
+        return;
+      }
+      _stats.frames++;
+      if(_changed) {
+#if defined(ESP32)
+        delay(1); // see https://forums.adafruit.com/viewtopic.php?f=47&t=117327
+#endif
+        show();
+      } else {
+        trigger_latency();
+        _stats.shows_saved++; // same frame as last time, the LEDs show it already
+      }
+    } else {
+      trigger_latency();
+    }
+    if(_playlist_len > 0 && _staged_pattern == 0xFF) { // the frame is out, copy the next pattern now
+      stage_pattern((_pattern_index + 1) % _playlist_len);
+    }
+    service_time(start);
+  }
+}
+
+/*
+ * A hash of the settings of the current segment, everything the frame of
+ * an FX_STATIC mode depends on, apart from pixels drawn by anyone but the
+ * modes (see _drawn).
+ */
+uint32_t WS2812FX::segment_signature(void) {
+  uint32_t words[] = {SEGMENT.colors[0], SEGMENT.colors[1], SEGMENT.colors[2],
+    ((uint32_t)SEGMENT.start << 16) | SEGMENT.stop,
+    ((uint32_t)SEGMENT.mode << 24) | ((uint32_t)SEGMENT.options << 16) | ((uint32_t)SEGMENT.reverse << 8)};
+  uint32_t h = 2166136261UL; // FNV-1a
+  for(uint8_t i=0; i < sizeof(words) / sizeof(words[0]); i++) {
+    for(uint8_t b=0; b < 32; b += 8) {
+      h = (h ^ (uint8_t)(words[i] >> b)) * 16777619UL;
     }
-    _triggered = false;
   }
+  return h;
+}
+
+/*
+ * Keeps track of the longest service() call.
+ */
+void WS2812FX::service_time(unsigned long start) {
+  uint32_t t = micros() - start;
+  if(t > _stats.max_service_us) _stats.max_service_us = t;
 }
 
 void WS2812FX::start() {
@@ -89,16 +642,70 @@ void WS2812FX::start() {
 
 void WS2812FX::stop() {
   _running = false;
+  _service_segment = 0;
   strip_off();
 }
 
-void WS2812FX::trigger() {
-  _triggered = true;
+/*
+ * Makes the segments in the mask (bit n = segment n, bit 31 = segment 31 and
+ * up) render with the next frame, even if they aren't due yet or the
+ * strip isn't running (then only they are rendered). Modes which react to it (e.g. Fireworks Random) can
+ * tell the intensity (0 counts as 1). Safe to call from the loop and from
+ * interrupt handlers, up to TRIGGER_QUEUE_SIZE - 1 events per frame.
+ */
+void TRIGGER_ATTR WS2812FX::trigger(uint32_t segments, uint8_t intensity) {
+  uint32_t time = micros();
+  TRIGGER_LOCK();
+  uint8_t head = _trigger_head;
+  uint8_t next = (head + 1) % TRIGGER_QUEUE_SIZE;
+  if(next == _trigger_tail) {
+    _stats.triggers_dropped++;
+  } else {
+    _trigger_queue[head].segments = segments;
+    _trigger_queue[head].intensity = max(intensity, (uint8_t)1);
+    _trigger_queue[head].time = time;
+    _trigger_head = next;
+  }
+  TRIGGER_UNLOCK();
+}
+
+/*
+ * Hands the queued trigger events to their segments, at the start of a frame.
+ */
+void WS2812FX::process_triggers(void) {
+  while(_trigger_tail != _trigger_head) {
+    uint32_t segments = _trigger_queue[_trigger_tail].segments;
+    uint8_t intensity = _trigger_queue[_trigger_tail].intensity;
+    for(uint8_t i=0; i < _num_segments; i++) {
+      if(SEGMENT_CLONE(_segments[i]) == 0 && (segments & (1UL << min(i, (uint8_t)31)))) {
+        _segment_runtimes[i].trigger = max(_segment_runtimes[i].trigger, intensity);
+      }
+    }
+    if(!_trigger_frame) { // the oldest one counts
+      _trigger_frame = true;
+      _trigger_time = _trigger_queue[_trigger_tail].time;
+    }
+    _stats.triggers++;
+    _trigger_tail = (_trigger_tail + 1) % TRIGGER_QUEUE_SIZE;
+  }
+}
+
+/*
+ * Keeps track of the time from a trigger to the frame answering it, taken
+ * right before it's sent (or found to be unchanged).
+ */
+void WS2812FX::trigger_latency(void) {
+  if(!_trigger_frame) return;
+  _trigger_frame = false;
+  _stats.trigger_latency_us = micros() - _trigger_time;
+  if(_stats.trigger_latency_us > _stats.max_trigger_latency_us) {
+    _stats.max_trigger_latency_us = _stats.trigger_latency_us;
+  }
 }
 
 void WS2812FX::setMode(uint8_t m) {
   RESET_RUNTIME;
-  _segments[0].mode = constrain(m, 0, MODE_COUNT - 1);
+  _segments[0].mode = constrain(m, 0, getModeCount() - 1);
   setBrightness(_brightness);
 }
 
@@ -129,8 +736,8 @@ void WS2812FX::setColor(uint32_t c) {
 
 void WS2812FX::setBrightness(uint8_t b) {
   _brightness = constrain(b, BRIGHTNESS_MIN, BRIGHTNESS_MAX);
-  Adafruit_NeoPixel::setBrightness(_brightness);
-  Adafruit_NeoPixel::show();
+  _lut_dirty = true;
+  show();
   delay(1);
 }
 
@@ -144,18 +751,87 @@ void WS2812FX::decreaseBrightness(uint8_t s) {
   setBrightness(s);
 }
 
+/*
+ * Resizes the strip. With a buffer supplied by setPixelBuffer() nothing is
+ * allocated, the length is limited to its capacity and LEDs cut off are
+ * switched off with the next frame. Otherwise the buffers are allocated
+ * anew, if they don't fit, the strip is made as long as memory allows.
+ */
 void WS2812FX::setLength(uint16_t b) {
   RESET_RUNTIME;
   if (b < 1) b = 1;
 
-  // Decrease numLEDs to maximum available memory
-  do {
-      Adafruit_NeoPixel::updateLength(b);
-      b--;
-  } while(!Adafruit_NeoPixel::numLEDs && b > 1);
+  if(_capacity > 0) {
+    uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+    b = min(b, _capacity);
+    if(b < numLEDs) {
+      _blank_len = max(_blank_len, numLEDs);
+    } else {
+      memset(_pixels + numBytes, 0, (b - numLEDs) * bpp); // the LEDs added start dark
+    }
+    Adafruit_NeoPixel::numLEDs = b;
+    Adafruit_NeoPixel::numBytes = b * bpp;
+    _changed = true;
+  } else if(!alloc_length(b)) {
+    // binary search for the longest strip which fits, a few attempts instead of one per LED
+    uint16_t fits = 0, fails = b;
+    while(fails - fits > 1) {
+      uint16_t n = fits + (fails - fits) / 2;
+      if(alloc_length(n)) fits = n; else fails = n;
+    }
+    if(fits > 0 && Adafruit_NeoPixel::numLEDs != fits) alloc_length(fits);
+  }
 
   _segments[0].start = 0;
-  _segments[0].stop = Adafruit_NeoPixel::numLEDs - 1;
+  _segments[0].stop = (Adafruit_NeoPixel::numLEDs > 0) ? Adafruit_NeoPixel::numLEDs - 1 : 0;
+}
+
+/*
+ * Tries to allocate the buffers for n LEDs, false (and a length of zero), if
+ * they don't fit. The render buffer is freed first, to make room.
+ */
+bool WS2812FX::alloc_length(uint16_t n) {
+  free(_pixels);
+  _pixels = NULL;
+  Adafruit_NeoPixel::updateLength(n);
+  return Adafruit_NeoPixel::numLEDs > 0 && alloc_pixels();
+}
+
+/*
+ * Makes the strip keep its pixels in buf (bytes long), instead of allocating
+ * them: the NeoPixel buffer and the render buffer, 6 bytes per LED (8 with
+ * RGBW). Returns the capacity in LEDs, setLength() never allocates and can't
+ * go beyond it. The strip is shortened, if it's longer, and its first
+ * segment set up like setLength() does. NULL (or a buffer too small for a
+ * single LED) goes back to allocated buffers.
+ */
+uint16_t WS2812FX::setPixelBuffer(uint8_t* buf, uint16_t bytes) {
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  uint16_t n = Adafruit_NeoPixel::numLEDs;
+  if(_capacity == 0) {
+    free(pixels);
+    free(_pixels);
+  }
+  pixels = _pixels = NULL;
+  Adafruit_NeoPixel::numLEDs = Adafruit_NeoPixel::numBytes = 0;
+  _blank_len = 0;
+
+  _capacity = (buf != NULL) ? bytes / (2 * bpp) : 0;
+  if(_capacity > 0) {
+    memset(buf, 0, _capacity * 2 * bpp);
+    pixels = buf;
+    _pixels = buf + _capacity * bpp;
+  }
+  setLength(n);
+  return _capacity;
+}
+
+/*
+ * The most LEDs the buffer supplied by setPixelBuffer() (or StaticWS2812FX)
+ * holds, 0 if the buffers are allocated.
+ */
+uint16_t WS2812FX::getCapacity(void) {
+  return _capacity;
 }
 
 void WS2812FX::increaseLength(uint16_t s) {
@@ -163,14 +839,20 @@ void WS2812FX::increaseLength(uint16_t s) {
   setLength(s);
 }
 
+/*
+ * Shortens the strip, the LEDs cut off are switched off. Allocated buffers
+ * shrink right away, so they are sent once more before, dark.
+ */
 void WS2812FX::decreaseLength(uint16_t s) {
   if (s > _segments[0].stop - _segments[0].start + 1) s = 1;
   s = _segments[0].stop - _segments[0].start + 1 - s;
 
-  for(uint16_t i=_segments[0].start + s; i <= (_segments[0].stop - _segments[0].start + 1); i++) {
-    Adafruit_NeoPixel::setPixelColor(i, 0);
+  if(_capacity == 0) {
+    for(uint16_t i=_segments[0].start + s; i <= (_segments[0].stop - _segments[0].start + 1); i++) {
+      setPixelColor(i, 0);
+    }
+    show();
   }
-  Adafruit_NeoPixel::show();
 
   setLength(s);
 }
@@ -196,66 +878,1483 @@ uint16_t WS2812FX::getLength(void) {
 }
 
 uint8_t WS2812FX::getModeCount(void) {
-  return MODE_COUNT;
+  return MODE_COUNT + _num_custom_modes;
 }
 
 uint8_t WS2812FX::getNumSegments(void) {
   return _num_segments;
 }
 
+/*
+ * How many segments there is room for: MAX_NUM_SEGMENTS (or the SEGMENTS
+ * of StaticWS2812FX), 0 if the segment tables couldn't be allocated.
+ */
+uint8_t WS2812FX::getMaxSegments(void) {
+  return _max_segments;
+}
+
 void WS2812FX::setNumSegments(uint8_t n) {
-  _num_segments = n;
+  _num_segments = min(n, _max_segments);
+}
+
+uint32_t WS2812FX::getColor(void) {
+  return _segments[0].colors[0];
+}
+
+WS2812FX::segment* WS2812FX::getSegments(void) {
+  return _segments;
+}
+
+/*
+ * What mode m does with the segment it runs on, a combination of the FX_
+ * flags: how many colors it uses, whether it reads the last frame or only
+ * draws some pixels, whether it's random, static, periodic or 2D. Unknown
+ * modes report FX_CUSTOM_FLAGS, which promise nothing.
+ */
+uint8_t WS2812FX::getModeFlags(uint8_t m) {
+  if(m < MODE_COUNT) {
+    return pgm_read_byte(&_mode_flags[m]);
+  } else if(m < getModeCount()) {
+    return _custom_modes[m - MODE_COUNT].flags;
+  } else {
+    return FX_CUSTOM_FLAGS;
+  }
+}
+
+const __FlashStringHelper* WS2812FX::getModeName(uint8_t m) {
+  if(m < MODE_COUNT) {
+    return (const __FlashStringHelper*)pgm_read_ptr(&_names[m]);
+  } else if(m < getModeCount()) {
+    return _custom_modes[m - MODE_COUNT].name;
+  } else {
+    return F("");
+  }
+}
+
+/*
+ * The catalog of the built-in modes as a JSON array of names, e.g. ["Static","Blink",...].
+ * It lives in flash, so it can be sent as is (e.g. with server.send_P()).
+ * printModesJSON() adds the modes added with addCustomMode().
+ */
+const __FlashStringHelper* WS2812FX::getModesJSON(void) {
+  return (const __FlashStringHelper*)_modes_json;
+}
+
+void WS2812FX::setSegment(uint8_t n, uint16_t start, uint16_t stop, uint8_t mode, uint32_t color, uint16_t speed, bool reverse) {
+  if(n < _max_segments) {
+    if(n + 1 > _num_segments) _num_segments = n + 1;
+    _segments[n].start = start;
+    _segments[n].stop = stop;
+    _segments[n].mode = mode;
+    _segments[n].speed = speed;
+    _segments[n].reverse = reverse;
+    _segments[n].colors[0] = color;
+    if(_layers[n].blend != BLEND_NONE) prepare_layer(n); // the layer fits the segment
+  }
+}
+
+void WS2812FX::setSegment(uint8_t n, uint16_t start, uint16_t stop, uint8_t mode, const uint32_t colors[], uint16_t speed, bool reverse) {
+  if(n < _max_segments) {
+    if(n + 1 > _num_segments) _num_segments = n + 1;
+    _segments[n].start = start;
+    _segments[n].stop = stop;
+    _segments[n].mode = mode;
+    _segments[n].speed = speed;
+    _segments[n].reverse = reverse;
+
+    for(uint8_t i=0; i<NUM_COLORS; i++) {
+      _segments[n].colors[i] = colors[i];
+    }
+    if(_layers[n].blend != BLEND_NONE) prepare_layer(n);
+  }
+}
+
+void WS2812FX::resetSegments() {
+  memset(_segments, 0, sizeof(segment) * _max_segments);
+  RESET_RUNTIME;
+  _segment_index = 0;
+  _num_segments = 1;
+  setSegment(0, 0, 7, FX_MODE_STATIC, DEFAULT_COLOR, DEFAULT_SPEED, false);
+}
+
+/*
+ * Plays a list of patterns, each one for its duration (0 = until nextPattern()
+ * is called). The pattern being played is copied into a segment table of its
+ * own, which setSegment() and getSegments() work on while it plays, so the
+ * patterns themselves are left alone. The next pattern is copied into a
+ * second table once the current one has started, so switching is only a
+ * matter of swapping the tables. Edits to a pattern show the next time it
+ * is played, or with the switch after that if it is the next one already.
+ * Pass NULL to stop the playlist and return to the regular segments. False
+ * if there isn't enough memory for the tables.
+ */
+bool WS2812FX::setPlaylist(pattern* patterns, uint8_t n) {
+  if(patterns != NULL && n > 0 && _pattern_segments == NULL) {
+    if(_max_segments > 0) _pattern_segments = (segment*)malloc(2 * _max_segments * sizeof(segment));
+    if(_pattern_segments == NULL) return false; // the regular segments keep playing
+  }
+  if(_segments == _segment_table) _table_num_segments = _num_segments;
+  _playlist = patterns;
+  _playlist_len = (patterns == NULL) ? 0 : n;
+  _pattern_switch = false;
+  _staged_pattern = 0xFF;
+  if(_playlist_len > 0) {
+    load_pattern(0, millis());
+  } else {
+    free(_pattern_segments);
+    _pattern_segments = NULL;
+    _segments = _segment_table;
+    _num_segments = _table_num_segments;
+    RESET_RUNTIME;
+  }
+  return true;
+}
+
+/*
+ * Switches to the next pattern of the playlist with the next frame. The next
+ * pattern is copied again, so edits made to it until now show.
+ */
+void WS2812FX::nextPattern(void) {
+  _pattern_switch = true;
+  if(_playlist_len > 0) stage_pattern((_pattern_index + 1) % _playlist_len);
+}
+
+uint8_t WS2812FX::getPatternIndex(void) {
+  return _pattern_index;
+}
+
+/*
+ * Makes a pattern the active one, by swapping in the table it was staged in
+ * (if it wasn't, it is copied now). Only the pixels the new modes don't draw
+ * over are cleared and nothing is sent, so when called from service() the
+ * new pattern is rendered into the same frame and there is no black frame in
+ * between.
+ */
+void WS2812FX::load_pattern(uint8_t n, unsigned long now) {
+  if(_staged_pattern != n) stage_pattern(n);
+  _segments = (_segments == _pattern_segments) ? _pattern_segments + _max_segments : _pattern_segments;
+  _staged_pattern = 0xFF;
+  _pattern_index = n;
+  _pattern_switch = false;
+  _pattern_time = now;
+  _num_segments = _staged_num_segments;
+  _brightness = _staged_brightness;
+  _lut_dirty = true;
+  _changed = true;
+  RESET_RUNTIME;
+  clear_kept_pixels();
+}
+
+/*
+ * Copies a pattern into the table not playing. service() calls it after the
+ * frame is sent, so the copy isn't made at the frame boundary.
+ */
+void WS2812FX::stage_pattern(uint8_t n) {
+  segment* table = (_segments == _pattern_segments) ? _pattern_segments + _max_segments : _pattern_segments;
+  memcpy(table, _playlist[n].segments, _max_segments * sizeof(segment));
+  _staged_num_segments = constrain(_playlist[n].numSegments, 1, _max_segments);
+  _staged_brightness = _playlist[n].brightness;
+  _staged_pattern = n;
+}
+
+/*
+ * Clears the pixels the first frame of the active segments won't draw over:
+ * the LEDs outside of all segments, those of clones and layers, and those of
+ * segments whose mode keeps pixels from frame to frame (FX_SPARSE,
+ * FX_READS_PIXELS). The rest is drawn anyway, so it isn't cleared first.
+ */
+void WS2812FX::clear_kept_pixels(void) {
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  uint16_t covered[2 * MAX_NUM_SEGMENTS]; // start and end (exclusive) of the segments drawn over
+  uint8_t num_covered = 0;
+  for(uint8_t i=0; i < _num_segments; i++) {
+    bool drawn = !(getModeFlags(_segments[i].mode) & (FX_SPARSE | FX_READS_PIXELS));
+    if(_layers[i].pixels != NULL && !drawn) memset(_layers[i].pixels, 0, _layers[i].len * bpp);
+    if(drawn && _layers[i].blend == BLEND_NONE && SEGMENT_CLONE(_segments[i]) == 0 &&
+      _segments[i].start < numLEDs && _segments[i].start <= _segments[i].stop) {
+      uint8_t j = num_covered; // insertion sort by start, there are only a few
+      for(; j > 0 && covered[2 * (j - 1)] > _segments[i].start; j--) {
+        covered[2 * j] = covered[2 * (j - 1)];
+        covered[2 * j + 1] = covered[2 * (j - 1) + 1];
+      }
+      covered[2 * j] = _segments[i].start;
+      covered[2 * j + 1] = min(_segments[i].stop + 1, (int)numLEDs);
+      num_covered++;
+    }
+  }
+  uint16_t from = 0;
+  for(uint8_t j=0; j < num_covered; j++) {
+    if(covered[2 * j] > from) memset(_pixels + from * bpp, 0, (covered[2 * j] - from) * bpp);
+    from = max(from, covered[2 * j + 1]);
+  }
+  if(numLEDs > from) memset(_pixels + from * bpp, 0, (numLEDs - from) * bpp);
+}
+
+/*
+ * Sets the options of a segment: groups of LEDs (1 to 8) showing the same
+ * color, mirroring (the second half reflects the first) and cloning (the
+ * segment shows what another segment shows, clone = NO_CLONE turns it off).
+ * The mode of a grouped or mirrored segment only renders the unique pixels,
+ * a cloned segment isn't rendered at all. The rest is copied by show().
+ */
+void WS2812FX::setSegmentOptions(uint8_t n, uint8_t group, bool mirror, uint8_t clone) {
+  if(n < _max_segments) {
+    uint8_t options = constrain(group, 1, 8) - 1;
+    if(mirror) options |= SEGMENT_OPTION_MIRROR;
+    if(clone < _max_segments && clone != n) options |= (clone + 1) << 4;
+    _segments[n].options = options;
+    if(_layers[n].blend != BLEND_NONE) prepare_layer(n);
+    _changed = true;
+    RESET_RUNTIME;
+  }
+}
+
+/*
+ * The number of pixels a segment's mode renders.
+ */
+uint16_t WS2812FX::segment_logical_length(segment& seg) {
+  uint16_t len = seg.stop - seg.start + 1;
+  if(SEGMENT_MIRROR(seg)) len = (len + 1) / 2;
+  uint8_t group = SEGMENT_GROUP(seg);
+  return (len + group - 1) / group;
+}
+
+static inline void copy_pixel(uint8_t *to, const uint8_t *from, uint8_t bpp) {
+  to[0] = from[0];
+  to[1] = from[1];
+  to[2] = from[2];
+  if(bpp == 4) to[3] = from[3];
+}
+
+/*
+ * Copies a pixel like copy_pixel() and returns by how much that changed
+ * the sum of the buffer.
+ */
+static inline int16_t copy_pixel_sum(uint8_t *to, const uint8_t *from, uint8_t bpp) {
+  int16_t d = from[0] + from[1] + from[2] - to[0] - to[1] - to[2];
+  if(bpp == 4) d += from[3] - to[3];
+  copy_pixel(to, from, bpp);
+  return d;
+}
+
+/*
+ * Expands grouped and mirrored segments in the output buffer, then fills in
+ * cloned segments. If summing, returns by how much that changed the sum of
+ * the output, so it doesn't have to be summed up again.
+ */
+int32_t WS2812FX::expand_segments(bool summing) {
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  int32_t delta = 0;
+
+  for(uint8_t i=0; i < _num_segments; i++) {
+    segment& seg = _segments[i];
+    if(seg.options == 0 || SEGMENT_CLONE(seg) || seg.stop >= numLEDs) continue;
+
+    // work from the end towards the start: every pixel is copied from one
+    // before it, which has not been overwritten yet
+    uint8_t *base = pixels + seg.start * bpp;
+    uint16_t len = seg.stop - seg.start + 1;
+    uint8_t group = SEGMENT_GROUP(seg);
+    uint16_t half = len;
+    if(SEGMENT_MIRROR(seg)) {
+      half = (len + 1) / 2;
+      uint16_t l = 0;
+      uint8_t k = 0;
+      for(uint16_t p=len - 1; p >= half; p--) {
+        if(summing) delta += copy_pixel_sum(base + p * bpp, base + l * bpp, bpp);
+        else copy_pixel(base + p * bpp, base + l * bpp, bpp);
+        if(++k == group) {
+          k = 0;
+          l++;
+        }
+      }
+    }
+    if(group > 1) {
+      uint16_t l = (half - 1) / group;
+      uint8_t k = (half - 1) % group;
+      for(uint16_t p=half - 1; p > 0; p--) {
+        if(summing) delta += copy_pixel_sum(base + p * bpp, base + l * bpp, bpp);
+        else copy_pixel(base + p * bpp, base + l * bpp, bpp);
+        if(k-- == 0) {
+          k = group - 1;
+          l--;
+        }
+      }
+    }
+  }
+
+  for(uint8_t i=0; i < _num_segments; i++) {
+    segment& seg = _segments[i];
+    if(SEGMENT_CLONE(seg) == 0 || seg.stop >= numLEDs) continue;
+    segment& source = _segments[SEGMENT_CLONE(seg) - 1];
+    if(SEGMENT_CLONE(source) || source.stop >= numLEDs) continue;
+
+    uint8_t *base = pixels + seg.start * bpp;
+    uint8_t *from = pixels + source.start * bpp;
+    uint16_t len = seg.stop - seg.start + 1;
+    uint16_t n = min(len, source.stop - source.start + 1);
+    if(seg.reverse) {
+      uint16_t q = n - 1;
+      for(uint16_t p=0; p < len; p++) {
+        if(summing) delta += copy_pixel_sum(base + p * bpp, from + q * bpp, bpp);
+        else copy_pixel(base + p * bpp, from + q * bpp, bpp);
+        q = (q == 0) ? n - 1 : q - 1;
+      }
+    } else {
+      for(uint16_t p=0; p < len; p += n) { // a longer clone repeats the source
+        uint16_t bytes = min(n, len - p) * bpp;
+        if(summing) {
+          for(uint16_t i=0; i < bytes; i++) delta += from[i] - base[p * bpp + i];
+        }
+        memmove(base + p * bpp, from, bytes);
+      }
+    }
+  }
+  return delta;
+}
+
+/*
+ * Turns segment n into a layer: its mode draws into a buffer of its own,
+ * which is blended over everything below it (the regular segments and the
+ * layers with a lower index) with the given blend mode and opacity, when the
+ * LEDs are updated. Layers may overlap other segments. BLEND_NONE turns the
+ * layer back into a regular segment. The buffer is allocated here (and
+ * resized by setSegment() and setSegmentOptions()), never while rendering.
+ * False if there isn't enough memory, the segment stays as it was.
+ */
+bool WS2812FX::setSegmentLayer(uint8_t n, uint8_t blend, uint8_t opacity) {
+  if(n >= _max_segments) return false;
+  if(blend == BLEND_NONE) {
+    free(_layers[n].pixels);
+    _layers[n].pixels = NULL;
+    _layers[n].len = 0;
+  } else if(!prepare_layer(n)) {
+    return false;
+  }
+  if((blend == BLEND_NONE) != (_layers[n].blend == BLEND_NONE)) {
+    // what was drawn so far is in the wrong buffer, modes which draw every
+    // pixel of every frame get over that by themselves, the others start over
+    for(uint8_t i=0; i < _max_segments; i++) {
+      if(getModeFlags(_segments[i].mode) & (FX_READS_PIXELS | FX_SPARSE | FX_STATIC)) {
+        memset(&_segment_runtimes[i], 0, sizeof(_segment_runtimes[i]));
+      }
+    }
+  }
+  _layers[n].blend = blend;
+  _layers[n].opacity = opacity;
+  _changed = true;
+  return true;
+}
+
+/*
+ * Makes sure the layer buffer of segment n fits the pixels its mode renders,
+ * a new buffer starts out black.
+ */
+bool WS2812FX::prepare_layer(uint8_t n) {
+  uint16_t len = segment_logical_length(_segments[n]);
+  if(_layers[n].pixels != NULL && _layers[n].len == len) return true;
+
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  free(_layers[n].pixels);
+  _layers[n].len = 0;
+  if((_layers[n].pixels = (uint8_t*)malloc(len * bpp)) == NULL) return false;
+  memset(_layers[n].pixels, 0, len * bpp);
+  _layers[n].len = len;
+  return true;
+}
+
+/*
+ * Moves the pixels of segment n by k positions, towards its end (k > 0) or
+ * start (k < 0), the k pixels moved away from keep their colors. A scrolling
+ * effect moves everything and only sets the pixels coming in. The render
+ * buffer holds the colors as they are, so it's a single memmove.
+ */
+void WS2812FX::shift(uint8_t n, int16_t k) {
+  if(n >= _num_segments || k == 0) return;
+  segment& seg = _segments[n];
+
+  // while its mode runs, the segment is already cut down to what it renders
+  uint16_t len = (_rendering && n == _segment_index) ? seg.stop - seg.start + 1 : segment_logical_length(seg);
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  uint8_t *p;
+  if(_layers[n].blend != BLEND_NONE && _layers[n].pixels != NULL) {
+    p = _layers[n].pixels;
+    len = min(len, _layers[n].len);
+  } else {
+    if(seg.start >= numLEDs) return;
+    p = _pixels + seg.start * bpp;
+    len = min(len, numLEDs - seg.start);
+  }
+
+  uint16_t m = abs(k);
+  if(m >= len) return;
+  if(k > 0) {
+    memmove(p + m * bpp, p, (len - m) * bpp);
+  } else {
+    memmove(p, p + m * bpp, (len - m) * bpp);
+  }
+  _changed = true;
+  if(!_rendering) _drawn = true;
+}
+
+bool WS2812FX::layer_visible(uint8_t n) {
+  return _layers[n].pixels != NULL && _layers[n].blend != BLEND_NONE && _layers[n].opacity > 0 &&
+    SEGMENT_CLONE(_segments[n]) == 0;
+}
+
+/*
+ * Where the pixels of the segment being rendered start and how many of
+ * them fit (len), NULL if none.
+ */
+uint8_t* WS2812FX::segment_pixels(uint16_t& len) {
+  uint8_t *p = pixel_address(SEGMENT.start);
+  len = SEGMENT_LENGTH;
+  if(_target != NULL) len = min(len, _target_len);
+  else len = min(len, numLEDs - SEGMENT.start);
+  return p;
+}
+
+/*
+ * Gives segment n a cache for the frames of modes which repeat after a few
+ * steps (Running *, Theater Chase, Tricolor Chase, Circus Combustus, Running
+ * Lights, Rainbow Cycle). Once all frames of the period were rendered, the
+ * mode only copies them. bytes is the most the cached frames may take, modes
+ * with more frames than that are rendered as usual. 0 frees the cache.
+ */
+void WS2812FX::setFrameCache(uint8_t n, uint16_t bytes) {
+  if(n >= _max_segments) return;
+  if(_caches[n] != NULL) {
+    free(_caches[n]->frames);
+    free(_caches[n]);
+    _caches[n] = NULL;
+  }
+  if(bytes == 0 || (_caches[n] = (frame_cache*)malloc(sizeof(frame_cache))) == NULL) return;
+  memset(_caches[n], 0, sizeof(frame_cache));
+  _caches[n]->budget = bytes;
+  _caches[n]->mode = 0xFF; // nothing cached yet
+}
+
+/*
+ * The cache of the segment being rendered, if it has one and the frames of
+ * the mode fit: period frames, or with rotate a single one, which the others
+ * are rotations of. The frames are dropped when the mode, colors, length or
+ * direction of the segment changed.
+ */
+WS2812FX::frame_cache* WS2812FX::segment_cache(uint16_t period, int8_t rotate) {
+  frame_cache* fc = _caches[_segment_index];
+  if(fc == NULL || (!rotate && period > 8 * sizeof(fc->valid))) return NULL;
+  if(!(getModeFlags(SEGMENT.mode) & FX_PERIODIC)) return NULL; // e.g. a custom mode running the same code
+  if(_palettes[_segment_index] != NULL && _palettes[_segment_index]->fade_step > 0) return NULL; // no two frames alike
+
+  uint16_t len;
+  if(segment_pixels(len) == NULL || len != SEGMENT_LENGTH) return NULL;
+  uint32_t size = (uint32_t)len * ((wOffset == rOffset) ? 3 : 4) * (rotate ? 1 : period);
+  if(size > fc->budget) return NULL;
+
+  if(fc->mode != SEGMENT.mode || fc->len != len || fc->reverse != SEGMENT.reverse ||
+    memcmp(fc->colors, SEGMENT.colors, sizeof(fc->colors)) != 0) {
+    if(fc->size != size) {
+      free(fc->frames);
+      fc->frames = (uint8_t*)malloc(size);
+      fc->size = (fc->frames != NULL) ? size : 0;
+    }
+    fc->mode = 0xFF;
+    if(fc->frames == NULL) return NULL;
+    memset(fc->valid, 0, sizeof(fc->valid));
+    fc->mode = SEGMENT.mode;
+    fc->len = len;
+    fc->reverse = SEGMENT.reverse;
+    memcpy(fc->colors, SEGMENT.colors, sizeof(fc->colors));
+  }
+  return fc;
+}
+
+// the colors of the palettes, PALETTE_RAINBOW and up
+static const uint32_t _palette_colors[PALETTE_COUNT - 1][PALETTE_STOPS] PROGMEM = {
+  {0xFF0000, 0xD52A00, 0xAB5500, 0xAB7F00, 0xABAB00, 0x56D500, 0x00FF00, 0x00D52A, // rainbow
+   0x00AB55, 0x0056AA, 0x0000FF, 0x2A00D5, 0x5500AB, 0x7F0081, 0xAB0055, 0xD5002B},
+  {0x5500AB, 0x84007C, 0xB5004B, 0xE5001B, 0xE81700, 0xB84700, 0xAB7700, 0xABAB00, // party
+   0xAB5500, 0xDD2200, 0xF2000E, 0xC2003E, 0x8F0071, 0x5F00A1, 0x2F00D0, 0x0007F9},
+  {0x191970, 0x00008B, 0x191970, 0x000080, 0x00008B, 0x0000CD, 0x2E8B57, 0x008080, // ocean
+   0x5F9EA0, 0x0000FF, 0x008B8B, 0x6495ED, 0x7FFFD4, 0x2E8B57, 0x00FFFF, 0x87CEFA},
+  {0x006400, 0x006400, 0x556B2F, 0x006400, 0x008000, 0x228B22, 0x6B8E23, 0x008000, // forest
+   0x2E8B57, 0x66CDAA, 0x32CD32, 0x9ACD32, 0x90EE90, 0x7CFC00, 0x66CDAA, 0x228B22},
+  {0x000000, 0x800000, 0x000000, 0x800000, 0x8B0000, 0x800000, 0x8B0000, 0x8B0000, // lava
+   0x8B0000, 0xFF0000, 0xFFA500, 0xFFFFFF, 0xFFA500, 0xFF0000, 0x8B0000, 0x000000},
+  {0x000000, 0x330000, 0x660000, 0x990000, 0xCC0000, 0xFF0000, 0xFF3300, 0xFF6600, // heat
+   0xFF9900, 0xFFCC00, 0xFFFF00, 0xFFFF33, 0xFFFF66, 0xFFFF99, 0xFFFFCC, 0xFFFFFF},
+  {0x0000FF, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, 0x00008B, // cloud
+   0x0000FF, 0x00008B, 0x87CEEB, 0x87CEEB, 0xADD8E6, 0xFFFFFF, 0xADD8E6, 0x87CEEB}
+};
+
+/*
+ * Color a, k / 17 of the way to color b.
+ */
+static void palette_blend(uint32_t a, uint32_t b, uint8_t k, uint8_t* rgb) {
+  for(uint8_t c=0, shift=16; c < 3; c++, shift -= 8) {
+    int16_t ca = (a >> shift) & 0xFF, cb = (b >> shift) & 0xFF;
+    rgb[c] = ca + (cb - ca) * k / 17;
+  }
+}
+
+/*
+ * Entry i of a palette: color i / 17 blended towards the next one, so the
+ * first color is entry 0 and the last entry 255.
+ */
+static void palette_entry(const uint32_t* colors, uint8_t i, uint8_t* rgb) {
+  uint8_t j = i / 17;
+  palette_blend(colors[j], colors[min(j + 1, PALETTE_STOPS - 1)], i - j * 17, rgb);
+}
+
+/*
+ * The colors of palette id, PALETTE_NONE being the color wheel (it's linear
+ * between every 17th entry, so 16 colors make it exactly).
+ */
+void WS2812FX::palette_colors(uint8_t id, uint32_t* colors) {
+  for(uint8_t i=0; i < PALETTE_STOPS; i++) {
+    colors[i] = (id == PALETTE_NONE) ? color_wheel(i * 17) : pgm_read_dword(&_palette_colors[id - 1][i]);
+  }
+}
+
+/*
+ * Makes segment n use palette id instead of the color wheel, in the modes
+ * which take their colors from it (rainbows, random colors, ...). The 16
+ * colors are expanded into a table of 256 once, the modes look them up.
+ * The table takes about 850 bytes, PALETTE_NONE frees it. False if there
+ * isn't enough memory.
+ */
+bool WS2812FX::setPalette(uint8_t n, uint8_t id) {
+  if(n >= _max_segments || id >= PALETTE_COUNT) return false;
+  if(id == PALETTE_NONE) {
+    free(_palettes[n]);
+    _palettes[n] = NULL;
+    if(_caches[n] != NULL) _caches[n]->mode = 0xFF; // rendered with other colors
+    return true;
+  }
+  uint32_t colors[PALETTE_STOPS];
+  palette_colors(id, colors);
+  return setCustomPalette(n, colors);
+}
+
+/*
+ * A palette of 16 colors of your own, they're copied.
+ */
+bool WS2812FX::setCustomPalette(uint8_t n, const uint32_t* colors) {
+  if(!palette_start(n, colors, 0)) return false;
+  for(uint16_t i=0; i < 256; i++) {
+    palette_entry(colors, i, _palettes[n]->colors[i]);
+  }
+  return true;
+}
+
+/*
+ * Crossfades the palette of segment n to palette id. Every frame the segment
+ * renders, PALETTE_FADE_ENTRIES entries move up to step towards the new
+ * colors, so the table isn't redone all at once.
+ */
+bool WS2812FX::fadeToPalette(uint8_t n, uint8_t id, uint8_t step) {
+  if(id >= PALETTE_COUNT) return false;
+  uint32_t colors[PALETTE_STOPS];
+  palette_colors(id, colors);
+  if(!fadeToCustomPalette(n, colors, step)) return false;
+  _palettes[n]->fade_free = (id == PALETTE_NONE);
+  return true;
+}
+
+bool WS2812FX::fadeToCustomPalette(uint8_t n, const uint32_t* colors, uint8_t step) {
+  if(n < _max_segments && _palettes[n] == NULL) { // fading from the color wheel
+    uint32_t wheel[PALETTE_STOPS];
+    palette_colors(PALETTE_NONE, wheel);
+    if(!setCustomPalette(n, wheel)) return false;
+  }
+  return palette_start(n, colors, max(step, (uint8_t)1));
+}
+
+/*
+ * Allocates the palette of segment n, if it has none, and sets its target
+ * colors. The frame cache is dropped, its frames have the old colors.
+ */
+bool WS2812FX::palette_start(uint8_t n, const uint32_t* colors, uint8_t step) {
+  if(n >= _max_segments) return false;
+  if(_palettes[n] == NULL && (_palettes[n] = (palette*)malloc(sizeof(palette))) == NULL) return false;
+  palette* p = _palettes[n];
+  memcpy(p->target, colors, sizeof(p->target));
+  p->fade_step = step;
+  p->fade_pos = 0;
+  p->fade_moved = false;
+  p->fade_free = false;
+  if(_caches[n] != NULL) _caches[n]->mode = 0xFF;
+  return true;
+}
+
+/*
+ * Moves the next PALETTE_FADE_ENTRIES entries of the palette of segment n
+ * towards the target colors. The fade is done after a pass over all
+ * entries in which none moved.
+ */
+void WS2812FX::palette_fade(uint8_t n) {
+  palette* p = _palettes[n];
+  uint8_t step = p->fade_step;
+  uint8_t i = p->fade_pos;
+  for(uint8_t k=0; k < PALETTE_FADE_ENTRIES; k++, i++) {
+    uint8_t target[3];
+    palette_entry(p->target, i, target);
+    for(uint8_t c=0; c < 3; c++) {
+      int16_t d = target[c] - p->colors[i][c];
+      if(d == 0) continue;
+      p->colors[i][c] += constrain(d, -(int16_t)step, (int16_t)step);
+      p->fade_moved = true;
+    }
+  }
+  p->fade_pos = i;
+  if(i != 0) return; // not through all entries yet
+
+  if(!p->fade_moved) {
+    p->fade_step = 0;
+    if(p->fade_free) setPalette(n, PALETTE_NONE); // back to the color wheel
+    return;
+  }
+  p->fade_moved = false;
+}
+
+/*
+ * The color at pos of the palette of the segment being rendered, or of the
+ * color wheel, if it has none. Used by the modes instead of color_wheel().
+ */
+uint32_t WS2812FX::palette_color(uint8_t pos) {
+  palette* p = _palettes[_segment_index];
+  if(p == NULL) return color_wheel(pos);
+  const uint8_t* c = p->colors[pos];
+  return ((uint32_t)c[0] << 16) | ((uint32_t)c[1] << 8) | c[2];
+}
+
+/*
+ * The color at pos of the palette of the segment being rendered, or of
+ * palette id, if it has none. Works that entry out instead of expanding
+ * the palette, so modes can have colors of their own without the RAM.
+ */
+uint32_t WS2812FX::palette_color(uint8_t pos, uint8_t id) {
+  if(_palettes[_segment_index] != NULL || id == PALETTE_NONE) return palette_color(pos);
+  const uint32_t* colors = _palette_colors[id - 1];
+  uint8_t j = pos / 17;
+  uint8_t rgb[3];
+  palette_blend(pgm_read_dword(&colors[j]), pgm_read_dword(&colors[min(j + 1, PALETTE_STOPS - 1)]), pos - j * 17, rgb);
+  return ((uint32_t)rgb[0] << 16) | ((uint32_t)rgb[1] << 8) | rgb[2];
+}
+
+/*
+ * The color at i of the palette of segment n (or of the color wheel).
+ */
+uint32_t WS2812FX::getPaletteColor(uint8_t n, uint8_t i) {
+  if(n >= _max_segments || _palettes[n] == NULL) return color_wheel(i);
+  const uint8_t* c = _palettes[n]->colors[i];
+  return ((uint32_t)c[0] << 16) | ((uint32_t)c[1] << 8) | c[2];
+}
+
+/*
+ * Sets the number of particles the particle modes (Multi Comet, Meteor
+ * Shower, ...) may have alive at once on segment n, up to MAX_PARTICLES.
+ * The pool is allocated once, about 20 bytes per particle, nothing is
+ * allocated while the particles come and go. 0 frees it. Without a pool,
+ * a particle mode allocates one of DEFAULT_PARTICLES. False if there
+ * isn't enough memory.
+ */
+bool WS2812FX::setParticles(uint8_t n, uint16_t count) {
+  if(n >= _max_segments) return false;
+  free(_pools[n]);
+  _pools[n] = NULL;
+  if(count == 0) return true;
+  count = min(count, (uint16_t)MAX_PARTICLES);
+  particle_pool* pool = (particle_pool*)malloc(sizeof(particle_pool) + count * sizeof(particle));
+  if(pool == NULL) return false;
+  pool->particles = (particle*)(pool + 1);
+  pool->size = count;
+  pool->live = 0;
+  _pools[n] = pool;
+  return true;
 }
 
-uint32_t WS2812FX::getColor(void) {
-  return _segments[0].colors[0];
-}
+/*
+ * The particles alive on segment n.
+ */
+uint16_t WS2812FX::getParticleCount(uint8_t n) {
+  return (n < _max_segments && _pools[n] != NULL) ? _pools[n]->live : 0;
+}
+
+/*
+ * Reserves bytes of memory for the state of the mode running on segment n
+ * (e.g. Fire keeps one byte per LED), so it isn't allocated while the mode
+ * runs. The modes grow it as they need, it's kept when the mode changes.
+ * 0 frees it. False if there isn't enough memory.
+ */
+bool WS2812FX::setSegmentMemory(uint8_t n, uint16_t bytes) {
+  if(n >= _max_segments) return false;
+  segment_arena* a = &_arenas[n];
+  if(bytes == 0) {
+    free(a->data);
+    a->data = NULL;
+    a->size = 0;
+    return true;
+  }
+  uint8_t* data = (uint8_t*)realloc(a->data, bytes);
+  if(data == NULL) return false;
+  if(bytes > a->size) memset(data + a->size, 0, bytes - a->size);
+  a->data = data;
+  a->size = bytes;
+  return true;
+}
+
+/*
+ * The bytes of memory segment n has for the state of its mode.
+ */
+uint16_t WS2812FX::getSegmentMemory(uint8_t n) {
+  return (n < _max_segments) ? _arenas[n].size : 0;
+}
+
+/*
+ * Memory for the state of the mode being rendered. The arena is handed
+ * out from the start every frame, so the same calls in the same order get
+ * the same memory, with what the mode left there last frame. It's zeroed
+ * when the mode starts. Grows the arena if needed, which moves it: memory
+ * taken earlier in the same frame has to be taken again. NULL if there
+ * isn't enough memory.
+ */
+uint8_t* WS2812FX::segment_alloc(uint16_t bytes) {
+  segment_arena* a = &_arenas[_segment_index];
+  uint16_t used = a->used;
+  if(bytes > a->size - used && !setSegmentMemory(_segment_index, used + bytes)) return NULL;
+  uint8_t* p = a->data + used;
+  if(SEGMENT_RUNTIME.counter_mode_call == 0) memset(p, 0, bytes);
+  a->used = used + bytes;
+  return p;
+}
+
+/*
+ * Copies the cached frame of the step into the segment, if there is one.
+ * rotate is the direction the frame moves per step (+1/-1), 0 if the frames
+ * are no rotations of each other.
+ */
+bool WS2812FX::cache_load(uint16_t step, uint16_t period, int8_t rotate) {
+  frame_cache* fc = segment_cache(period, rotate);
+  if(fc == NULL) return false;
+
+  step %= period;
+  bool cached = rotate ? fc->valid[0] : fc->valid[step >> 3] & (1 << (step & 7));
+  if(!cached) {
+    _stats.cache_misses++;
+    return false;
+  }
+  _stats.cache_hits++;
+
+  uint16_t len;
+  uint8_t *p = segment_pixels(len);
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  if(rotate) { // pixel i of this step is pixel i + offset of the kept one
+    uint16_t d = (step + period - fc->base_step) % period;
+    uint16_t offset = ((rotate > 0) ? d : len - d) % len;
+    uint16_t n = (len - offset) * bpp;
+    if(memcmp(p, fc->frames + offset * bpp, n) != 0 || memcmp(p + n, fc->frames, offset * bpp) != 0) {
+      memcpy(p, fc->frames + offset * bpp, n);
+      memcpy(p + n, fc->frames, offset * bpp);
+      _changed = true;
+    }
+  } else {
+    uint8_t *frame = fc->frames + (uint32_t)step * len * bpp;
+    if(memcmp(p, frame, len * bpp) != 0) {
+      memcpy(p, frame, len * bpp);
+      _changed = true;
+    }
+  }
+  return true;
+}
+
+/*
+ * Keeps the frame the segment's mode just rendered for the step.
+ */
+void WS2812FX::cache_store(uint16_t step, uint16_t period, int8_t rotate) {
+  frame_cache* fc = segment_cache(period, rotate);
+  if(fc == NULL) return;
+
+  step %= period;
+  uint16_t len;
+  uint8_t *p = segment_pixels(len);
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  if(rotate) {
+    memcpy(fc->frames, p, len * bpp);
+    fc->base_step = step;
+    fc->valid[0] = 1;
+  } else {
+    memcpy(fc->frames + (uint32_t)step * len * bpp, p, len * bpp);
+    fc->valid[step >> 3] |= 1 << (step & 7);
+  }
+}
+
+/* #####################################################
+#
+#  Pixel and Output Functions
+#
+##################################################### */
+
+/*
+ * Sets the gamma applied to all colors on output, 1.0 turns it off.
+ * 2.2 to 2.8 match the LEDs to the eye, so dim colors are not washed out.
+ */
+void WS2812FX::setGamma(float g) {
+  _gamma = constrain(g, 0.1, 5.0);
+  _lut_dirty = true;
+  _changed = true;
+}
+
+float WS2812FX::getGamma(void) {
+  return _gamma;
+}
+
+/*
+ * Sets the white balance as the color a full white should be shown as,
+ * e.g. 0xFFB0F0 tones down green and blue a bit. 0xFFFFFFFF turns it off.
+ */
+void WS2812FX::setColorCorrection(uint32_t c) {
+  _correction = c;
+  _lut_dirty = true;
+  _changed = true;
+}
+
+uint32_t WS2812FX::getColorCorrection(void) {
+  return _correction;
+}
+
+/*
+ * Pixels are stored unscaled in the render buffer, so effects reading them
+ * back (e.g. fade_out()) get exactly what they wrote.
+ */
+void WS2812FX::setPixelColor(uint16_t n, uint32_t c) {
+  setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c, (uint8_t)(c >> 24));
+}
+
+void WS2812FX::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  setPixelColor(n, r, g, b, 0);
+}
+
+void WS2812FX::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+  uint8_t *p = pixel_address(n);
+  if(p != NULL) {
+    if(p[rOffset] == r && p[gOffset] == g && p[bOffset] == b && (wOffset == rOffset || p[wOffset] == w)) return;
+    if(wOffset != rOffset) p[wOffset] = w;
+    p[rOffset] = r;
+    p[gOffset] = g;
+    p[bOffset] = b;
+    _changed = true;
+    if(!_rendering) _drawn = true;
+  }
+}
+
+uint32_t WS2812FX::getPixelColor(uint16_t n) const {
+  uint8_t *p = pixel_address(n);
+  if(p == NULL) return 0;
+
+  uint32_t w = (wOffset != rOffset) ? (uint32_t)p[wOffset] << 24 : 0;
+  return w | ((uint32_t)p[rOffset] << 16) | ((uint32_t)p[gOffset] << 8) | p[bOffset];
+}
+
+/*
+ * Where pixel n is stored: in the render buffer or, while a layer is being
+ * rendered, in the layer's own buffer. NULL if n is outside of it.
+ */
+uint8_t* WS2812FX::pixel_address(uint16_t n) const {
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  if(_target != NULL) {
+    n -= _target_start; // pixels before the start wrap around and fail the check below
+    return (n < _target_len) ? _target + n * bpp : NULL;
+  }
+  return (n < numLEDs) ? _pixels + n * bpp : NULL;
+}
+
+void WS2812FX::clear(void) {
+  _changed = true;
+  _drawn = true;
+  memset(_pixels, 0, numBytes);
+  for(uint8_t i=0; i < _max_segments; i++) {
+    if(_layers[i].pixels != NULL) memset(_layers[i].pixels, 0, _layers[i].len * ((wOffset == rOffset) ? 3 : 4));
+  }
+}
+
+/*
+ * Always sends the frame. service() only calls it, if a pixel or a setting
+ * affecting the output changed since the last time.
+ */
+void WS2812FX::show(void) {
+  output();
+  // over the power budget, the frame is converted again, dimmer, before it's sent
+  for(uint8_t i=0; i < 3 && _max_current > 0 && _power > _max_current; i++) {
+    uint16_t limit = _limit;
+    limit_power();
+    if(_limit == limit) break; // as dark as it gets, e.g. a budget below the idle current
+    output();
+  }
+  trigger_latency();
+  if(_num_outputs > 0) {
+    show_outputs();
+  } else if(_blank_len > numLEDs) { // send the LEDs setLength() cut off once more, dark
+    uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+    uint16_t n = numLEDs, bytes = numBytes;
+    memset(pixels + numBytes, 0, (_blank_len - numLEDs) * bpp);
+    numLEDs = _blank_len;
+    numBytes = _blank_len * bpp;
+    Adafruit_NeoPixel::show();
+    numLEDs = n;
+    numBytes = bytes;
+  } else {
+    Adafruit_NeoPixel::show();
+  }
+  _blank_len = 0;
+  _changed = false;
+  _stats.shows++;
+  if(_max_current > 0) limit_power(); // recovers for the next frame
+}
+
+/*
+ * Adds an output driver (see WS2812FXOutput.h), which shows the LEDs first
+ * to first + driver.numPixels() - 1 of this one. Segments, layers and the
+ * power limit work on all LEDs as usual, so a segment may span several
+ * outputs, and all outputs are handed the same frame by show(). The pin
+ * passed to the constructor only drives the LEDs before the first output
+ * (if any), so with an output at 0 it isn't used at all. Returns false, if
+ * there's no room for another output or first is out of range.
+ */
+bool WS2812FX::addOutput(WS2812FXOutput& driver, uint16_t first) {
+  if(_num_outputs >= MAX_NUM_OUTPUTS || first >= numLEDs) return false;
+  driver.begin();
+  _outputs[_num_outputs].driver = &driver;
+  _outputs[_num_outputs].first = first;
+  _num_outputs++;
+  _changed = true;
+  return true;
+}
+
+uint8_t WS2812FX::getNumOutputs(void) {
+  return _num_outputs;
+}
+
+/*
+ * False while an output is still busy with the last frame.
+ */
+bool WS2812FX::outputs_ready(void) {
+  for(uint8_t i=0; i < _num_outputs; i++) {
+    if(!_outputs[i].driver->canShow()) return false;
+  }
+  return true;
+}
+
+/*
+ * Sends the LEDs before the first output through the own pin, then hands
+ * every output its part of the frame. Drivers which send in the background
+ * run in parallel.
+ */
+void WS2812FX::show_outputs(void) {
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  uint16_t own = numLEDs;
+  for(uint8_t i=0; i < _num_outputs; i++) {
+    own = min(own, _outputs[i].first);
+  }
+  if(own > 0) { // Adafruit_NeoPixel::show() sends numBytes, so shorten the strip for a moment
+    uint16_t n = numLEDs, bytes = numBytes;
+    numLEDs = own;
+    numBytes = own * bpp;
+    Adafruit_NeoPixel::show();
+    numLEDs = n;
+    numBytes = bytes;
+  }
+
+  uint8_t format = (wOffset << 6) | (rOffset << 4) | (gOffset << 2) | bOffset;
+  for(uint8_t i=0; i < _num_outputs; i++) {
+    output_channel& o = _outputs[i];
+    if(o.first >= numLEDs) continue; // cut off by setLength()
+    uint16_t len = min(o.driver->numPixels(), (uint16_t)(numLEDs - o.first));
+    o.driver->show(pixels + o.first * bpp, len, format);
+  }
+}
+
+/*
+ * Counters of service(): frames rendered, sent to the LEDs and not sent,
+ * because nothing changed.
+ */
+const WS2812FX::stats& WS2812FX::getStats(void) {
+  return _stats;
+}
+
+void WS2812FX::resetStats(void) {
+  TRIGGER_LOCK(); // trigger() counts dropped events, maybe in an interrupt handler
+  memset(&_stats, 0, sizeof(_stats));
+  TRIGGER_UNLOCK();
+}
+
+/*
+ * (Re)allocates the render buffer to match the NeoPixel buffer. If that fails,
+ * the strip is set to zero length, like Adafruit_NeoPixel does.
+ */
+bool WS2812FX::alloc_pixels(void) {
+  free(_pixels);
+  _changed = true;
+  if((_pixels = (uint8_t*)malloc(numBytes)) != NULL) {
+    memset(_pixels, 0, numBytes);
+    return true;
+  }
+  numLEDs = numBytes = 0;
+  return false;
+}
+
+/*
+ * Fills the lookup table: one row per byte of a pixel (in the strip's color
+ * order), each maps a rendered value to gamma * white balance * brightness
+ * (including the current limiter's share, see limit_power()). The gamma
+ * curve is kept in a fifth row, as pow() is slow on an AVR (256 calls take
+ * tens of ms), so it only runs when the gamma changes, not with every
+ * change of the brightness or the current limit.
+ */
+void WS2812FX::build_lut(void) {
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  uint8_t offset[] = {rOffset, gOffset, bOffset, wOffset};
+  uint8_t shift[] = {16, 8, 0, 24};
+  uint16_t scale = ((_brightness + 1) * _limit) >> 8;
+  uint16_t balance[4];
+  uint8_t *curve = _lut + 4 * 256;
+
+  if(_lut_gamma != _gamma) {
+    for(uint16_t i=0; i < 256; i++) {
+      curve[i] = (_gamma == 1.0) ? i : (uint8_t)(pow(i / 255.0, _gamma) * 255.0 + 0.5);
+    }
+    _lut_gamma = _gamma;
+  }
+  for(uint8_t c=0; c < bpp; c++) {
+    balance[c] = ((_correction >> shift[c]) & 0xFF) + 1;
+  }
+  for(uint16_t i=0; i < 256; i++) {
+    for(uint8_t c=0; c < bpp; c++) {
+      _lut[offset[c] * 256 + i] = (((curve[i] * balance[c]) >> 8) * scale) >> 8;
+    }
+  }
+  _lut_dirty = false;
+}
+
+/*
+ * Blends one byte of a layer (l) over what's below it (b), a = opacity + 1.
+ */
+static inline uint8_t blend(uint8_t mode, uint8_t b, uint8_t l, uint16_t a) {
+  switch(mode) {
+    case BLEND_ADD:    return min(b + ((l * a) >> 8), 255);
+    case BLEND_SCREEN: l = 255 - (((255 - b) * (255 - l)) >> 8); break;
+    case BLEND_MAX:    l = max(b, l); break;
+  }
+  return (l * a + b * (256 - a)) >> 8;
+}
+
+/*
+ * The output stage, a single pass over the render buffer into the NeoPixel
+ * buffer. Without gamma and white balance, brightness is applied by a
+ * multiplication (the same math Adafruit_NeoPixel uses), otherwise through
+ * the lookup table, which is only rebuilt when one of its inputs changed.
+ * Where layers are visible, they are blended in by the same pass (see
+ * output_span()). With a current limit set, the pass sums up the output for
+ * the power estimate, which sets the limit (see limit_power() and show()).
+ */
+void WS2812FX::output(void) {
+  if(_gamma == 1.0 && _correction == 0xFFFFFFFF) {
+    free(_lut);
+    _lut = NULL;
+  } else if(_lut == NULL) {
+    _lut = (uint8_t*)malloc(5 * 256); // if this fails, stick to brightness only
+    _lut_gamma = 0.0; // no curve yet
+    _lut_dirty = true;
+  }
+  if(_lut != NULL && _lut_dirty) build_lut();
+
+  // split the strip where layers start and end, between two cuts the same
+  // layers are visible
+  uint16_t cuts[2 * MAX_NUM_SEGMENTS + 2];
+  uint8_t num_cuts = 0;
+  cuts[num_cuts++] = 0;
+  cuts[num_cuts++] = numLEDs;
+  for(uint8_t i=0; i < _num_segments; i++) {
+    if(layer_visible(i)) {
+      cuts[num_cuts++] = min(_segments[i].start, numLEDs);
+      cuts[num_cuts++] = min(_segments[i].start + _layers[i].len, numLEDs);
+    }
+  }
+  for(uint8_t i=1; i < num_cuts; i++) { // insertion sort, there are only a few
+    for(uint8_t j=i; j > 0 && cuts[j - 1] > cuts[j]; j--) {
+      uint16_t t = cuts[j]; cuts[j] = cuts[j - 1]; cuts[j - 1] = t;
+    }
+  }
+
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  bool summing = (_lut != NULL || _max_current > 0);
+  uint32_t sum = 0;
+  for(uint8_t c=0; c + 1 < num_cuts; c++) {
+    if(cuts[c] == cuts[c + 1]) continue;
+    sum += output_span(cuts[c] * bpp, cuts[c + 1] * bpp, summing);
+  }
+
+  sum += expand_segments(summing);
+  if(summing) _power = power_estimate(sum); // else getPowerEstimate() works it out when asked
+}
+
+/*
+ * Converts the bytes from..to-1 of the render buffer into the NeoPixel buffer,
+ * blending in the layers visible there. A transparent layer is left out, an
+ * opaque one (alpha blended at full opacity) hides everything below it,
+ * which is not read at all. Returns the sum of the output, if asked for.
+ */
+uint32_t WS2812FX::output_span(uint16_t from, uint16_t to, bool summing) {
+  uint8_t *src = _pixels;
+  uint8_t *dst = pixels;
+  uint32_t sum = 0;
+  uint16_t scale = ((_brightness + 1) * _limit) >> 8;
+
+  uint8_t visible[MAX_NUM_SEGMENTS];
+  uint8_t num_visible = 0;
+  bool base = true;
+  uint8_t bpp = (wOffset == rOffset) ? 3 : 4;
+  for(uint8_t i=0; i < _num_segments; i++) {
+    uint16_t start = _segments[i].start * bpp;
+    if(!layer_visible(i) || from < start || to > start + _layers[i].len * bpp) continue;
+    if(_layers[i].blend == BLEND_ALPHA && _layers[i].opacity == 255) {
+      num_visible = 0;
+      base = false;
+    }
+    visible[num_visible++] = i;
+  }
+
+  if(num_visible == 0 && _lut != NULL) {
+    for(uint16_t i=from; i < to; i += bpp) {
+      for(uint8_t j=0; j < bpp; j++) {
+        uint8_t v = _lut[j * 256 + src[i + j]];
+        dst[i + j] = v;
+        sum += v;
+      }
+    }
+  } else if(num_visible == 0 && !summing) {
+    for(uint16_t i=from; i < to; i++) {
+      dst[i] = (src[i] * scale) >> 8;
+    }
+  } else if(num_visible == 0) {
+    for(uint16_t i=from; i < to; i++) {
+      uint8_t v = (src[i] * scale) >> 8;
+      dst[i] = v;
+      sum += v;
+    }
+  } else {
+    for(uint16_t i=from; i < to; i += bpp) {
+      for(uint8_t j=0; j < bpp; j++) {
+        uint8_t v = base ? src[i + j] : 0;
+        for(uint8_t k=0; k < num_visible; k++) {
+          layer& l = _layers[visible[k]];
+          v = blend(l.blend, v, l.pixels[i + j - _segments[visible[k]].start * bpp], l.opacity + 1);
+        }
+        v = (_lut != NULL) ? _lut[j * 256 + v] : (v * scale) >> 8;
+        dst[i + j] = v;
+        sum += v;
+      }
+    }
+  }
+  return sum;
+}
+
+/*
+ * Converts the sum of all output bytes into mA.
+ */
+uint32_t WS2812FX::power_estimate(uint32_t sum) {
+  return (uint32_t)numLEDs * _idle_current + sum / 255 * _channel_current;
+}
+
+/*
+ * Works out the limiter's share of the brightness from the estimate of the
+ * frame converted last. Above the budget it drops right away, show() then
+ * converts the frame again before sending it. Below, it recovers at most
+ * twice as bright per frame, as a frame dimmed to black tells nothing about
+ * how bright it would be, and ignores small steps, as every change rebuilds
+ * the lookup table.
+ */
+void WS2812FX::limit_power(void) {
+  uint16_t limit = 256;
+  if(_max_current > 0) {
+    uint32_t idle = power_estimate(0);
+    uint32_t budget = (_max_current > idle) ? _max_current - idle : 0;
+    // what the last frame would have drawn without the limiter
+    uint32_t draw = (_limit > 0 && _power > idle) ? (uint64_t)(_power - idle) * 256 / _limit : 0;
+    if(draw > budget) limit = (uint64_t)budget * 256 / draw;
+    if(limit < _limit && _power <= _max_current) limit = _limit; // rounding, it fits
+    if(limit > _limit) {
+      if(limit < 256 && limit <= _limit + _limit / 16) limit = _limit;
+      limit = min(limit, (uint16_t)(2 * _limit + 1));
+    }
+  }
+  if(limit != _limit) {
+    _limit = limit;
+    _limit_changed = true;
+    _lut_dirty = true;
+    _changed = true;
+  }
+}
+
+/*
+ * Sets the power budget in mA, the output is dimmed whenever a frame would
+ * draw more. The limit carries over from frame to frame, only a frame above
+ * it is converted a second time. 0 turns the limiter off.
+ */
+void WS2812FX::setMaxCurrent(uint32_t mA) {
+  getPowerEstimate(); // of the frame shown now, the limit starts from there
+  _max_current = mA;
+  limit_power();
+  _changed = true;
+}
+
+/*
+ * Sets the power model: the current a single color channel of an LED draws
+ * at full level and the current an LED draws when it's dark, both in mA.
+ * The defaults (20mA and 1mA) fit most WS2812.
+ */
+void WS2812FX::setPowerModel(uint8_t channel_mA, uint8_t idle_mA) {
+  _channel_current = channel_mA;
+  _idle_current = idle_mA;
+  _changed = true;
+}
+
+/*
+ * Sets the audio input of the sound reactive modes (Spectrum, Beat Pulse,
+ * Bass Fire). service() analyzes it at the start of every frame, NULL
+ * turns it off, the modes then stay quiet.
+ */
+void WS2812FX::setAudio(WS2812FXAudio* audio) {
+  _audio = audio;
+}
+
+WS2812FXAudio* WS2812FX::getAudio(void) {
+  return _audio;
+}
+
+/*
+ * Returns the estimated current of the last frame in mA, after limiting.
+ */
+uint32_t WS2812FX::getPowerEstimate(void) {
+  if(_max_current == 0 && _lut == NULL) {
+    uint32_t sum = 0;
+    for(uint16_t i=0; i < numBytes; i++) {
+      sum += pixels[i];
+    }
+    _power = power_estimate(sum);
+  }
+  return _power;
+}
+
+/* #####################################################
+#
+#  Matrix Functions
+#
+##################################################### */
+
+/*
+ * Describes the LEDs as a matrix of panels, each w x h LEDs. Panels are
+ * chained row by row, starting top left, and every panel is wired row by row,
+ * starting with its top left LED. The layout adds serpentine wiring and a
+ * rotation (see MATRIX_*). The mapping is computed once, here: XY() and the
+ * 2D modes only look up the LED index. w = 0 turns the matrix off again.
+ */
+void WS2812FX::setMatrix(uint16_t w, uint16_t h, uint8_t layout, uint8_t panelsX, uint8_t panelsY) {
+  free(_matrix_map);
+  _matrix_map = NULL;
+  _matrix_width = _matrix_height = 0;
+  if(w == 0 || h == 0 || panelsX == 0 || panelsY == 0) return;
+
+  uint16_t phys_w = w * panelsX;
+  uint16_t phys_h = h * panelsY;
+  uint8_t rotation = layout & MATRIX_ROTATE_270;
+  bool swap = (rotation == MATRIX_ROTATE_90 || rotation == MATRIX_ROTATE_270);
+  uint16_t width = swap ? phys_h : phys_w;
+  uint16_t height = swap ? phys_w : phys_h;
+
+  if((_matrix_map = (uint16_t*)malloc((uint32_t)width * height * sizeof(uint16_t))) == NULL) return;
+  _matrix_width = width;
+  _matrix_height = height;
+
+  uint16_t *m = _matrix_map;
+  for(uint16_t y=0; y < height; y++) {
+    for(uint16_t x=0; x < width; x++) {
+      uint16_t px = x, py = y;
+      if(rotation == MATRIX_ROTATE_90)  { px = y; py = phys_h - 1 - x; }
+      if(rotation == MATRIX_ROTATE_180) { px = phys_w - 1 - x; py = phys_h - 1 - y; }
+      if(rotation == MATRIX_ROTATE_270) { px = phys_w - 1 - y; py = x; }
+
+      uint16_t tx = px / w, ty = py / h;
+      uint16_t lx = px % w, ly = py % h;
+      if((layout & MATRIX_PANELS_SERPENTINE) && (ty & 1)) tx = panelsX - 1 - tx;
+      if((layout & MATRIX_SERPENTINE) && (ly & 1)) lx = w - 1 - lx;
+      *m++ = (ty * panelsX + tx) * (w * h) + ly * w + lx;
+    }
+  }
+}
+
+/*
+ * Without a matrix, the whole strip is a single row.
+ */
+uint16_t WS2812FX::getMatrixWidth(void) {
+  return _matrix_map ? _matrix_width : numLEDs;
+}
+
+uint16_t WS2812FX::getMatrixHeight(void) {
+  return _matrix_map ? _matrix_height : 1;
+}
+
+/*
+ * Returns the LED index at a matrix position.
+ */
+uint16_t WS2812FX::XY(uint16_t x, uint16_t y) {
+  if(_matrix_map == NULL) return y * numLEDs + x;
+  if(x >= _matrix_width || y >= _matrix_height) return numLEDs; // i.e. off the strip
+  return _matrix_map[y * _matrix_width + x];
+}
+
+void WS2812FX::setPixelColorXY(uint16_t x, uint16_t y, uint32_t c) {
+  setPixelColor(XY(x, y), c);
+}
+
+/*
+ * Sets the text shown by the scrolling text mode. The text is not copied.
+ */
+void WS2812FX::setText(const char* text) {
+  _text = text;
+  _bitmap = NULL;
+}
+
+/*
+ * Sets a bitmap to be shown by the scrolling text mode instead of text, one
+ * byte per column (lowest bit at the top, like the font). It is not copied.
+ */
+void WS2812FX::setBitmap(const uint8_t* columns, uint16_t n) {
+  _bitmap = columns;
+  _bitmap_len = n;
+}
+
+/* #####################################################
+#
+#  JSON Functions
+#
+##################################################### */
+
+/*
+ * Print adapter which collects the output in a small buffer and hands it
+ * to the destination in chunks, instead of issuing one write per token.
+ */
+class ChunkPrint : public Print {
+  public:
+    ChunkPrint(Print& out) : _out(out), _len(0), _total(0) {}
+
+    size_t write(uint8_t c) {
+      _buf[_len++] = c;
+      if(_len == sizeof(_buf)) drain();
+      return 1;
+    }
+
+    size_t drain(void) {
+      if(_len > 0) _total += _out.write(_buf, _len);
+      _len = 0;
+      return _total;
+    }
+
+  private:
+    Print& _out;
+    uint8_t _buf[64];
+    uint8_t _len;
+    size_t _total;
+};
 
-WS2812FX::segment* WS2812FX::getSegments(void) {
-  return _segments;
-}
+/*
+ * Print sink which only counts, used to measure JSON output.
+ */
+class CountPrint : public Print {
+  public:
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t*, size_t size) { return size; }
+};
 
-const __FlashStringHelper* WS2812FX::getModeName(uint8_t m) {
-  if(m < MODE_COUNT) {
-    return _name[m];
-  } else {
-    return F("");
+/*
+ * Streams the mode catalog (see getModesJSON()) straight from flash.
+ */
+size_t WS2812FX::printModesJSON(Print& p) {
+  uint8_t buf[64];
+  size_t len = strlen_P(_modes_json) - 1; // the closing ] comes after the custom modes
+  size_t sent = 0;
+  while(sent < len) {
+    size_t n = min(len - sent, sizeof(buf));
+    memcpy_P(buf, _modes_json + sent, n);
+    if((n = p.write(buf, n)) == 0) return sent;
+    sent += n;
   }
-}
 
-void WS2812FX::setSegment(uint8_t n, uint16_t start, uint16_t stop, uint8_t mode, uint32_t color, uint16_t speed, bool reverse) {
-  if(n < (sizeof(_segments) / sizeof(_segments[0]))) {
-    if(n + 1 > _num_segments) _num_segments = n + 1;
-    _segments[n].start = start;
-    _segments[n].stop = stop;
-    _segments[n].mode = mode;
-    _segments[n].speed = speed;
-    _segments[n].reverse = reverse;
-    _segments[n].colors[0] = color;
+  ChunkPrint out(p);
+  for(uint8_t i=0; i < _num_custom_modes; i++) {
+    out.print(F(",\""));
+    out.print(_custom_modes[i].name);
+    out.print('"');
   }
+  out.print(']');
+  return sent + out.drain();
 }
 
-void WS2812FX::setSegment(uint8_t n, uint16_t start, uint16_t stop, uint8_t mode, const uint32_t colors[], uint16_t speed, bool reverse) {
-  if(n < (sizeof(_segments) / sizeof(_segments[0]))) {
-    if(n + 1 > _num_segments) _num_segments = n + 1;
-    _segments[n].start = start;
-    _segments[n].stop = stop;
-    _segments[n].mode = mode;
-    _segments[n].speed = speed;
-    _segments[n].reverse = reverse;
-
-    for(uint8_t i=0; i<NUM_COLORS; i++) {
-      _segments[n].colors[i] = colors[i];
+/*
+ * Streams the flags of all modes (see getModeFlags()) as a JSON array of
+ * numbers, in the order of the mode catalog, e.g. [33,2,1,...]. With it a
+ * user interface can e.g. offer as many color pickers as the mode uses.
+ */
+size_t WS2812FX::printModeFlagsJSON(Print& p) {
+  ChunkPrint out(p);
+  out.print('[');
+  for(uint8_t i=0; i < getModeCount(); i++) {
+    if(i > 0) out.print(',');
+    out.print(getModeFlags(i));
+  }
+  out.print(']');
+  return out.drain();
+}
+
+/*
+ * Streams the brightness, run state and segment table as JSON, e.g.
+ * {"pin":2,"numPixels":30,"brightness":50,"running":true,"numSegments":1,
+ *  "segments":[{"start":0,"stop":29,"mode":0,"speed":1000,"reverse":false,"colors":[16711680,0,0]}]}
+ * No heap is used, the output is passed on in small chunks.
+ */
+size_t WS2812FX::printStateJSON(Print& p) {
+  ChunkPrint out(p);
+  out.print(F("{\"pin\":"));         out.print(Adafruit_NeoPixel::getPin());
+  out.print(F(",\"numPixels\":"));   out.print(Adafruit_NeoPixel::numPixels());
+  out.print(F(",\"brightness\":"));  out.print(_brightness);
+  out.print(F(",\"running\":"));     out.print(_running ? F("true") : F("false"));
+  out.print(F(",\"numSegments\":")); out.print(_num_segments);
+  out.print(F(",\"segments\":["));
+  for(uint8_t i=0; i < _num_segments; i++) {
+    if(i > 0) out.print(',');
+    out.print(F("{\"start\":"));    out.print(_segments[i].start);
+    out.print(F(",\"stop\":"));     out.print(_segments[i].stop);
+    out.print(F(",\"mode\":"));     out.print(_segments[i].mode);
+    out.print(F(",\"speed\":"));    out.print(_segments[i].speed);
+    out.print(F(",\"reverse\":"));  out.print(_segments[i].reverse ? F("true") : F("false"));
+    out.print(F(",\"options\":"));  out.print(_segments[i].options);
+    out.print(F(",\"colors\":["));
+    for(uint8_t j=0; j < NUM_COLORS; j++) {
+      if(j > 0) out.print(',');
+      out.print(_segments[i].colors[j]);
     }
+    out.print(F("]}"));
   }
+  out.print(F("]}"));
+  return out.drain();
 }
 
-void WS2812FX::resetSegments() {
-  memset(_segments, 0, sizeof(_segments));
-  memset(_segment_runtimes, 0, sizeof(_segment_runtimes));
-  _segment_index = 0;
-  _num_segments = 1;
-  setSegment(0, 0, 7, FX_MODE_STATIC, DEFAULT_COLOR, DEFAULT_SPEED, false);
+/*
+ * Size of the printStateJSON() output, e.g. for a Content-Length header.
+ */
+size_t WS2812FX::getStateJSONLength(void) {
+  CountPrint counter;
+  return printStateJSON(counter);
 }
 
 /* #####################################################
@@ -268,8 +2367,8 @@ void WS2812FX::resetSegments() {
  * Turns everything off. Doh.
  */
 void WS2812FX::strip_off() {
-  Adafruit_NeoPixel::clear();
-  Adafruit_NeoPixel::show();
+  clear();
+  show();
 }
 
 
@@ -292,6 +2391,16 @@ uint32_t WS2812FX::color_wheel(uint8_t pos) {
 }
 
 
+/*
+ * Sine wave, 0..255 maps to one full period, returns 1..255 (128 at 0).
+ */
+uint8_t WS2812FX::sine8(uint8_t x) {
+  uint8_t i = x & 0x3F;
+  if(x & 0x40) i = 64 - i;
+  uint8_t v = pgm_read_byte(&_sine_quarter[i]);
+  return (x & 0x80) ? 128 - v : 128 + v;
+}
+
 /*
  * Returns a new, random wheel index with a minimum distance of 42 from pos.
  */
@@ -317,7 +2426,7 @@ uint8_t WS2812FX::get_random_wheel_index(uint8_t pos) {
  */
 uint16_t WS2812FX::mode_static(void) {
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, SEGMENT.colors[0]);
+    setPixelColor(i, SEGMENT.colors[0]);
   }
   return 500;
 }
@@ -333,7 +2442,7 @@ uint16_t WS2812FX::blink(uint32_t color1, uint32_t color2, bool strobe) {
   if(SEGMENT.reverse) color = (color == color1) ? color2 : color1;
 
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, color);
+    setPixelColor(i, color);
   }
 
   if((SEGMENT_RUNTIME.counter_mode_call & 1) == 0) {
@@ -356,7 +2465,7 @@ uint16_t WS2812FX::mode_blink(void) {
  * Classic Blink effect. Cycling through the rainbow.
  */
 uint16_t WS2812FX::mode_blink_rainbow(void) {
-  return blink(color_wheel(SEGMENT_RUNTIME.counter_mode_call & 0xFF), SEGMENT.colors[1], false);
+  return blink(palette_color(SEGMENT_RUNTIME.counter_mode_call & 0xFF), SEGMENT.colors[1], false);
 }
 
 
@@ -372,7 +2481,7 @@ uint16_t WS2812FX::mode_strobe(void) {
  * Classic Strobe effect. Cycling through the rainbow.
  */
 uint16_t WS2812FX::mode_strobe_rainbow(void) {
-  return blink(color_wheel(SEGMENT_RUNTIME.counter_mode_call & 0xFF), SEGMENT.colors[1], true);
+  return blink(palette_color(SEGMENT_RUNTIME.counter_mode_call & 0xFF), SEGMENT.colors[1], true);
 }
 
 
@@ -385,16 +2494,16 @@ uint16_t WS2812FX::color_wipe(uint32_t color1, uint32_t color2, bool rev) {
   if(SEGMENT_RUNTIME.counter_mode_step < SEGMENT_LENGTH) {
     uint32_t led_offset = SEGMENT_RUNTIME.counter_mode_step;
     if(SEGMENT.reverse) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - led_offset, color1);
+      setPixelColor(SEGMENT.stop - led_offset, color1);
     } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + led_offset, color1);
+      setPixelColor(SEGMENT.start + led_offset, color1);
     }
   } else {
     uint32_t led_offset = SEGMENT_RUNTIME.counter_mode_step - SEGMENT_LENGTH;
     if((SEGMENT.reverse && !rev) || (!SEGMENT.reverse && rev)) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - led_offset, color2);
+      setPixelColor(SEGMENT.stop - led_offset, color2);
     } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + led_offset, color2);
+      setPixelColor(SEGMENT.start + led_offset, color2);
     }
   }
 
@@ -430,7 +2539,7 @@ uint16_t WS2812FX::mode_color_wipe_random(void) {
   if(SEGMENT_RUNTIME.counter_mode_step % SEGMENT_LENGTH == 0) { // aux_param will store our random color wheel index
     SEGMENT_RUNTIME.aux_param = get_random_wheel_index(SEGMENT_RUNTIME.aux_param);
   }
-  uint32_t color = color_wheel(SEGMENT_RUNTIME.aux_param);
+  uint32_t color = palette_color(SEGMENT_RUNTIME.aux_param);
   return color_wipe(color, color, false) * 2;
 }
 
@@ -442,7 +2551,7 @@ uint16_t WS2812FX::mode_color_sweep_random(void) {
   if(SEGMENT_RUNTIME.counter_mode_step % SEGMENT_LENGTH == 0) { // aux_param will store our random color wheel index
     SEGMENT_RUNTIME.aux_param = get_random_wheel_index(SEGMENT_RUNTIME.aux_param);
   }
-  uint32_t color = color_wheel(SEGMENT_RUNTIME.aux_param);
+  uint32_t color = palette_color(SEGMENT_RUNTIME.aux_param);
   return color_wipe(color, color, true) * 2;
 }
 
@@ -453,10 +2562,10 @@ uint16_t WS2812FX::mode_color_sweep_random(void) {
  */
 uint16_t WS2812FX::mode_random_color(void) {
   SEGMENT_RUNTIME.aux_param = get_random_wheel_index(SEGMENT_RUNTIME.aux_param); // aux_param will store our random color wheel index
-  uint32_t color = color_wheel(SEGMENT_RUNTIME.aux_param);
+  uint32_t color = palette_color(SEGMENT_RUNTIME.aux_param);
 
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, color);
+    setPixelColor(i, color);
   }
   return (SEGMENT.speed);
 }
@@ -469,11 +2578,11 @@ uint16_t WS2812FX::mode_random_color(void) {
 uint16_t WS2812FX::mode_single_dynamic(void) {
   if(SEGMENT_RUNTIME.counter_mode_call == 0) {
     for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-      Adafruit_NeoPixel::setPixelColor(i, color_wheel(random(256)));
+      setPixelColor(i, palette_color(random(256)));
     }
   }
 
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color_wheel(random(256)));
+  setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), palette_color(random(256)));
   return (SEGMENT.speed);
 }
 
@@ -484,7 +2593,7 @@ uint16_t WS2812FX::mode_single_dynamic(void) {
  */
 uint16_t WS2812FX::mode_multi_dynamic(void) {
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, color_wheel(random(256)));
+    setPixelColor(i, palette_color(random(256)));
   }
   return (SEGMENT.speed);
 }
@@ -522,7 +2631,7 @@ uint16_t WS2812FX::mode_breath(void) {
   uint8_t g = (SEGMENT.colors[0] >>  8 & 0xFF) * lum / _brightness;
   uint8_t b = (SEGMENT.colors[0]       & 0xFF) * lum / _brightness;
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, r, g, b, w);
+    setPixelColor(i, r, g, b, w);
   }
 
   SEGMENT_RUNTIME.aux_param = breath_brightness;
@@ -543,7 +2652,7 @@ uint16_t WS2812FX::mode_fade(void) {
   uint8_t g = (SEGMENT.colors[0] >>  8 & 0xFF) * lum / _brightness;
   uint8_t b = (SEGMENT.colors[0]       & 0xFF) * lum / _brightness;
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, r, g, b, w);
+    setPixelColor(i, r, g, b, w);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) % 64;
@@ -560,16 +2669,16 @@ uint16_t WS2812FX::mode_scan(void) {
   }
 
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, BLACK);
+    setPixelColor(i, BLACK);
   }
 
   int led_offset = SEGMENT_RUNTIME.counter_mode_step - (SEGMENT_LENGTH - 1);
   led_offset = abs(led_offset); 
 
   if(SEGMENT.reverse) {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - led_offset, SEGMENT.colors[0]);
+    setPixelColor(SEGMENT.stop - led_offset, SEGMENT.colors[0]);
   } else {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + led_offset, SEGMENT.colors[0]);
+    setPixelColor(SEGMENT.start + led_offset, SEGMENT.colors[0]);
   }
 
   SEGMENT_RUNTIME.counter_mode_step++;
@@ -586,14 +2695,14 @@ uint16_t WS2812FX::mode_dual_scan(void) {
   }
 
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, BLACK);
+    setPixelColor(i, BLACK);
   }
 
   int led_offset = SEGMENT_RUNTIME.counter_mode_step - (SEGMENT_LENGTH - 1);
   led_offset = abs(led_offset);
 
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + led_offset, SEGMENT.colors[0]);
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_LENGTH - led_offset - 1, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + led_offset, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + SEGMENT_LENGTH - led_offset - 1, SEGMENT.colors[0]);
 
   SEGMENT_RUNTIME.counter_mode_step++;
   return (SEGMENT.speed / (SEGMENT_LENGTH * 2));
@@ -604,9 +2713,9 @@ uint16_t WS2812FX::mode_dual_scan(void) {
  * Cycles all LEDs at once through a rainbow.
  */
 uint16_t WS2812FX::mode_rainbow(void) {
-  uint32_t color = color_wheel(SEGMENT_RUNTIME.counter_mode_step);
+  uint32_t color = palette_color(SEGMENT_RUNTIME.counter_mode_step);
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, color);
+    setPixelColor(i, color);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) & 0xFF;
@@ -618,9 +2727,22 @@ uint16_t WS2812FX::mode_rainbow(void) {
  * Cycles a rainbow over the entire string of LEDs.
  */
 uint16_t WS2812FX::mode_rainbow_cycle(void) {
-  for(uint16_t i=0; i < SEGMENT_LENGTH; i++) {
-	  uint32_t color = color_wheel(((i * 256 / SEGMENT_LENGTH) + SEGMENT_RUNTIME.counter_mode_step) & 0xFF);
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color);
+  if(!cache_load(SEGMENT_RUNTIME.counter_mode_step, 256)) {
+    // hue of pixel i is i * 256 / len, stepped up as quotient and remainder
+    uint16_t len = SEGMENT_LENGTH;
+    uint16_t dq = 256 / len, dr = 256 % len;
+    uint16_t q = 0, r = 0;
+    for(uint16_t i=0; i < len; i++) {
+      uint32_t color = palette_color((q + SEGMENT_RUNTIME.counter_mode_step) & 0xFF);
+      setPixelColor(SEGMENT.start + i, color);
+      q += dq;
+      r += dr;
+      if(r >= len) {
+        r -= len;
+        q++;
+      }
+    }
+    cache_store(SEGMENT_RUNTIME.counter_mode_step, 256);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) & 0xFF;
@@ -633,18 +2755,20 @@ uint16_t WS2812FX::mode_rainbow_cycle(void) {
  */
 uint16_t WS2812FX::theater_chase(uint32_t color1, uint32_t color2) {
   SEGMENT_RUNTIME.counter_mode_call = SEGMENT_RUNTIME.counter_mode_call % 3;
-  for(uint16_t i=0; i < SEGMENT_LENGTH; i++) {
-    if((i % 3) == SEGMENT_RUNTIME.counter_mode_call) {
+  uint16_t len = SEGMENT_LENGTH;
+  uint8_t phase = 0; // i % 3
+  for(uint16_t i=0; i < len; i++, phase = (phase == 2) ? 0 : phase + 1) {
+    if(phase == SEGMENT_RUNTIME.counter_mode_call) {
       if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color1);
+        setPixelColor(SEGMENT.stop - i, color1);
       } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color1);
+        setPixelColor(SEGMENT.start + i, color1);
       }
     } else {
       if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color2);
+        setPixelColor(SEGMENT.stop - i, color2);
       } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color2);
+        setPixelColor(SEGMENT.start + i, color2);
       }
     }
   }
@@ -658,7 +2782,14 @@ uint16_t WS2812FX::theater_chase(uint32_t color1, uint32_t color2) {
  * Inspired by the Adafruit examples.
  */
 uint16_t WS2812FX::mode_theater_chase(void) {
-  return theater_chase(SEGMENT.colors[0], BLACK);
+  uint16_t step = SEGMENT_RUNTIME.counter_mode_call % 3;
+  if(cache_load(step, 3)) {
+    SEGMENT_RUNTIME.counter_mode_call = step;
+    return (SEGMENT.speed / SEGMENT_LENGTH);
+  }
+  uint16_t delay = theater_chase(SEGMENT.colors[0], BLACK);
+  cache_store(step, 3);
+  return delay;
 }
 
 
@@ -668,7 +2799,7 @@ uint16_t WS2812FX::mode_theater_chase(void) {
  */
 uint16_t WS2812FX::mode_theater_chase_rainbow(void) {
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) & 0xFF;
-  return theater_chase(color_wheel(SEGMENT_RUNTIME.counter_mode_step), BLACK);
+  return theater_chase(palette_color(SEGMENT_RUNTIME.counter_mode_step), BLACK);
 }
 
 
@@ -681,14 +2812,20 @@ uint16_t WS2812FX::mode_running_lights(void) {
   uint8_t g = ((SEGMENT.colors[0] >>  8) & 0xFF);
   uint8_t b = (SEGMENT.colors[0]         & 0xFF);
 
-  float radPerLed = (2.0 * 3.14159) / SEGMENT_LENGTH;
-  for(uint16_t i=0; i < SEGMENT_LENGTH; i++) {
-    int lum = map((int)(sin((i + SEGMENT_RUNTIME.counter_mode_step) * radPerLed) * 128), -128, 128, 0, 255);
-    if(SEGMENT.reverse) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, (r * lum) / 256, (g * lum) / 256, (b * lum) / 256, (w * lum) / 256);
-    } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, (r * lum) / 256, (g * lum) / 256, (b * lum) / 256, (w * lum) / 256);
+  // every step moves the wave by one pixel, so the frames are rotations of each other
+  // (up to rounding: 2 * 3.14159 isn't a full wave, a cached frame may be 1 off here and there)
+  if(!cache_load(SEGMENT_RUNTIME.counter_mode_step, SEGMENT_LENGTH, SEGMENT.reverse ? 1 : -1)) {
+    uint16_t len = SEGMENT_LENGTH;
+    float radPerLed = (2.0 * 3.14159) / len;
+    for(uint16_t i=0; i < len; i++) {
+      int lum = (((int)(sin((i + SEGMENT_RUNTIME.counter_mode_step) * radPerLed) * 128) + 128) * 255) >> 8; // map() from -128..128 to 0..255
+      if(SEGMENT.reverse) {
+        setPixelColor(SEGMENT.start + i, (r * lum) >> 8, (g * lum) >> 8, (b * lum) >> 8, (w * lum) >> 8);
+      } else {
+        setPixelColor(SEGMENT.stop - i, (r * lum) >> 8, (g * lum) >> 8, (b * lum) >> 8, (w * lum) >> 8);
+      }
     }
+    cache_store(SEGMENT_RUNTIME.counter_mode_step, SEGMENT_LENGTH, SEGMENT.reverse ? 1 : -1);
   }
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) % SEGMENT_LENGTH;
   return (SEGMENT.speed / SEGMENT_LENGTH);
@@ -701,14 +2838,14 @@ uint16_t WS2812FX::mode_running_lights(void) {
 uint16_t WS2812FX::twinkle(uint32_t color) {
   if(SEGMENT_RUNTIME.counter_mode_step == 0) {
     for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-      Adafruit_NeoPixel::setPixelColor(i, BLACK);
+      setPixelColor(i, BLACK);
     }
     uint16_t min_leds = max(1, SEGMENT_LENGTH / 5); // make sure, at least one LED is on
     uint16_t max_leds = max(1, SEGMENT_LENGTH / 2); // make sure, at least one LED is on
     SEGMENT_RUNTIME.counter_mode_step = random(min_leds, max_leds);
   }
 
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
+  setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
 
   SEGMENT_RUNTIME.counter_mode_step--;
   return (SEGMENT.speed / SEGMENT_LENGTH);
@@ -727,7 +2864,7 @@ uint16_t WS2812FX::mode_twinkle(void) {
  * Inspired by www.tweaking4all.com/hardware/arduino/adruino-led-strip-effects/
  */
 uint16_t WS2812FX::mode_twinkle_random(void) {
-  return twinkle(color_wheel(random(256)));
+  return twinkle(palette_color(random(256)));
 }
 
 
@@ -737,9 +2874,9 @@ uint16_t WS2812FX::mode_twinkle_random(void) {
  */
 void WS2812FX::fade_out() {
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    uint32_t color = Adafruit_NeoPixel::getPixelColor(i);
+    uint32_t color = getPixelColor(i);
     color = (color >> 1) & 0x7F7F7F7F;
-    Adafruit_NeoPixel::setPixelColor(i, color);
+    setPixelColor(i, color);
   }
 }
 
@@ -750,7 +2887,7 @@ uint16_t WS2812FX::twinkle_fade(uint32_t color) {
   fade_out();
 
   if(random(3) == 0) {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
+    setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
   }
   return (SEGMENT.speed / 8);
 }
@@ -768,7 +2905,7 @@ uint16_t WS2812FX::mode_twinkle_fade(void) {
  * Blink several LEDs in random colors on, fading out.
  */
 uint16_t WS2812FX::mode_twinkle_fade_random(void) {
-  return twinkle_fade(color_wheel(random(256)));
+  return twinkle_fade(palette_color(random(256)));
 }
 
 
@@ -777,9 +2914,9 @@ uint16_t WS2812FX::mode_twinkle_fade_random(void) {
  * Inspired by www.tweaking4all.com/hardware/arduino/adruino-led-strip-effects/
  */
 uint16_t WS2812FX::mode_sparkle(void) {
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, BLACK);
+  setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, BLACK);
   SEGMENT_RUNTIME.aux_param = random(SEGMENT_LENGTH); // aux_param stores the random led index
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, SEGMENT.colors[0]);
   return (SEGMENT.speed / SEGMENT_LENGTH);
 }
 
@@ -791,15 +2928,15 @@ uint16_t WS2812FX::mode_sparkle(void) {
 uint16_t WS2812FX::mode_flash_sparkle(void) {
   if(SEGMENT_RUNTIME.counter_mode_call == 0) {
     for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-      Adafruit_NeoPixel::setPixelColor(i, SEGMENT.colors[0]);
+      setPixelColor(i, SEGMENT.colors[0]);
     }
   }
 
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, SEGMENT.colors[0]);
 
   if(random(5) == 0) {
     SEGMENT_RUNTIME.aux_param = random(SEGMENT_LENGTH); // aux_param stores the random led index
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, WHITE);
+    setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.aux_param, WHITE);
     return 20;
   } 
   return SEGMENT.speed;
@@ -812,12 +2949,13 @@ uint16_t WS2812FX::mode_flash_sparkle(void) {
  */
 uint16_t WS2812FX::mode_hyper_sparkle(void) {
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, SEGMENT.colors[0]);
+    setPixelColor(i, SEGMENT.colors[0]);
   }
 
   if(random(5) < 2) {
-    for(uint16_t i=0; i < max(1, SEGMENT_LENGTH/3); i++) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), WHITE);
+    uint16_t n = max(1, SEGMENT_LENGTH/3);
+    for(uint16_t i=0; i < n; i++) {
+      setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), WHITE);
     }
     return 20;
   }
@@ -830,14 +2968,14 @@ uint16_t WS2812FX::mode_hyper_sparkle(void) {
  */
 uint16_t WS2812FX::mode_multi_strobe(void) {
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, BLACK);
+    setPixelColor(i, BLACK);
   }
 
   uint16_t delay = SEGMENT.speed / (2 * ((SEGMENT.speed / 10) + 1));
   if(SEGMENT_RUNTIME.counter_mode_step < (2 * ((SEGMENT.speed / 10) + 1))) {
     if((SEGMENT_RUNTIME.counter_mode_step & 1) == 0) {
       for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-        Adafruit_NeoPixel::setPixelColor(i, SEGMENT.colors[0]);
+        setPixelColor(i, SEGMENT.colors[0]);
       }
       delay = 20;
     } else {
@@ -860,13 +2998,13 @@ uint16_t WS2812FX::chase(uint32_t color1, uint32_t color2, uint32_t color3) {
   uint16_t b = (a + 1) % SEGMENT_LENGTH;
   uint16_t c = (b + 1) % SEGMENT_LENGTH;
   if(SEGMENT.reverse) {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - a, color1);
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - b, color2);
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - c, color3);
+    setPixelColor(SEGMENT.stop - a, color1);
+    setPixelColor(SEGMENT.stop - b, color2);
+    setPixelColor(SEGMENT.stop - c, color3);
   } else {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + a, color1);
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + b, color2);
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + c, color3);
+    setPixelColor(SEGMENT.start + a, color1);
+    setPixelColor(SEGMENT.start + b, color2);
+    setPixelColor(SEGMENT.start + c, color3);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) % SEGMENT_LENGTH;
@@ -913,7 +3051,7 @@ uint16_t WS2812FX::mode_chase_random(void) {
   if(SEGMENT_RUNTIME.counter_mode_step == 0) {
     SEGMENT_RUNTIME.aux_param = get_random_wheel_index(SEGMENT_RUNTIME.aux_param);
   }
-  return chase(color_wheel(SEGMENT_RUNTIME.aux_param), WHITE, WHITE);
+  return chase(palette_color(SEGMENT_RUNTIME.aux_param), WHITE, WHITE);
 }
 
 
@@ -923,8 +3061,8 @@ uint16_t WS2812FX::mode_chase_random(void) {
 uint16_t WS2812FX::mode_chase_rainbow_white(void) {
   uint16_t n = SEGMENT_RUNTIME.counter_mode_step;
   uint16_t m = (SEGMENT_RUNTIME.counter_mode_step + 1) % SEGMENT_LENGTH;
-  uint32_t color2 = color_wheel(((n * 256 / SEGMENT_LENGTH) + (SEGMENT_RUNTIME.counter_mode_call & 0xFF)) & 0xFF);
-  uint32_t color3 = color_wheel(((m * 256 / SEGMENT_LENGTH) + (SEGMENT_RUNTIME.counter_mode_call & 0xFF)) & 0xFF);
+  uint32_t color2 = palette_color(((n * 256 / SEGMENT_LENGTH) + (SEGMENT_RUNTIME.counter_mode_call & 0xFF)) & 0xFF);
+  uint32_t color3 = palette_color(((m * 256 / SEGMENT_LENGTH) + (SEGMENT_RUNTIME.counter_mode_call & 0xFF)) & 0xFF);
 
   return chase(WHITE, color2, color3);
 }
@@ -936,7 +3074,7 @@ uint16_t WS2812FX::mode_chase_rainbow_white(void) {
 uint16_t WS2812FX::mode_chase_rainbow(void) {
   uint8_t color_sep = 256 / SEGMENT_LENGTH;
   uint8_t color_index = SEGMENT_RUNTIME.counter_mode_call & 0xFF;
-  uint32_t color = color_wheel(((SEGMENT_RUNTIME.counter_mode_step * color_sep) + color_index) & 0xFF);
+  uint32_t color = palette_color(((SEGMENT_RUNTIME.counter_mode_step * color_sep) + color_index) & 0xFF);
 
   return chase(color, WHITE, WHITE);
 }
@@ -948,7 +3086,7 @@ uint16_t WS2812FX::mode_chase_rainbow(void) {
 uint16_t WS2812FX::mode_chase_blackout_rainbow(void) {
   uint8_t color_sep = 256 / SEGMENT_LENGTH;
   uint8_t color_index = SEGMENT_RUNTIME.counter_mode_call & 0xFF;
-  uint32_t color = color_wheel(((SEGMENT_RUNTIME.counter_mode_step * color_sep) + color_index) & 0xFF);
+  uint32_t color = palette_color(((SEGMENT_RUNTIME.counter_mode_step * color_sep) + color_index) & 0xFF);
 
   return chase(color, BLACK, BLACK);
 }
@@ -962,7 +3100,7 @@ uint16_t WS2812FX::mode_chase_flash(void) {
   uint8_t flash_step = SEGMENT_RUNTIME.counter_mode_call % ((flash_count * 2) + 1);
 
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
-    Adafruit_NeoPixel::setPixelColor(i, SEGMENT.colors[0]);
+    setPixelColor(i, SEGMENT.colors[0]);
   }
 
   uint16_t delay = (SEGMENT.speed / SEGMENT_LENGTH);
@@ -971,11 +3109,11 @@ uint16_t WS2812FX::mode_chase_flash(void) {
       uint16_t n = SEGMENT_RUNTIME.counter_mode_step;
       uint16_t m = (SEGMENT_RUNTIME.counter_mode_step + 1) % SEGMENT_LENGTH;
       if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - n, WHITE);
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - m, WHITE);
+        setPixelColor(SEGMENT.stop - n, WHITE);
+        setPixelColor(SEGMENT.stop - m, WHITE);
       } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + n, WHITE);
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + m, WHITE);
+        setPixelColor(SEGMENT.start + n, WHITE);
+        setPixelColor(SEGMENT.start + m, WHITE);
       }
       delay = 20;
     } else {
@@ -996,7 +3134,7 @@ uint16_t WS2812FX::mode_chase_flash_random(void) {
   uint8_t flash_step = SEGMENT_RUNTIME.counter_mode_call % ((flash_count * 2) + 1);
 
   for(uint16_t i=0; i < SEGMENT_RUNTIME.counter_mode_step; i++) {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color_wheel(SEGMENT_RUNTIME.aux_param));
+    setPixelColor(SEGMENT.start + i, palette_color(SEGMENT_RUNTIME.aux_param));
   }
 
   uint16_t delay = (SEGMENT.speed / SEGMENT_LENGTH);
@@ -1004,12 +3142,12 @@ uint16_t WS2812FX::mode_chase_flash_random(void) {
     uint16_t n = SEGMENT_RUNTIME.counter_mode_step;
     uint16_t m = (SEGMENT_RUNTIME.counter_mode_step + 1) % SEGMENT_LENGTH;
     if(flash_step % 2 == 0) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + n, WHITE);
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + m, WHITE);
+      setPixelColor(SEGMENT.start + n, WHITE);
+      setPixelColor(SEGMENT.start + m, WHITE);
       delay = 20;
     } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + n, color_wheel(SEGMENT_RUNTIME.aux_param));
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + m, BLACK);
+      setPixelColor(SEGMENT.start + n, palette_color(SEGMENT_RUNTIME.aux_param));
+      setPixelColor(SEGMENT.start + m, BLACK);
       delay = 30;
     }
   } else {
@@ -1027,20 +3165,25 @@ uint16_t WS2812FX::mode_chase_flash_random(void) {
  * Alternating pixels running function.
  */
 uint16_t WS2812FX::running(uint32_t color1, uint32_t color2) {
-  for(uint16_t i=0; i < SEGMENT_LENGTH; i++) {
-    if((i + SEGMENT_RUNTIME.counter_mode_step) % 4 < 2) {
-      if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color1);
-      } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color1);
-      }
-    } else {
-      if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color2);
+  if(!cache_load(SEGMENT_RUNTIME.counter_mode_step, 4)) {
+    uint16_t len = SEGMENT_LENGTH;
+    uint8_t phase = SEGMENT_RUNTIME.counter_mode_step & 0x3; // (i + step) % 4
+    for(uint16_t i=0; i < len; i++, phase = (phase + 1) & 0x3) {
+      if(phase < 2) {
+        if(SEGMENT.reverse) {
+          setPixelColor(SEGMENT.start + i, color1);
+        } else {
+          setPixelColor(SEGMENT.stop - i, color1);
+        }
       } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color2);
+        if(SEGMENT.reverse) {
+          setPixelColor(SEGMENT.start + i, color2);
+        } else {
+          setPixelColor(SEGMENT.stop - i, color2);
+        }
       }
     }
+    cache_store(SEGMENT_RUNTIME.counter_mode_step, 4);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) & 0x3;
@@ -1082,20 +3225,14 @@ uint16_t WS2812FX::mode_halloween(void) {
  * Random colored pixels running.
  */
 uint16_t WS2812FX::mode_running_random(void) {
-  for(uint16_t i=SEGMENT_LENGTH-1; i > 0; i--) {
-    if(SEGMENT.reverse) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, Adafruit_NeoPixel::getPixelColor(SEGMENT.stop - i + 1));
-    } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, Adafruit_NeoPixel::getPixelColor(SEGMENT.start + i - 1));
-    }
-  }
+  shift(_segment_index, SEGMENT.reverse ? -1 : 1);
 
   if(SEGMENT_RUNTIME.counter_mode_step == 0) {
     SEGMENT_RUNTIME.aux_param = get_random_wheel_index(SEGMENT_RUNTIME.aux_param);
     if(SEGMENT.reverse) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop, color_wheel(SEGMENT_RUNTIME.aux_param));
+      setPixelColor(SEGMENT.stop, palette_color(SEGMENT_RUNTIME.aux_param));
     } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start, color_wheel(SEGMENT_RUNTIME.aux_param));
+      setPixelColor(SEGMENT.start, palette_color(SEGMENT_RUNTIME.aux_param));
     }
   }
 
@@ -1112,15 +3249,15 @@ uint16_t WS2812FX::mode_larson_scanner(void) {
 
   if(SEGMENT_RUNTIME.counter_mode_step < SEGMENT_LENGTH) {
     if(SEGMENT.reverse) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
+      setPixelColor(SEGMENT.stop - SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
     } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
+      setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
     }
   } else {
     if(SEGMENT.reverse) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - ((SEGMENT_LENGTH * 2) - SEGMENT_RUNTIME.counter_mode_step) + 2, SEGMENT.colors[0]);
+      setPixelColor(SEGMENT.stop - ((SEGMENT_LENGTH * 2) - SEGMENT_RUNTIME.counter_mode_step) + 2, SEGMENT.colors[0]);
     } else {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + ((SEGMENT_LENGTH * 2) - SEGMENT_RUNTIME.counter_mode_step) - 2, SEGMENT.colors[0]);
+      setPixelColor(SEGMENT.start + ((SEGMENT_LENGTH * 2) - SEGMENT_RUNTIME.counter_mode_step) - 2, SEGMENT.colors[0]);
     }
   }
 
@@ -1136,9 +3273,9 @@ uint16_t WS2812FX::mode_comet(void) {
   fade_out();
 
   if(SEGMENT.reverse) {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
+    setPixelColor(SEGMENT.stop - SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
   } else {
-    Adafruit_NeoPixel::setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
+    setPixelColor(SEGMENT.start + SEGMENT_RUNTIME.counter_mode_step, SEGMENT.colors[0]);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) % SEGMENT_LENGTH;
@@ -1162,55 +3299,57 @@ uint32_t prevLed, thisLed, nextLed;
 
 /* the old way
   // first LED has only one neighbour
-  px_r = (((Adafruit_NeoPixel::getPixelColor(SEGMENT.start+1) & 0xFF0000) >> 16) >> 1) + ((Adafruit_NeoPixel::getPixelColor(SEGMENT.start) & 0xFF0000) >> 16);
-  px_g = (((Adafruit_NeoPixel::getPixelColor(SEGMENT.start+1) & 0x00FF00) >>  8) >> 1) + ((Adafruit_NeoPixel::getPixelColor(SEGMENT.start) & 0x00FF00) >>  8);
-  px_b = (((Adafruit_NeoPixel::getPixelColor(SEGMENT.start+1) & 0x0000FF)      ) >> 1) + ((Adafruit_NeoPixel::getPixelColor(SEGMENT.start) & 0x0000FF));
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start, px_r, px_g, px_b);
+  px_r = (((getPixelColor(SEGMENT.start+1) & 0xFF0000) >> 16) >> 1) + ((getPixelColor(SEGMENT.start) & 0xFF0000) >> 16);
+  px_g = (((getPixelColor(SEGMENT.start+1) & 0x00FF00) >>  8) >> 1) + ((getPixelColor(SEGMENT.start) & 0x00FF00) >>  8);
+  px_b = (((getPixelColor(SEGMENT.start+1) & 0x0000FF)      ) >> 1) + ((getPixelColor(SEGMENT.start) & 0x0000FF));
+  setPixelColor(SEGMENT.start, px_r, px_g, px_b);
 */
   // set brightness(i) = ((brightness(i-1)/2 + brightness(i+1)) / 2) + brightness(i)
   for(uint16_t i=SEGMENT.start + 1; i <SEGMENT.stop; i++) {
 // the new way. not as precise, but much faster, smaller and works with RGBW leds
-    prevLed = (Adafruit_NeoPixel::getPixelColor(i-1) >> 2) & 0x3F3F3F3F;
-    thisLed = Adafruit_NeoPixel::getPixelColor(i);
-    nextLed = (Adafruit_NeoPixel::getPixelColor(i+1) >> 2) & 0x3F3F3F3F;
-    Adafruit_NeoPixel::setPixelColor(i, prevLed + thisLed + nextLed);
+    prevLed = (getPixelColor(i-1) >> 2) & 0x3F3F3F3F;
+    thisLed = getPixelColor(i);
+    nextLed = (getPixelColor(i+1) >> 2) & 0x3F3F3F3F;
+    setPixelColor(i, prevLed + thisLed + nextLed);
 
 /* the old way
     px_r = ((
-            (((Adafruit_NeoPixel::getPixelColor(i-1) & 0xFF0000) >> 16) >> 1) +
-            (((Adafruit_NeoPixel::getPixelColor(i+1) & 0xFF0000) >> 16)     ) ) >> 1) +
-            (((Adafruit_NeoPixel::getPixelColor(i  ) & 0xFF0000) >> 16)     );
+            (((getPixelColor(i-1) & 0xFF0000) >> 16) >> 1) +
+            (((getPixelColor(i+1) & 0xFF0000) >> 16)     ) ) >> 1) +
+            (((getPixelColor(i  ) & 0xFF0000) >> 16)     );
 
     px_g = ((
-            (((Adafruit_NeoPixel::getPixelColor(i-1) & 0x00FF00) >> 8) >> 1) +
-            (((Adafruit_NeoPixel::getPixelColor(i+1) & 0x00FF00) >> 8)     ) ) >> 1) +
-            (((Adafruit_NeoPixel::getPixelColor(i  ) & 0x00FF00) >> 8)     );
+            (((getPixelColor(i-1) & 0x00FF00) >> 8) >> 1) +
+            (((getPixelColor(i+1) & 0x00FF00) >> 8)     ) ) >> 1) +
+            (((getPixelColor(i  ) & 0x00FF00) >> 8)     );
 
     px_b = ((
-            (((Adafruit_NeoPixel::getPixelColor(i-1) & 0x0000FF)     ) >> 1) +
-            (((Adafruit_NeoPixel::getPixelColor(i+1) & 0x0000FF)     )     ) ) >> 1) +
-            (((Adafruit_NeoPixel::getPixelColor(i  ) & 0x0000FF)     )     );
+            (((getPixelColor(i-1) & 0x0000FF)     ) >> 1) +
+            (((getPixelColor(i+1) & 0x0000FF)     )     ) ) >> 1) +
+            (((getPixelColor(i  ) & 0x0000FF)     )     );
 
-    Adafruit_NeoPixel::setPixelColor(i, px_r, px_g, px_b);
+    setPixelColor(i, px_r, px_g, px_b);
 */
   }
 
 /* the old way
   // last LED has only one neighbour
-  px_r = (((Adafruit_NeoPixel::getPixelColor(SEGMENT.stop-1) & 0xFF0000) >> 16) >> 2) + ((Adafruit_NeoPixel::getPixelColor(SEGMENT.stop) & 0xFF0000) >> 16);
-  px_g = (((Adafruit_NeoPixel::getPixelColor(SEGMENT.stop-1) & 0x00FF00) >>  8) >> 2) + ((Adafruit_NeoPixel::getPixelColor(SEGMENT.stop) & 0x00FF00) >>  8);
-  px_b = (((Adafruit_NeoPixel::getPixelColor(SEGMENT.stop-1) & 0x0000FF)      ) >> 2) + ((Adafruit_NeoPixel::getPixelColor(SEGMENT.stop) & 0x0000FF));
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.stop, px_r, px_g, px_b);
+  px_r = (((getPixelColor(SEGMENT.stop-1) & 0xFF0000) >> 16) >> 2) + ((getPixelColor(SEGMENT.stop) & 0xFF0000) >> 16);
+  px_g = (((getPixelColor(SEGMENT.stop-1) & 0x00FF00) >>  8) >> 2) + ((getPixelColor(SEGMENT.stop) & 0x00FF00) >>  8);
+  px_b = (((getPixelColor(SEGMENT.stop-1) & 0x0000FF)      ) >> 2) + ((getPixelColor(SEGMENT.stop) & 0x0000FF));
+  setPixelColor(SEGMENT.stop, px_r, px_g, px_b);
 */
-  if(!_triggered) {
-    for(uint16_t i=0; i<max(1, SEGMENT_LENGTH/20); i++) {
+  if(SEGMENT_RUNTIME.trigger == 0) {
+    uint16_t n = max(1, SEGMENT_LENGTH/20);
+    for(uint16_t i=0; i < n; i++) {
       if(random(10) == 0) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
+        setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
       }
     }
-  } else {
-    for(uint16_t i=0; i<max(1, SEGMENT_LENGTH/10); i++) {
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
+  } else { // more of them, the stronger the trigger
+    uint16_t n = max(1, (int)(((uint32_t)(SEGMENT_LENGTH/10) * (SEGMENT_RUNTIME.trigger + 1)) >> 8));
+    for(uint16_t i=0; i < n; i++) {
+      setPixelColor(SEGMENT.start + random(SEGMENT_LENGTH), color);
     }
   }
   return (SEGMENT.speed / SEGMENT_LENGTH);
@@ -1230,7 +3369,7 @@ uint16_t WS2812FX::mode_fireworks(void) {
  * Random colored firework sparks.
  */
 uint16_t WS2812FX::mode_fireworks_random(void) {
-  uint32_t color = color_wheel(random(256));
+  uint32_t color = palette_color(random(256));
   return fireworks(color);
 }
 
@@ -1246,7 +3385,7 @@ uint16_t WS2812FX::fire_flicker(int rev_intensity) {
   byte lum = max(w, max(r, max(g, b))) / rev_intensity;
   for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
     int flicker = random(0, lum);
-    Adafruit_NeoPixel::setPixelColor(i, max(r - flicker, 0), max(g - flicker, 0), max(b - flicker, 0), max(w - flicker, 0));
+    setPixelColor(i, max(r - flicker, 0), max(g - flicker, 0), max(b - flicker, 0), max(w - flicker, 0));
   }
   return (SEGMENT.speed / SEGMENT_LENGTH);
 }
@@ -1277,26 +3416,31 @@ uint16_t WS2812FX::mode_fire_flicker_intense(void) {
  * Tricolor chase function
  */
 uint16_t WS2812FX::tricolor_chase(uint32_t color1, uint32_t color2, uint32_t color3) {
-  for(uint16_t i=0; i < SEGMENT_LENGTH; i++) {
-    if((i + SEGMENT_RUNTIME.counter_mode_step) % 6 < 2) {
-      if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color1);
-      } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color1);
-      }
-    } else if((i + SEGMENT_RUNTIME.counter_mode_step) % 6 < 4) {
-      if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color2);
-      } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color2);
-      }
-    } else {
-      if(SEGMENT.reverse) {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.start + i, color3);
+  if(!cache_load(SEGMENT_RUNTIME.counter_mode_step, 6)) {
+    uint16_t len = SEGMENT_LENGTH;
+    uint8_t phase = SEGMENT_RUNTIME.counter_mode_step % 6; // (i + step) % 6
+    for(uint16_t i=0; i < len; i++, phase = (phase == 5) ? 0 : phase + 1) {
+      if(phase < 2) {
+        if(SEGMENT.reverse) {
+          setPixelColor(SEGMENT.start + i, color1);
+        } else {
+          setPixelColor(SEGMENT.stop - i, color1);
+        }
+      } else if(phase < 4) {
+        if(SEGMENT.reverse) {
+          setPixelColor(SEGMENT.start + i, color2);
+        } else {
+          setPixelColor(SEGMENT.stop - i, color2);
+        }
       } else {
-        Adafruit_NeoPixel::setPixelColor(SEGMENT.stop - i, color3);
+        if(SEGMENT.reverse) {
+          setPixelColor(SEGMENT.start + i, color3);
+        } else {
+          setPixelColor(SEGMENT.stop - i, color3);
+        }
       }
     }
+    cache_store(SEGMENT_RUNTIME.counter_mode_step, 6);
   }
 
   SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) % 6;
@@ -1325,21 +3469,21 @@ uint16_t WS2812FX::mode_circus_combustus(void) {
 uint16_t WS2812FX::mode_icu() {
   uint16_t dest = SEGMENT_RUNTIME.counter_mode_step & 0xFFFF;
  
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest, SEGMENT.colors[0]);
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + dest, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, SEGMENT.colors[0]);
 
   if(SEGMENT_RUNTIME.aux_param == dest) { // pause between eye movements
     if(random(6) == 0) { // blink once in a while
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest, 0);
-      Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, 0);
+      setPixelColor(SEGMENT.start + dest, 0);
+      setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, 0);
       return 200;
     }
     SEGMENT_RUNTIME.aux_param = random(SEGMENT_LENGTH/2);
     return 1000 + random(2000);
   }
 
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest, 0);
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, 0);
+  setPixelColor(SEGMENT.start + dest, 0);
+  setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, 0);
 
   if(SEGMENT_RUNTIME.aux_param > SEGMENT_RUNTIME.counter_mode_step) {
     SEGMENT_RUNTIME.counter_mode_step++;
@@ -1349,21 +3493,509 @@ uint16_t WS2812FX::mode_icu() {
     dest--;
   }
 
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest, SEGMENT.colors[0]);
-  Adafruit_NeoPixel::setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + dest, SEGMENT.colors[0]);
+  setPixelColor(SEGMENT.start + dest + SEGMENT_LENGTH/2, SEGMENT.colors[0]);
 
   return (SEGMENT.speed / SEGMENT_LENGTH);
 }
 
+/*
+ * Plasma, three sine waves running across the matrix in different directions.
+ */
+uint16_t WS2812FX::mode_plasma_2d(void) {
+  uint16_t width = getMatrixWidth();
+  uint16_t height = getMatrixHeight();
+  uint8_t t = SEGMENT_RUNTIME.counter_mode_step;
+
+  for(uint16_t y=0; y < height; y++) {
+    uint8_t wave_y = sine8(y * 16 - t);
+    uint8_t diagonal = y * 8 + t * 2;
+    for(uint16_t x=0; x < width; x++) {
+      uint16_t i = XY(x, y);
+      if(i >= SEGMENT.start && i <= SEGMENT.stop) {
+        uint8_t v = (sine8(x * 16 + t) + wave_y + 2 * sine8(diagonal)) >> 2;
+        setPixelColor(i, palette_color(v));
+      }
+      diagonal += 8;
+    }
+  }
+
+  SEGMENT_RUNTIME.counter_mode_step++;
+  return (SEGMENT.speed / 256);
+}
+
+
+/*
+ * Text (see setText()) or a bitmap (see setBitmap()) scrolling from right
+ * to left in color 0 on color 1, vertically centered.
+ */
+uint16_t WS2812FX::mode_text_2d(void) {
+  uint16_t width = getMatrixWidth();
+  uint16_t height = getMatrixHeight();
+  uint16_t columns = _bitmap ? _bitmap_len : (_text ? strlen(_text) * 6 : 0);
+  int32_t first = (int32_t)SEGMENT_RUNTIME.counter_mode_step - width; // column shown at x = 0
+  int16_t top = ((int16_t)height - 8) / 2;
+
+  for(uint16_t y=0; y < height; y++) {
+    int16_t row = y - top;
+    uint8_t mask = (row >= 0 && row < 8) ? (1 << row) : 0;
+    int32_t col = first;
+    uint16_t ch = 0;   // character at col
+    uint8_t ch_col = 0; // column within that character, the 6th is the gap
+    if(col > 0) {
+      ch = col / 6;
+      ch_col = col % 6;
+    }
+
+    for(uint16_t x=0; x < width; x++, col++) {
+      bool on = false;
+      if(col >= 0 && col < columns) {
+        if(_bitmap) {
+          on = _bitmap[col] & mask;
+        } else {
+          uint8_t c = _text[ch];
+          if(c < ' ' || c > '~') c = '?';
+          on = (ch_col < 5) && (pgm_read_byte(&_font5x7[(c - ' ') * 5 + ch_col]) & mask);
+          if(++ch_col == 6) {
+            ch_col = 0;
+            ch++;
+          }
+        }
+      }
+
+      uint16_t i = XY(x, y);
+      if(i >= SEGMENT.start && i <= SEGMENT.stop) {
+        setPixelColor(i, on ? SEGMENT.colors[0] : SEGMENT.colors[1]);
+      }
+    }
+  }
+
+  SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) % (columns + width);
+  return (SEGMENT.speed / 16);
+}
+
+
+/*
+ * Cycles a rainbow diagonally across the matrix.
+ */
+uint16_t WS2812FX::mode_rainbow_2d(void) {
+  uint16_t width = getMatrixWidth();
+  uint16_t height = getMatrixHeight();
+  uint16_t dx = 0x10000UL / width; // hue steps in 1/256
+  uint16_t dy = 0x10000UL / height;
+  uint16_t hue_y = SEGMENT_RUNTIME.counter_mode_step << 8;
+
+  for(uint16_t y=0; y < height; y++, hue_y += dy) {
+    uint16_t hue = hue_y;
+    for(uint16_t x=0; x < width; x++, hue += dx) {
+      uint16_t i = XY(x, y);
+      if(i >= SEGMENT.start && i <= SEGMENT.stop) {
+        setPixelColor(i, palette_color(hue >> 8));
+      }
+    }
+  }
+
+  SEGMENT_RUNTIME.counter_mode_step = (SEGMENT_RUNTIME.counter_mode_step + 1) & 0xFF;
+  return (SEGMENT.speed / 256);
+}
+
+
+/*
+ * The bands of the audio input (see setAudio()) as bars side by side, low
+ * to high frequencies in rainbow colors, each lit as far as its level.
+ */
+uint16_t WS2812FX::mode_spectrum(void) {
+  uint16_t len = SEGMENT_LENGTH;
+  uint16_t k = 0;
+  for(uint8_t b=0; b < AUDIO_NUM_BANDS; b++) {
+    uint16_t end = ((uint32_t)len * (b + 1)) / AUDIO_NUM_BANDS; // once per bar
+    uint16_t lit = k + (((uint32_t)(end - k) * ((_audio != NULL) ? _audio->getBand(b) + 1 : 0)) >> 8);
+    uint32_t color = palette_color(b * (256 / AUDIO_NUM_BANDS));
+    for(; k < end; k++) {
+      setPixelColor(SEGMENT.reverse ? SEGMENT.stop - k : SEGMENT.start + k, (k < lit) ? color : BLACK);
+    }
+  }
+  return (SEGMENT.speed / 256);
+}
+
+
+/*
+ * Flashes the segment in color 0 on every beat of the audio input, fading
+ * out in between.
+ */
+uint16_t WS2812FX::mode_beat_pulse(void) {
+  uint16_t beats = (_audio != NULL) ? _audio->getBeats() : 0;
+  if(SEGMENT_RUNTIME.counter_mode_call > 0 && beats != SEGMENT_RUNTIME.aux_param) {
+    for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
+      setPixelColor(i, SEGMENT.colors[0]);
+    }
+  } else {
+    fade_out();
+  }
+  SEGMENT_RUNTIME.aux_param = beats; // a beat is seen once, however long the frame took
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Fire flickering in color 0, burning brighter and wilder with the bass of
+ * the audio input.
+ */
+uint16_t WS2812FX::mode_bass_fire(void) {
+  uint8_t bass = (_audio != NULL) ? _audio->getBass() : 0;
+  uint16_t scale = 64 + ((bass * 3) >> 2); // a small flame when quiet
+  byte w = (((SEGMENT.colors[0] >> 24) & 0xFF) * scale) >> 8;
+  byte r = (((SEGMENT.colors[0] >> 16) & 0xFF) * scale) >> 8;
+  byte g = (((SEGMENT.colors[0] >>  8) & 0xFF) * scale) >> 8;
+  byte b = (( SEGMENT.colors[0]        & 0xFF) * scale) >> 8;
+  byte lum = max(w, max(r, max(g, b))) >> ((bass > 128) ? 1 : 2);
+  for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
+    int flicker = random(0, lum);
+    setPixelColor(i, max(r - flicker, 0), max(g - flicker, 0), max(b - flicker, 0), max(w - flicker, 0));
+  }
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Gradient noise along the segment through the segment's palette or
+ * palette id, changing over time and drifting along by drift (1/256 of a
+ * noise cell per frame). dx is the step per LED, the features are about
+ * 256 / dx LEDs long.
+ */
+uint16_t WS2812FX::noise(uint8_t id, uint16_t dx, uint16_t drift, uint8_t octaves) {
+  uint16_t t = SEGMENT_RUNTIME.counter_mode_step;
+  uint16_t x = t * drift;
+  uint16_t z = t * 2; // a noise cell per 128 frames
+  uint8_t values[32]; // a chunk at a time, the lattice is only looked up once per cell
+  for(uint16_t i=0; i < SEGMENT_LENGTH; i += sizeof(values)) {
+    uint8_t n = min(SEGMENT_LENGTH - i, (int)sizeof(values));
+    WS2812FXNoise::fill(values, n, x + i * dx, dx, 0, z, octaves);
+    for(uint8_t k=0; k < n; k++) {
+      setPixelColor(SEGMENT.reverse ? SEGMENT.stop - i - k : SEGMENT.start + i + k, palette_color(values[k], id));
+    }
+  }
+  SEGMENT_RUNTIME.counter_mode_step++;
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Slowly bubbling blobs of lava.
+ */
+uint16_t WS2812FX::mode_noise_lava(void) {
+  return noise(PALETTE_LAVA, 20, 0, 2);
+}
+
+
+/*
+ * Waves in shades of blue and green rolling along the segment.
+ */
+uint16_t WS2812FX::mode_noise_ocean(void) {
+  return noise(PALETTE_OCEAN, 12, 3, 2);
+}
+
+
+/*
+ * Fluffy white clouds drifting slowly across a blue sky.
+ */
+uint16_t WS2812FX::mode_noise_clouds(void) {
+  return noise(PALETTE_CLOUD, 8, 1, 3);
+}
+
+
+/*
+ * The speed which takes a particle height high against gravity (both in
+ * 1/256 LED), the integer square root of 2 * gravity * height.
+ */
+static int16_t launch_speed(int16_t gravity, uint32_t height) {
+  uint32_t x = 2UL * gravity * height, root = 0;
+  for(uint32_t bit = 1UL << 30; bit > 0; bit >>= 2) {
+    if(x >= root + bit) {
+      x -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+  }
+  return min(root, (uint32_t)32767);
+}
+
+/*
+ * The particle pool of the segment being rendered, allocated if it has
+ * none. A mode starting on the segment begins with no particles and a
+ * dark segment, after that only the LEDs the particles were drawn on are
+ * touched. NULL if there isn't enough memory.
+ */
+WS2812FX::particle_pool* WS2812FX::particles(void) {
+  bool fresh = SEGMENT_RUNTIME.counter_mode_call == 0;
+  if(_pools[_segment_index] == NULL) {
+    if(!setParticles(_segment_index, DEFAULT_PARTICLES)) return NULL;
+    fresh = true;
+  }
+  particle_pool* pool = _pools[_segment_index];
+  if(fresh) {
+    pool->live = 0;
+    for(uint16_t i=SEGMENT.start; i <= SEGMENT.stop; i++) {
+      setPixelColor(i, BLACK);
+    }
+  }
+  return pool;
+}
+
+/*
+ * Adds a particle at pos (1/256 LED) moving by vel per frame, which loses
+ * decay of its brightness per frame and draws tail LEDs behind it. NULL if
+ * the pool is full.
+ */
+WS2812FX::particle* WS2812FX::particle_spawn(particle_pool* pool, int32_t pos, int16_t vel, uint32_t color, uint8_t decay, uint8_t tail) {
+  if(pool->live >= pool->size) return NULL;
+  particle* p = &pool->particles[pool->live++];
+  p->pos = pos;
+  p->vel = vel;
+  p->color = color;
+  p->life = 255;
+  p->decay = decay;
+  p->tail = tail;
+  p->type = 0;
+  p->drawn_len = 0;
+  return p;
+}
+
+/*
+ * Clears the LEDs the particles were drawn on, then moves them one frame,
+ * pulled towards the segment start by gravity. With bounce (the speed
+ * kept, in 1/256), they bounce off the start. Particles which faded out or
+ * left the segment are removed, the last one takes their place.
+ */
+void WS2812FX::particle_move(particle_pool* pool, int16_t gravity, uint8_t bounce) {
+  int32_t end = (int32_t)SEGMENT_LENGTH << 8;
+  for(uint16_t i=0; i < pool->live; ) {
+    particle* p = &pool->particles[i];
+    for(uint16_t k=p->drawn; k < p->drawn + p->drawn_len; k++) {
+      setPixelColor(SEGMENT.reverse ? SEGMENT.stop - k : SEGMENT.start + k, BLACK);
+    }
+
+    p->vel = constrain((int32_t)p->vel - gravity, -32767, 32767);
+    p->pos += p->vel;
+    if(bounce > 0 && p->pos < 0) {
+      p->pos = -p->pos;
+      p->vel = ((int32_t)-p->vel * bounce) >> 8;
+    }
+    p->life = (p->life > p->decay) ? p->life - p->decay : 0;
+
+    int32_t margin = ((int32_t)p->tail + 1) << 8;
+    if(p->life == 0 || p->pos < -margin || p->pos >= end + margin) {
+      *p = pool->particles[--pool->live];
+      continue;
+    }
+    i++;
+  }
+}
+
+/*
+ * Draws the particles, each head split between the two LEDs it's in
+ * between by its position within them, so they move smoothly by less than
+ * an LED per frame. The tail fades out behind it. Particles add up where
+ * they cross.
+ */
+void WS2812FX::particle_draw(particle_pool* pool) {
+  int32_t len = SEGMENT_LENGTH;
+  for(uint16_t i=0; i < pool->live; i++) {
+    particle* p = &pool->particles[i];
+    p->drawn_len = 0;
+    if(p->life == 0) continue;
+
+    int8_t dir = (p->vel > 0) ? -1 : 1; // where the tail is
+    if(p->vel == 0) p->tail = 0;
+    int32_t first = len, last = -1;
+    for(uint16_t k=0; k <= p->tail; k++) {
+      int32_t pos = p->pos + (int32_t)dir * k * 256;
+      int32_t led = pos >> 8;
+      uint8_t frac = pos & 0xFF;
+      uint8_t level = ((uint16_t)p->life * (p->tail + 1 - k)) / (p->tail + 1);
+      particle_add(led, p->color, ((uint16_t)level * (256 - frac)) >> 8);
+      particle_add(led + 1, p->color, ((uint16_t)level * frac) >> 8);
+      first = min(first, led);
+      last = max(last, led + 1);
+    }
+    first = max(first, (int32_t)0);
+    last = min(last, len - 1);
+    if(first <= last) {
+      p->drawn = first;
+      p->drawn_len = last - first + 1;
+    }
+  }
+}
+
+/*
+ * Adds color, scaled by scale / 256, to LED i of the segment.
+ */
+void WS2812FX::particle_add(int32_t i, uint32_t color, uint8_t scale) {
+  if(i < 0 || i >= SEGMENT_LENGTH || scale == 0) return;
+  uint16_t n = SEGMENT.reverse ? SEGMENT.stop - i : SEGMENT.start + i;
+  uint32_t c = getPixelColor(n);
+  uint32_t sum = 0;
+  for(uint8_t shift=0; shift < 32; shift += 8) {
+    uint16_t v = ((c >> shift) & 0xFF) + ((((color >> shift) & 0xFF) * scale) >> 8);
+    sum |= (uint32_t)min(v, (uint16_t)255) << shift;
+  }
+  setPixelColor(n, sum);
+}
+
+
+/*
+ * Comets in color 0 of different speeds and lengths, flying through one
+ * another.
+ */
+uint16_t WS2812FX::mode_multi_comet(void) {
+  particle_pool* pool = particles();
+  if(pool == NULL) return (SEGMENT.speed / 64);
+  particle_move(pool, 0, 0);
+  if(random(16) == 0 || SEGMENT_RUNTIME.trigger > 0) {
+    particle_spawn(pool, -256, 96 + random(160), SEGMENT.colors[0], 0, 4 + random(12));
+  }
+  particle_draw(pool);
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Meteors in random colors, falling from the end, speeding up and burning
+ * out on their way.
+ */
+uint16_t WS2812FX::mode_meteor_shower(void) {
+  particle_pool* pool = particles();
+  if(pool == NULL) return (SEGMENT.speed / 64);
+  particle_move(pool, 2, 0);
+  if(random(24) == 0 || SEGMENT_RUNTIME.trigger > 0) {
+    int32_t pos = (int32_t)SEGMENT_LENGTH << 8;
+    particle_spawn(pool, pos, -(64 + random(64)), palette_color(random(256)), 1 + random(3), 8 + random(16));
+  }
+  particle_draw(pool);
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Three balls in colors 0, 1 and 2, bouncing off the start of the segment
+ * to different heights and kicked up again once they come to rest.
+ */
+uint16_t WS2812FX::mode_bouncing_balls(void) {
+  particle_pool* pool = particles();
+  if(pool == NULL) return (SEGMENT.speed / 64);
+
+  // about 96 frames up for the highest ball, at most the segment's length
+  uint32_t height = (uint32_t)SEGMENT_LENGTH << 8;
+  int16_t gravity = max(1, (int)((height * 2) / (96 * 96)));
+  if(pool->live == 0) {
+    for(uint8_t i=0; i < 3; i++) {
+      particle* p = particle_spawn(pool, 0, 0, SEGMENT.colors[i], 0, 0);
+      if(p != NULL) p->type = i;
+    }
+  }
+  particle_move(pool, gravity, 230);
+  for(uint16_t i=0; i < pool->live; i++) {
+    particle* p = &pool->particles[i];
+    if(p->pos < 256 && p->vel >= 0 && p->vel < gravity * 16) {
+      p->vel = launch_speed(gravity, height - (height >> 2) * p->type / 2); // 100, 87 and 75%
+    }
+  }
+  particle_draw(pool);
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Rockets rising from the start of the segment, slowed down by gravity,
+ * bursting into sparks in random colors at the top, which fall back down
+ * and fade. A trigger launches a rocket, the more intense, the more
+ * sparks.
+ */
+uint16_t WS2812FX::mode_fireworks_rockets(void) {
+  particle_pool* pool = particles();
+  if(pool == NULL) return (SEGMENT.speed / 64);
+
+  // rockets rise for up to about 80 frames, 50 to 90% of the segment
+  uint32_t height = (uint32_t)SEGMENT_LENGTH << 8;
+  int16_t gravity = max(1, (int)((height * 2) / (80 * 80)));
+  particle_move(pool, gravity, 0);
+
+  bool flying = false;
+  for(uint16_t i=0; i < pool->live; i++) {
+    particle* p = &pool->particles[i];
+    if(p->type != 1) continue;
+    if(p->vel > 0) {
+      flying = true;
+      continue;
+    }
+    // the top: burst into sparks, the rocket is gone
+    uint8_t sparks = 8 + ((SEGMENT_RUNTIME.trigger > 0) ? SEGMENT_RUNTIME.trigger >> 4 : random(8));
+    uint32_t color = palette_color(random(256));
+    p->life = 0;
+    for(uint8_t k=0; k < sparks; k++) {
+      int16_t vel = random(-gravity * 32, gravity * 32 + 1);
+      particle_spawn(pool, p->pos, vel, color, 3 + random(4), 1);
+    }
+  }
+
+  if((!flying && random(32) == 0) || SEGMENT_RUNTIME.trigger > 0) {
+    particle* p = particle_spawn(pool, 0, launch_speed(gravity, height * random(50, 91) / 100), 0x806040, 0, 2);
+    if(p != NULL) p->type = 1;
+  }
+  particle_draw(pool);
+  return (SEGMENT.speed / 64);
+}
+
+
+/*
+ * Fire rising from the start of the segment: every LED has a heat, which
+ * cools down a little, drifts up, mixing with the heat below it, and is
+ * shown through the heat palette (or the segment's). Sparks near the start
+ * keep the fire going, a trigger adds a flare as strong as its intensity.
+ */
+uint16_t WS2812FX::mode_fire(void) {
+  uint16_t len = SEGMENT_LENGTH;
+  uint8_t* heat = segment_alloc(len);
+  if(heat == NULL) return (SEGMENT.speed / 64);
+
+  // cool down, short fires faster, so their flames stay short as well
+  uint8_t cooling = min(FIRE_COOLING * 10 / len + 2, 255);
+  uint16_t seed = random(65536); // per LED random() would cost more than the rest together
+  for(uint16_t i=0; i < len; i++) {
+    seed = seed * 2053 + 13849;
+    uint8_t c = ((seed >> 8) * cooling) >> 8;
+    heat[i] = (heat[i] > c) ? heat[i] - c : 0;
+  }
+
+  // heat drifts up: each LED gets the average of the one below and (twice)
+  // the one below that, top down, so it's done in place in a single pass
+  for(uint16_t i=len - 1; i >= 2; i--) {
+    heat[i] = ((heat[i - 1] + 2 * heat[i - 2]) * 85) >> 8;
+  }
+
+  uint8_t sparks = (random(256) < FIRE_SPARKING) ? 1 : 0;
+  if(SEGMENT_RUNTIME.trigger > 0) sparks += 1 + (SEGMENT_RUNTIME.trigger >> 6);
+  for(uint8_t k=0; k < sparks; k++) {
+    uint16_t i = random(min(len, (uint16_t)7));
+    heat[i] = min(heat[i] + random(160, 256), 255);
+  }
+
+  for(uint16_t i=0; i < len; i++) {
+    setPixelColor(SEGMENT.reverse ? SEGMENT.stop - i : SEGMENT.start + i, palette_color(heat[i], PALETTE_HEAT));
+  }
+  return (SEGMENT.speed / 64);
+}
+
+
 /*
  * Custom mode
  */
-uint16_t (*customMode)(void) = NULL;
 uint16_t WS2812FX::mode_custom() {
-  if(customMode == NULL) {
+  if(_custom_mode == NULL) {
     return 1000; // if custom mode not set, do nothing
   } else {
-    return customMode();
+    return _custom_mode();
   }
 }
 
@@ -1372,5 +4004,47 @@ uint16_t WS2812FX::mode_custom() {
  */
 void WS2812FX::setCustomMode(uint16_t (*p)()) {
   setMode(FX_MODE_CUSTOM);
-  customMode = p;
+  _custom_mode = p;
+}
+
+/*
+ * Adds a custom mode, which can then be used like the built-in ones, with
+ * the returned mode number (MODE_COUNT and up, 255 if there's no room left).
+ * fn is called with the span of the segment it runs on and user, and returns
+ * the delay until its next call in ms, just like the built-in modes. flags
+ * describe what the mode does (see getModeFlags()), the default promises
+ * nothing, so the mode is never skipped or cached.
+ */
+uint8_t WS2812FX::addCustomMode(const __FlashStringHelper* name, custom_mode_ptr fn, void* user, uint8_t flags) {
+  if(_num_custom_modes >= MAX_CUSTOM_MODES) return 255;
+  _custom_modes[_num_custom_modes].fn = fn;
+  _custom_modes[_num_custom_modes].user = user;
+  _custom_modes[_num_custom_modes].name = name;
+  _custom_modes[_num_custom_modes].flags = flags;
+  return MODE_COUNT + _num_custom_modes++;
+}
+
+/*
+ * Runs the registered custom mode of the current segment. It gets the
+ * segment's pixels (in the render buffer or its layer) to work on directly.
+ */
+uint16_t WS2812FX::run_custom_mode(void) {
+  uint8_t m = SEGMENT.mode - MODE_COUNT;
+  uint16_t len;
+  uint8_t *p = segment_pixels(len);
+  if(m >= _num_custom_modes || p == NULL) return 1000;
+
+  span s;
+  s.pixels = p;
+  s.length = len;
+  s.bpp = (wOffset == rOffset) ? 3 : 4;
+  s.rOffset = rOffset;
+  s.gOffset = gOffset;
+  s.bOffset = bOffset;
+  s.wOffset = wOffset;
+  s.seg = &SEGMENT;
+  s.runtime = &SEGMENT_RUNTIME;
+  s.palette = (_palettes[_segment_index] != NULL) ? &_palettes[_segment_index]->colors[0][0] : NULL;
+  _changed = true; // the mode writes to the pixels directly, so there's no telling
+  return _custom_modes[m].fn(s, _custom_modes[m].user);
 }
\ No newline at end of file
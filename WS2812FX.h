@@ -39,6 +39,9 @@
 
 #include <Adafruit_NeoPixel.h>
 
+class WS2812FXOutput; // see WS2812FXOutput.h
+class WS2812FXAudio;  // see WS2812FXAudio.h
+
 #define DEFAULT_BRIGHTNESS 50
 #define DEFAULT_MODE 0
 #define DEFAULT_SPEED 1000
@@ -50,14 +53,38 @@
 #define BRIGHTNESS_MIN 0
 #define BRIGHTNESS_MAX 255
 
-/* each segment uses 34 bytes of SRAM memory, so if you're application fails because of
-  insufficient memory, decreasing MAX_NUM_SEGMENTS may help */
+/* each segment uses about 45 bytes of SRAM memory, so if you're application fails because of
+  insufficient memory, decreasing MAX_NUM_SEGMENTS (or using StaticWS2812FX) may help */
 #define MAX_NUM_SEGMENTS 10
 #define NUM_COLORS 3     /* number of colors per segment */
+
+/* the fixed tables every instance has, in SRAM, can be made smaller (or larger) with build flags,
+  e.g. -DMAX_CUSTOM_MODES=2, defining them in the sketch won't do, the library has to see them */
+#ifndef MAX_NUM_OUTPUTS
+#define MAX_NUM_OUTPUTS 8 /* output drivers, see addOutput(), 4 bytes each (8 on 32 bit boards) */
+#endif
+#ifndef TRIGGER_QUEUE_SIZE
+#define TRIGGER_QUEUE_SIZE 8 /* trigger events waiting for service(), one less fit, 9 bytes each (12 on 32 bit boards) */
+#endif
+#define TRIGGER_ALL 0xFFFFFFFF /* segment mask of trigger(): every segment */
 #define SEGMENT          _segments[_segment_index]
 #define SEGMENT_RUNTIME  _segment_runtimes[_segment_index]
 #define SEGMENT_LENGTH   (SEGMENT.stop - SEGMENT.start + 1)
-#define RESET_RUNTIME    memset(_segment_runtimes, 0, sizeof(_segment_runtimes))
+#define RESET_RUNTIME    if(_segment_runtimes) memset(_segment_runtimes, 0, _max_segments * sizeof(segment_runtime))
+
+// segment options (see setSegmentOptions())
+#define SEGMENT_OPTION_MIRROR 0x08
+#define SEGMENT_GROUP(s)      (((s).options & 0x07) + 1)
+#define SEGMENT_MIRROR(s)     ((s).options & SEGMENT_OPTION_MIRROR)
+#define SEGMENT_CLONE(s)      ((s).options >> 4) /* index of the source segment + 1, 0 = no clone */
+#define NO_CLONE              0xFF
+
+// layer blend modes (see setSegmentLayer())
+#define BLEND_NONE   0 /* not a layer, the segment draws directly */
+#define BLEND_ALPHA  1
+#define BLEND_ADD    2
+#define BLEND_SCREEN 3
+#define BLEND_MAX    4
 
 // some common colors
 #define RED        0xFF0000
@@ -72,7 +99,42 @@
 #define ORANGE     0xFF3000
 #define ULTRAWHITE 0xFFFFFFFF
 
-#define MODE_COUNT 57
+#define MODE_COUNT 71
+#ifndef MAX_CUSTOM_MODES
+#define MAX_CUSTOM_MODES 8 /* modes added with addCustomMode(), numbered from MODE_COUNT on, 7 bytes each (16 on 32 bit boards) */
+#endif
+
+// mode flags (see getModeFlags()), what a mode does with the segment it runs on
+#define FX_COLORS(n)     (n)  /* uses the first n segment colors, 0 to 3 */
+#define FX_COLORS_MASK   0x03
+#define FX_READS_PIXELS  0x04 /* builds the next frame on the pixels of the last one */
+#define FX_SPARSE        0x08 /* only draws some pixels per frame, the others keep their color */
+#define FX_RANDOM        0x10 /* not deterministic, the same settings give different frames */
+#define FX_STATIC        0x20 /* the frame only depends on the segment's settings, service() keeps counter_mode_step */
+#define FX_PERIODIC      0x40 /* frames repeat, see setFrameCache() */
+#define FX_MATRIX        0x80 /* needs setMatrix() */
+#define FX_CUSTOM_FLAGS  (FX_COLORS(3) | FX_READS_PIXELS | FX_SPARSE | FX_RANDOM) /* nothing known */
+
+// palettes (see setPalette()), used by the modes which otherwise take their colors from the color wheel
+#define PALETTE_NONE         0 /* the color wheel */
+#define PALETTE_RAINBOW      1
+#define PALETTE_PARTY        2
+#define PALETTE_OCEAN        3
+#define PALETTE_FOREST       4
+#define PALETTE_LAVA         5
+#define PALETTE_HEAT         6
+#define PALETTE_CLOUD        7
+#define PALETTE_COUNT        8
+#define PALETTE_STOPS        16 /* colors of a palette, spread evenly over its 256 entries */
+#define PALETTE_FADE_ENTRIES 64 /* entries a crossfade moves per frame, see fadeToPalette() */
+
+// particles (see setParticles()), used by the particle modes
+#define MAX_PARTICLES     256 /* per segment */
+#define DEFAULT_PARTICLES 32  /* the pool a particle mode gets if none was set */
+
+// the Fire mode
+#define FIRE_COOLING  55  /* how fast the heat cools down, higher gives shorter flames */
+#define FIRE_SPARKING 120 /* the chance of a new spark per frame, out of 256 */
 
 #define FX_MODE_STATIC                   0
 #define FX_MODE_BLINK                    1
@@ -130,7 +192,34 @@
 #define FX_MODE_BICOLOR_CHASE           53
 #define FX_MODE_TRICOLOR_CHASE          54
 #define FX_MODE_ICU                     55
-#define FX_MODE_CUSTOM                  56
+#define FX_MODE_CUSTOM                  56 /* numbers stay as they are, new modes are added at the end */
+#define FX_MODE_PLASMA_2D               57
+#define FX_MODE_TEXT_2D                 58
+#define FX_MODE_RAINBOW_2D              59
+#define FX_MODE_SPECTRUM                60
+#define FX_MODE_BEAT_PULSE              61
+#define FX_MODE_BASS_FIRE               62
+#define FX_MODE_NOISE_LAVA              63
+#define FX_MODE_NOISE_OCEAN             64
+#define FX_MODE_NOISE_CLOUDS            65
+#define FX_MODE_MULTI_COMET             66
+#define FX_MODE_METEOR_SHOWER           67
+#define FX_MODE_BOUNCING_BALLS          68
+#define FX_MODE_FIREWORKS_ROCKETS       69
+#define FX_MODE_FIRE                    70
+
+// matrix layouts (see setMatrix()), a serpentine layout plus one rotation
+#define MATRIX_ROWS              0x00 /* every row runs left to right */
+#define MATRIX_SERPENTINE        0x01 /* every other row runs right to left */
+#define MATRIX_ROTATE_0          0x00
+#define MATRIX_ROTATE_90         0x02 /* the matrix is mounted turned clockwise */
+#define MATRIX_ROTATE_180        0x04
+#define MATRIX_ROTATE_270        0x06
+#define MATRIX_PANELS_SERPENTINE 0x08 /* tiled panels: every other row of panels runs right to left */
+
+static_assert(MAX_NUM_OUTPUTS < 256, "MAX_NUM_OUTPUTS must be less than 256");
+static_assert(TRIGGER_QUEUE_SIZE > 1 && TRIGGER_QUEUE_SIZE <= 256, "TRIGGER_QUEUE_SIZE must be 2 to 256");
+static_assert(MODE_COUNT + MAX_CUSTOM_MODES < 255, "MAX_CUSTOM_MODES is too large, mode numbers are 8 bit and 255 is no mode");
 
 class WS2812FX : public Adafruit_NeoPixel {
 
@@ -145,157 +234,157 @@ class WS2812FX : public Adafruit_NeoPixel {
       uint16_t start;
       uint16_t stop;
       bool     reverse;
+      uint8_t  options; // group size - 1 (bits 0-2), mirror (bit 3), clone source + 1 (bits 4-7)
     } segment;
 
+  // pattern parameters: a set of segments shown for a while at its own brightness
+    typedef struct pattern {
+      uint8_t  brightness;
+      uint16_t duration; // in seconds
+      uint8_t  numSegments;
+      segment  segments[MAX_NUM_SEGMENTS];
+    } pattern;
+
+  // layer parameters
+  typedef struct layer {
+    uint8_t* pixels;
+    uint16_t len;
+    uint8_t  blend;
+    uint8_t  opacity;
+  } layer;
+
+  // an output driver showing part of the LEDs, see addOutput()
+  typedef struct output_channel {
+    WS2812FXOutput* driver;
+    uint16_t first; // the LED shown by its first pixel
+  } output_channel;
+
+  // frames of a periodic mode, see setFrameCache()
+  typedef struct frame_cache {
+    uint8_t* frames;
+    uint16_t budget;    // the most the frames may take, in bytes
+    uint16_t size;      // bytes allocated
+    uint8_t  mode;      // what the frames were rendered for
+    bool     reverse;
+    uint16_t len;
+    uint32_t colors[NUM_COLORS];
+    uint16_t base_step; // the step of the frame kept, when the others are rotations of it
+    uint8_t  valid[32]; // one bit per step
+  } frame_cache;
+
+  // a segment's palette, expanded, see setPalette()
+  typedef struct palette {
+    uint8_t  colors[256][3];          // r, g, b
+    uint32_t target[PALETTE_STOPS];   // what a crossfade moves the colors towards
+    uint8_t  fade_step;               // the most a channel moves per frame, 0 = not fading
+    uint8_t  fade_pos;                // the next entry to move
+    bool     fade_moved;              // an entry moved during this pass
+    bool     fade_free;               // fading to PALETTE_NONE, free it when done
+  } palette;
+
+  // a particle of the particle modes, positions and speeds in 1/256 LED
+  typedef struct particle {
+    int32_t  pos;       // of the head, from the segment start
+    int16_t  vel;       // per frame
+    uint32_t color;
+    uint8_t  life;      // brightness, gone at 0
+    uint8_t  decay;     // life lost per frame
+    uint8_t  tail;      // LEDs behind the head, fading out
+    uint8_t  type;      // what the mode uses it for
+    uint16_t drawn;     // the LEDs drawn in the last frame, cleared in the next
+    uint16_t drawn_len;
+  } particle;
+
+  // a segment's particles, the live ones first, see setParticles()
+  typedef struct particle_pool {
+    particle* particles;
+    uint16_t  size;
+    uint16_t  live;
+  } particle_pool;
+
+  // the memory a segment's mode keeps its state in (e.g. the heat of Fire),
+  // handed out anew every frame in the same order, see setSegmentMemory()
+  typedef struct segment_arena {
+    uint8_t* data;
+    uint16_t size;
+    uint16_t used; // in this frame
+  } segment_arena;
+
   // segment runtime parameters
   typedef struct segment_runtime {
     uint32_t counter_mode_step;
     uint32_t counter_mode_call;
     unsigned long next_time;
     uint16_t aux_param;
+    uint8_t trigger; // intensity of a pending trigger(), 0 = none
   } segment_runtime;
 
+  // the pixels of a segment as handed to a custom mode, bpp bytes per pixel in the strip's color order
+  typedef struct span {
+    uint8_t* pixels;
+    uint16_t length;
+    uint8_t  bpp, rOffset, gOffset, bOffset, wOffset;
+    segment* seg;             // colors, speed and direction
+    segment_runtime* runtime; // counters, free for the mode to use
+    uint8_t* palette;         // 256 entries of r, g, b (see setPalette()), NULL = none
+
+    void setPixel(uint16_t i, uint32_t c) {
+      uint8_t *p = pixels + i * bpp;
+      if(bpp == 4) p[wOffset] = c >> 24;
+      p[rOffset] = c >> 16;
+      p[gOffset] = c >> 8;
+      p[bOffset] = c;
+    }
+
+    uint32_t getPixel(uint16_t i) {
+      uint8_t *p = pixels + i * bpp;
+      return ((bpp == 4) ? (uint32_t)p[wOffset] << 24 : 0) | ((uint32_t)p[rOffset] << 16) | ((uint32_t)p[gOffset] << 8) | p[bOffset];
+    }
+  } span;
+
+  // counters of service(), see getStats()
+  typedef struct stats {
+    uint32_t frames;      // frames rendered
+    uint32_t shows;       // frames sent to the LEDs
+    uint32_t shows_saved; // frames not sent, because no pixel changed
+    uint32_t max_service_us; // the longest service() call
+    uint32_t cache_hits;     // frames copied from a frame cache
+    uint32_t cache_misses;   // frames rendered to fill a frame cache
+    uint32_t triggers;         // trigger events handed to the segments
+    uint32_t triggers_dropped; // trigger events lost, the queue was full
+    uint32_t trigger_latency_us;     // from the oldest trigger of a frame to the show() of that frame
+    uint32_t max_trigger_latency_us; // the longest of those
+  } stats;
+
+  // a trigger() waiting for service()
+  typedef struct trigger_event {
+    uint32_t segments;
+    uint32_t time; // micros() when it arrived
+    uint8_t intensity;
+  } trigger_event;
+
+  typedef uint16_t (*custom_mode_ptr)(span& s, void* user);
+
+  typedef struct custom_mode {
+    custom_mode_ptr fn;
+    void* user;
+    const __FlashStringHelper* name;
+    uint8_t flags;
+  } custom_mode;
+
   public:
 
     WS2812FX(uint16_t n, uint8_t p, neoPixelType t) : Adafruit_NeoPixel(n, p, t) {
-      _mode[FX_MODE_STATIC]                  = &WS2812FX::mode_static;
-      _mode[FX_MODE_BLINK]                   = &WS2812FX::mode_blink;
-      _mode[FX_MODE_COLOR_WIPE]              = &WS2812FX::mode_color_wipe;
-      _mode[FX_MODE_COLOR_WIPE_INV]          = &WS2812FX::mode_color_wipe_inv;
-      _mode[FX_MODE_COLOR_WIPE_REV]          = &WS2812FX::mode_color_wipe_rev;
-      _mode[FX_MODE_COLOR_WIPE_REV_INV]      = &WS2812FX::mode_color_wipe_rev_inv;
-      _mode[FX_MODE_COLOR_WIPE_RANDOM]       = &WS2812FX::mode_color_wipe_random;
-      _mode[FX_MODE_RANDOM_COLOR]            = &WS2812FX::mode_random_color;
-      _mode[FX_MODE_SINGLE_DYNAMIC]          = &WS2812FX::mode_single_dynamic;
-      _mode[FX_MODE_MULTI_DYNAMIC]           = &WS2812FX::mode_multi_dynamic;
-      _mode[FX_MODE_RAINBOW]                 = &WS2812FX::mode_rainbow;
-      _mode[FX_MODE_RAINBOW_CYCLE]           = &WS2812FX::mode_rainbow_cycle;
-      _mode[FX_MODE_SCAN]                    = &WS2812FX::mode_scan;
-      _mode[FX_MODE_DUAL_SCAN]               = &WS2812FX::mode_dual_scan;
-      _mode[FX_MODE_FADE]                    = &WS2812FX::mode_fade;
-      _mode[FX_MODE_THEATER_CHASE]           = &WS2812FX::mode_theater_chase;
-      _mode[FX_MODE_THEATER_CHASE_RAINBOW]   = &WS2812FX::mode_theater_chase_rainbow;
-      _mode[FX_MODE_TWINKLE]                 = &WS2812FX::mode_twinkle;
-      _mode[FX_MODE_TWINKLE_RANDOM]          = &WS2812FX::mode_twinkle_random;
-      _mode[FX_MODE_TWINKLE_FADE]            = &WS2812FX::mode_twinkle_fade;
-      _mode[FX_MODE_TWINKLE_FADE_RANDOM]     = &WS2812FX::mode_twinkle_fade_random;
-      _mode[FX_MODE_SPARKLE]                 = &WS2812FX::mode_sparkle;
-      _mode[FX_MODE_FLASH_SPARKLE]           = &WS2812FX::mode_flash_sparkle;
-      _mode[FX_MODE_HYPER_SPARKLE]           = &WS2812FX::mode_hyper_sparkle;
-      _mode[FX_MODE_STROBE]                  = &WS2812FX::mode_strobe;
-      _mode[FX_MODE_STROBE_RAINBOW]          = &WS2812FX::mode_strobe_rainbow;
-      _mode[FX_MODE_MULTI_STROBE]            = &WS2812FX::mode_multi_strobe;
-      _mode[FX_MODE_BLINK_RAINBOW]           = &WS2812FX::mode_blink_rainbow;
-      _mode[FX_MODE_CHASE_WHITE]             = &WS2812FX::mode_chase_white;
-      _mode[FX_MODE_CHASE_COLOR]             = &WS2812FX::mode_chase_color;
-      _mode[FX_MODE_CHASE_RANDOM]            = &WS2812FX::mode_chase_random;
-      _mode[FX_MODE_CHASE_RAINBOW]           = &WS2812FX::mode_chase_rainbow;
-      _mode[FX_MODE_CHASE_FLASH]             = &WS2812FX::mode_chase_flash;
-      _mode[FX_MODE_CHASE_FLASH_RANDOM]      = &WS2812FX::mode_chase_flash_random;
-      _mode[FX_MODE_CHASE_RAINBOW_WHITE]     = &WS2812FX::mode_chase_rainbow_white;
-      _mode[FX_MODE_CHASE_BLACKOUT]          = &WS2812FX::mode_chase_blackout;
-      _mode[FX_MODE_CHASE_BLACKOUT_RAINBOW]  = &WS2812FX::mode_chase_blackout_rainbow;
-      _mode[FX_MODE_COLOR_SWEEP_RANDOM]      = &WS2812FX::mode_color_sweep_random;
-      _mode[FX_MODE_RUNNING_COLOR]           = &WS2812FX::mode_running_color;
-      _mode[FX_MODE_RUNNING_RED_BLUE]        = &WS2812FX::mode_running_red_blue;
-      _mode[FX_MODE_RUNNING_RANDOM]          = &WS2812FX::mode_running_random;
-      _mode[FX_MODE_LARSON_SCANNER]          = &WS2812FX::mode_larson_scanner;
-      _mode[FX_MODE_COMET]                   = &WS2812FX::mode_comet;
-      _mode[FX_MODE_FIREWORKS]               = &WS2812FX::mode_fireworks;
-      _mode[FX_MODE_FIREWORKS_RANDOM]        = &WS2812FX::mode_fireworks_random;
-      _mode[FX_MODE_MERRY_CHRISTMAS]         = &WS2812FX::mode_merry_christmas;
-      _mode[FX_MODE_HALLOWEEN]               = &WS2812FX::mode_halloween;
-      _mode[FX_MODE_FIRE_FLICKER]            = &WS2812FX::mode_fire_flicker;
-      _mode[FX_MODE_FIRE_FLICKER_SOFT]       = &WS2812FX::mode_fire_flicker_soft;
-      _mode[FX_MODE_FIRE_FLICKER_INTENSE]    = &WS2812FX::mode_fire_flicker_intense;
-      _mode[FX_MODE_CIRCUS_COMBUSTUS]        = &WS2812FX::mode_circus_combustus;
-      _mode[FX_MODE_BICOLOR_CHASE]           = &WS2812FX::mode_bicolor_chase;
-      _mode[FX_MODE_TRICOLOR_CHASE]          = &WS2812FX::mode_tricolor_chase;
-// if flash memory is constrained (I'm looking at you Arduino Nano), replace modes
-// that use a lot of flash with mode_static (reduces flash footprint by about 3600 bytes)
-#ifdef REDUCED_MODES
-      _mode[FX_MODE_BREATH]                  = &WS2812FX::mode_static;
-      _mode[FX_MODE_RUNNING_LIGHTS]          = &WS2812FX::mode_static;
-      _mode[FX_MODE_ICU]                     = &WS2812FX::mode_static;
-#else
-      _mode[FX_MODE_BREATH]                  = &WS2812FX::mode_breath;
-      _mode[FX_MODE_RUNNING_LIGHTS]          = &WS2812FX::mode_running_lights;
-      _mode[FX_MODE_ICU]                     = &WS2812FX::mode_icu;
-#endif
-      _mode[FX_MODE_CUSTOM]                  = &WS2812FX::mode_custom;
-
-      _name[FX_MODE_STATIC]                    = F("Static");
-      _name[FX_MODE_BLINK]                     = F("Blink");
-      _name[FX_MODE_BREATH]                    = F("Breath");
-      _name[FX_MODE_COLOR_WIPE]                = F("Color Wipe");
-      _name[FX_MODE_COLOR_WIPE_INV ]           = F("Color Wipe Inverse");
-      _name[FX_MODE_COLOR_WIPE_REV]            = F("Color Wipe Reverse");
-      _name[FX_MODE_COLOR_WIPE_REV_INV]        = F("Color Wipe Reverse Inverse");
-      _name[FX_MODE_COLOR_WIPE_RANDOM]         = F("Color Wipe Random");
-      _name[FX_MODE_RANDOM_COLOR]              = F("Random Color");
-      _name[FX_MODE_SINGLE_DYNAMIC]            = F("Single Dynamic");
-      _name[FX_MODE_MULTI_DYNAMIC]             = F("Multi Dynamic");
-      _name[FX_MODE_RAINBOW]                   = F("Rainbow");
-      _name[FX_MODE_RAINBOW_CYCLE]             = F("Rainbow Cycle");
-      _name[FX_MODE_SCAN]                      = F("Scan");
-      _name[FX_MODE_DUAL_SCAN]                 = F("Dual Scan");
-      _name[FX_MODE_FADE]                      = F("Fade");
-      _name[FX_MODE_THEATER_CHASE]             = F("Theater Chase");
-      _name[FX_MODE_THEATER_CHASE_RAINBOW]     = F("Theater Chase Rainbow");
-      _name[FX_MODE_RUNNING_LIGHTS]            = F("Running Lights");
-      _name[FX_MODE_TWINKLE]                   = F("Twinkle");
-      _name[FX_MODE_TWINKLE_RANDOM]            = F("Twinkle Random");
-      _name[FX_MODE_TWINKLE_FADE]              = F("Twinkle Fade");
-      _name[FX_MODE_TWINKLE_FADE_RANDOM]       = F("Twinkle Fade Random");
-      _name[FX_MODE_SPARKLE]                   = F("Sparkle");
-      _name[FX_MODE_FLASH_SPARKLE]             = F("Flash Sparkle");
-      _name[FX_MODE_HYPER_SPARKLE]             = F("Hyper Sparkle");
-      _name[FX_MODE_STROBE]                    = F("Strobe");
-      _name[FX_MODE_STROBE_RAINBOW]            = F("Strobe Rainbow");
-      _name[FX_MODE_MULTI_STROBE]              = F("Multi Strobe");
-      _name[FX_MODE_BLINK_RAINBOW]             = F("Blink Rainbow");
-      _name[FX_MODE_CHASE_WHITE]               = F("Chase White");
-      _name[FX_MODE_CHASE_COLOR]               = F("Chase Color");
-      _name[FX_MODE_CHASE_RANDOM]              = F("Chase Random");
-      _name[FX_MODE_CHASE_RAINBOW]             = F("Chase Rainbow");
-      _name[FX_MODE_CHASE_FLASH]               = F("Chase Flash");
-      _name[FX_MODE_CHASE_FLASH_RANDOM]        = F("Chase Flash Random");
-      _name[FX_MODE_CHASE_RAINBOW_WHITE]       = F("Chase Rainbow White");
-      _name[FX_MODE_CHASE_BLACKOUT]            = F("Chase Blackout");
-      _name[FX_MODE_CHASE_BLACKOUT_RAINBOW]    = F("Chase Blackout Rainbow");
-      _name[FX_MODE_COLOR_SWEEP_RANDOM]        = F("Color Sweep Random");
-      _name[FX_MODE_RUNNING_COLOR]             = F("Running Color");
-      _name[FX_MODE_RUNNING_RED_BLUE]          = F("Running Red Blue");
-      _name[FX_MODE_RUNNING_RANDOM]            = F("Running Random");
-      _name[FX_MODE_LARSON_SCANNER]            = F("Larson Scanner");
-      _name[FX_MODE_COMET]                     = F("Comet");
-      _name[FX_MODE_FIREWORKS]                 = F("Fireworks");
-      _name[FX_MODE_FIREWORKS_RANDOM]          = F("Fireworks Random");
-      _name[FX_MODE_MERRY_CHRISTMAS]           = F("Merry Christmas");
-      _name[FX_MODE_HALLOWEEN]                 = F("Halloween");
-      _name[FX_MODE_FIRE_FLICKER]              = F("Fire Flicker");
-      _name[FX_MODE_FIRE_FLICKER_SOFT]         = F("Fire Flicker (soft)");
-      _name[FX_MODE_FIRE_FLICKER_INTENSE]      = F("Fire Flicker (intense)");
-      _name[FX_MODE_CIRCUS_COMBUSTUS]          = F("Circus Combustus");
-      _name[FX_MODE_BICOLOR_CHASE]             = F("Bicolor Chase");
-      _name[FX_MODE_TRICOLOR_CHASE]            = F("Tricolor Chase");
-      _name[FX_MODE_ICU]                       = F("ICU");
-      _name[FX_MODE_CUSTOM]                    = F("Custom");
-
-      _brightness = DEFAULT_BRIGHTNESS;
-      _running = false;
-      _num_segments = 1;
-      _segments[0].mode = DEFAULT_MODE;
-      _segments[0].colors[0] = DEFAULT_COLOR;
-      _segments[0].start = 0;
-      _segments[0].stop = n - 1;
-      _segments[0].speed = DEFAULT_SPEED;
-      RESET_RUNTIME;
+      alloc_segments();
+      setup(n);
+      alloc_pixels();
     }
 
+    ~WS2812FX();
+
     void
       init(void),
-      service(void),
+      service(uint16_t budget_us = 0),
       start(void),
       stop(void),
       setMode(uint8_t m),
@@ -311,39 +400,167 @@ class WS2812FX : public Adafruit_NeoPixel {
       setLength(uint16_t b),
       increaseLength(uint16_t s),
       decreaseLength(uint16_t s),
-      trigger(void),
+      trigger(uint32_t segments = TRIGGER_ALL, uint8_t intensity = 255),
       setNumSegments(uint8_t n),
       setSegment(uint8_t n, uint16_t start, uint16_t stop, uint8_t mode, uint32_t color,   uint16_t speed, bool reverse),
       setSegment(uint8_t n, uint16_t start, uint16_t stop, uint8_t mode, const uint32_t colors[], uint16_t speed, bool reverse),
-      resetSegments();
+      resetSegments(),
+      nextPattern(void),
+      setGamma(float g),
+      setColorCorrection(uint32_t c),
+      setMaxCurrent(uint32_t mA),
+      setPowerModel(uint8_t channel_mA, uint8_t idle_mA),
+      setAudio(WS2812FXAudio* audio),
+      setPixelColor(uint16_t n, uint32_t c),
+      setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
+      setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w),
+      clear(void),
+      show(void),
+      setMatrix(uint16_t w, uint16_t h, uint8_t layout = MATRIX_ROWS, uint8_t panelsX = 1, uint8_t panelsY = 1),
+      setPixelColorXY(uint16_t x, uint16_t y, uint32_t c),
+      setSegmentOptions(uint8_t n, uint8_t group, bool mirror, uint8_t clone = NO_CLONE),
+      setText(const char* text),
+      setBitmap(const uint8_t* columns, uint16_t n),
+      shift(uint8_t n, int16_t k),
+      setFrameCache(uint8_t n, uint16_t bytes),
+      resetStats(void);
 
     boolean
       isRunning(void);
 
+    bool
+      addOutput(WS2812FXOutput& driver, uint16_t first),
+      outputs_ready(void),
+      setPalette(uint8_t n, uint8_t id),
+      setCustomPalette(uint8_t n, const uint32_t* colors),
+      fadeToPalette(uint8_t n, uint8_t id, uint8_t step = 4),
+      fadeToCustomPalette(uint8_t n, const uint32_t* colors, uint8_t step = 4),
+      setParticles(uint8_t n, uint16_t count),
+      setSegmentMemory(uint8_t n, uint16_t bytes),
+      setSegmentLayer(uint8_t n, uint8_t blend, uint8_t opacity = 255),
+      setPlaylist(pattern* patterns, uint8_t n);
+
     uint8_t
       getMode(void),
       getBrightness(void),
       getModeCount(void),
-      getNumSegments(void);
+      getNumSegments(void),
+      getMaxSegments(void),
+      getPatternIndex(void),
+      getNumOutputs(void),
+      getModeFlags(uint8_t m),
+      addCustomMode(const __FlashStringHelper* name, custom_mode_ptr fn, void* user = NULL, uint8_t flags = FX_CUSTOM_FLAGS);
 
     uint16_t
+      setPixelBuffer(uint8_t* buf, uint16_t bytes),
+      getCapacity(void),
       getSpeed(void),
-      getLength(void);
+      getLength(void),
+      getMatrixWidth(void),
+      getMatrixHeight(void),
+      getParticleCount(uint8_t n),
+      getSegmentMemory(uint8_t n),
+      XY(uint16_t x, uint16_t y);
 
     uint32_t
       color_wheel(uint8_t),
-      getColor(void);
+      getColor(void),
+      getColorCorrection(void),
+      getPowerEstimate(void),
+      getPaletteColor(uint8_t n, uint8_t i),
+      getPixelColor(uint16_t n) const;
+
+    float
+      getGamma(void);
+
+    size_t
+      printModesJSON(Print& p),
+      printModeFlagsJSON(Print& p),
+      printStateJSON(Print& p),
+      getStateJSONLength(void);
 
     const __FlashStringHelper*
       getModeName(uint8_t m);
 
+    const __FlashStringHelper*
+      getModesJSON(void);
+
     WS2812FX::segment*
       getSegments(void);
 
+    const WS2812FX::stats&
+      getStats(void);
+
+    WS2812FXAudio*
+      getAudio(void);
+
+  protected:
+    // all storage supplied by the caller, see StaticWS2812FX
+    WS2812FX(uint16_t n, uint8_t p, neoPixelType t, uint8_t* buf, uint8_t* render, uint8_t max_segments,
+      segment* segments, segment_runtime* runtimes, layer* layers, frame_cache** caches, palette** palettes,
+      particle_pool** pools, segment_arena* arenas);
+
   private:
     void
+      setup(uint16_t n),
+      alloc_segments(void),
       strip_off(void),
-      fade_out(void);
+      service_time(unsigned long start),
+      palette_fade(uint8_t n),
+      palette_colors(uint8_t id, uint32_t* colors),
+      process_triggers(void),
+      trigger_latency(void),
+      fade_out(void),
+      particle_move(particle_pool* pool, int16_t gravity, uint8_t bounce),
+      particle_draw(particle_pool* pool),
+      particle_add(int32_t i, uint32_t color, uint8_t scale),
+      load_pattern(uint8_t n, unsigned long now),
+      stage_pattern(uint8_t n),
+      clear_kept_pixels(void),
+      build_lut(void),
+      output(void),
+      limit_power(void),
+      show_outputs(void),
+      cache_store(uint16_t step, uint16_t period, int8_t rotate = 0);
+
+    bool
+      alloc_pixels(void),
+      alloc_length(uint16_t n),
+      cache_load(uint16_t step, uint16_t period, int8_t rotate = 0),
+      prepare_layer(uint8_t n),
+      layer_visible(uint8_t n),
+      palette_start(uint8_t n, const uint32_t* colors, uint8_t step);
+
+    uint8_t*
+      pixel_address(uint16_t n) const;
+
+    uint8_t*
+      segment_pixels(uint16_t& len);
+
+    frame_cache*
+      segment_cache(uint16_t period, int8_t rotate);
+
+    particle_pool*
+      particles(void);
+
+    uint8_t*
+      segment_alloc(uint16_t bytes);
+
+    particle*
+      particle_spawn(particle_pool* pool, int32_t pos, int16_t vel, uint32_t color, uint8_t decay, uint8_t tail);
+
+    uint16_t
+      segment_logical_length(segment& seg);
+
+    int32_t
+      expand_segments(bool summing);
+
+    uint32_t
+      segment_signature(void),
+      palette_color(uint8_t pos),
+      palette_color(uint8_t pos, uint8_t id),
+      power_estimate(uint32_t sum),
+      output_span(uint16_t from, uint16_t to, bool summing);
 
     uint16_t
       mode_static(void),
@@ -412,29 +629,162 @@ class WS2812FX : public Adafruit_NeoPixel {
       mode_bicolor_chase(void),
       mode_tricolor_chase(void),
       mode_icu(void),
-      mode_custom(void);
+      mode_plasma_2d(void),
+      mode_text_2d(void),
+      mode_rainbow_2d(void),
+      mode_spectrum(void),
+      mode_beat_pulse(void),
+      mode_bass_fire(void),
+      noise(uint8_t id, uint16_t dx, uint16_t drift, uint8_t octaves),
+      mode_noise_lava(void),
+      mode_noise_ocean(void),
+      mode_noise_clouds(void),
+      mode_multi_comet(void),
+      mode_meteor_shower(void),
+      mode_bouncing_balls(void),
+      mode_fireworks_rockets(void),
+      mode_fire(void),
+      mode_custom(void),
+      run_custom_mode(void);
 
     boolean
-      _running,
-      _triggered;
+      _running;
 
     uint8_t
       get_random_wheel_index(uint8_t),
+      sine8(uint8_t),
       _brightness;
 
-    const __FlashStringHelper*
-      _name[MODE_COUNT]; // SRAM footprint: 2 bytes per element
-
     mode_ptr
       _mode[MODE_COUNT]; // SRAM footprint: 4 bytes per element
 
     uint8_t _segment_index = 0;
+    bool _rendering = false; // a mode is running on _segments[_segment_index]
     uint8_t _num_segments = 1;
-    segment _segments[MAX_NUM_SEGMENTS] = { // SRAM footprint: 20 bytes per element
-      // mode, color[], speed, start, stop, reverse
-      { FX_MODE_STATIC, {DEFAULT_COLOR}, DEFAULT_SPEED, 0, 7, false}
-    };
-    segment_runtime _segment_runtimes[MAX_NUM_SEGMENTS]; // SRAM footprint: 14 bytes per element
+
+    // the segment tables, _max_segments entries each, allocated once by the
+    // runtime sized WS2812FX or supplied by StaticWS2812FX
+    uint8_t _max_segments = 0;
+    bool _own_segments = false;
+    segment* _segment_table = NULL; // SRAM footprint: 21 bytes per element
+    segment* _segments = NULL;      // the active segments, either our own or the current pattern's
+    segment* _pattern_segments = NULL; // two tables, the current pattern's and the next one's, copied from the playlist
+    segment_runtime* _segment_runtimes = NULL; // SRAM footprint: 15 bytes per element
+    layer* _layers = NULL;          // by segment index
+    frame_cache** _caches = NULL;   // by segment index, NULL if off
+    palette** _palettes = NULL;     // by segment index, NULL = the color wheel
+    particle_pool** _pools = NULL;  // by segment index, allocated by the first particle mode
+    segment_arena* _arenas = NULL;  // by segment index, grown by the modes as they need
+    uint16_t _capacity = 0;         // LEDs the supplied pixel buffers hold, 0 = allocated by the library
+    uint16_t _blank_len = 0;        // LEDs cut off by setLength() are switched off by sending this many
+
+    // modes render into _pixels (same layout as the NeoPixel buffer), show() converts
+    // it into the NeoPixel buffer, applying brightness, gamma and white balance
+    uint8_t* _pixels = NULL;
+    uint8_t* _lut = NULL; // one 256 byte table per color channel and the gamma curve, only used for gamma/white balance
+    float _lut_gamma = 0.0; // the gamma of the curve in _lut
+    bool _lut_dirty = true;
+    bool _changed = true; // the render buffer or output settings changed since the last show()
+    bool _drawn = false; // pixels were drawn outside of the modes (clear(), setPixelColor() from the sketch)
+    stats _stats = {};
+
+    uint8_t _service_segment = 0; // where service() continues a frame it ran out of time for
+    bool _service_show = false;   // a segment of the frame was rendered, so it has to be sent
+    unsigned long _service_time = 0; // when the frame was started
+
+    // trigger() writes _trigger_head with interrupts off, service() only
+    // _trigger_tail, so both the loop and interrupt handlers can trigger
+    volatile trigger_event _trigger_queue[TRIGGER_QUEUE_SIZE];
+    volatile uint8_t _trigger_head = 0;
+    volatile uint8_t _trigger_tail = 0;
+    bool _trigger_frame = false;   // the frame being rendered answers triggers
+    uint32_t _trigger_time = 0;    // when the oldest of them arrived
+
+    float _gamma = 1.0;
+    uint32_t _correction = 0xFFFFFFFF;
+
+    uint8_t _channel_current = 20; // mA per color channel at full level
+    uint8_t _idle_current = 1;     // mA per LED, when dark
+    uint32_t _max_current = 0;     // power budget in mA, 0 = no limit
+    uint32_t _power = 0;           // estimate of the last frame in mA
+    uint16_t _limit = 256;         // the limiter's share of the brightness, 256 = full
+    bool _limit_changed = false;   // service() sends the frame again
+
+    uint16_t (*_custom_mode)(void) = NULL; // see setCustomMode()
+    custom_mode _custom_modes[MAX_CUSTOM_MODES];
+    uint8_t _num_custom_modes = 0;
+
+    output_channel _outputs[MAX_NUM_OUTPUTS] = {};
+    uint8_t _num_outputs = 0;
+    WS2812FXAudio* _audio = NULL; // analyzed by service(), read by the sound reactive modes
+
+    uint8_t* _target = NULL; // while a layer renders: its buffer, the first pixel and the length
+    uint16_t _target_start = 0;
+    uint16_t _target_len = 0;
+
+    uint16_t* _matrix_map = NULL; // LED index of every matrix position, row by row
+    uint16_t _matrix_width = 0;
+    uint16_t _matrix_height = 0;
+    const char* _text = NULL;
+    const uint8_t* _bitmap = NULL;
+    uint16_t _bitmap_len = 0;
+
+    pattern* _playlist = NULL;
+    uint8_t _playlist_len = 0;
+    uint8_t _table_num_segments = 1;
+    uint8_t _pattern_index = 0;
+    uint8_t _staged_pattern = 0xFF;      // the pattern in the table not playing, 0xFF = none
+    uint8_t _staged_num_segments = 1;
+    uint8_t _staged_brightness = 0;
+    bool _pattern_switch = false;
+    unsigned long _pattern_time = 0;
+};
+
+/*
+ * The storage of StaticWS2812FX. It's a base class of its own, so it is
+ * initialized before WS2812FX, which sets up the tables in its constructor.
+ */
+template<uint16_t LEDS, uint8_t SEGMENTS, neoPixelType TYPE>
+class WS2812FXStorage {
+  protected:
+    static const uint8_t BPP = (((TYPE >> 6) & 0x03) == ((TYPE >> 4) & 0x03)) ? 3 : 4;
+
+    uint8_t _static_buf[LEDS * BPP] = {};    // the NeoPixel buffer
+    uint8_t _static_render[LEDS * BPP] = {}; // the render buffer
+    WS2812FX::segment _static_segments[SEGMENTS] = {};
+    WS2812FX::segment_runtime _static_runtimes[SEGMENTS] = {};
+    WS2812FX::layer _static_layers[SEGMENTS] = {};
+    WS2812FX::frame_cache* _static_caches[SEGMENTS] = {};
+    WS2812FX::palette* _static_palettes[SEGMENTS] = {};
+    WS2812FX::particle_pool* _static_pools[SEGMENTS] = {};
+    WS2812FX::segment_arena _static_arenas[SEGMENTS] = {};
+};
+
+/*
+ * WS2812FX with its size fixed at compile time: LEDS pixels with the color
+ * order TYPE and up to SEGMENTS segments. The pixel buffers and segment
+ * tables are part of the object, sized exactly, so the heap isn't used
+ * (unless gamma/white balance, layers, frame caches, palettes, particles,
+ * mode state like the heat of Fire, a matrix or a playlist are).
+ * setLength() can only shrink the strip. Everything else works like WS2812FX:
+ *   StaticWS2812FX<60, 2> ws2812fx(LED_PIN); // 60 GRB LEDs, 2 segments
+ */
+template<uint16_t LEDS, uint8_t SEGMENTS = 1, neoPixelType TYPE = NEO_GRB + NEO_KHZ800>
+class StaticWS2812FX : private WS2812FXStorage<LEDS, SEGMENTS, TYPE>, public WS2812FX {
+
+  static_assert(LEDS > 0, "StaticWS2812FX needs at least one LED");
+  static_assert(SEGMENTS > 0 && SEGMENTS <= MAX_NUM_SEGMENTS, "StaticWS2812FX needs 1 to MAX_NUM_SEGMENTS segments");
+
+  typedef WS2812FXStorage<LEDS, SEGMENTS, TYPE> storage;
+
+  public:
+    StaticWS2812FX(uint8_t p) : storage(), WS2812FX(LEDS, p, TYPE, storage::_static_buf, storage::_static_render,
+      SEGMENTS, storage::_static_segments, storage::_static_runtimes, storage::_static_layers, storage::_static_caches,
+      storage::_static_palettes, storage::_static_pools, storage::_static_arenas) {}
+
+    // these would replace the static buffers with allocated ones
+    void updateLength(uint16_t n) = delete;
+    void updateType(neoPixelType t) = delete;
 };
 
 #endif
@@ -0,0 +1,270 @@
+/*
+  WS2812FXAudio.cpp - Audio analysis for the sound reactive WS2812FX modes.
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+
+  FIXED POINT
+
+    The window and the twiddle factors are Q15 (32767 = 1.0). Every FFT
+    stage halves its results, so nothing overflows, the bins come out
+    divided by 64. Levels are compared as log2 in 8.8 fixed point (256 =
+    one octave = about 6dB), which needs no division.
+*/
+
+#include "WS2812FXAudio.h"
+
+// first half of a Hann window over 64 samples, the second half mirrors it
+static const uint16_t _hann[AUDIO_FFT_SIZE / 2] PROGMEM = {
+      0,    81,   325,   728,  1286,  1995,  2847,  3833,  4944,  6169,  7495,  8909, 10398, 11946, 13539, 15159,
+  16792, 18421, 20029, 21601, 23122, 24575, 25947, 27224, 28393, 29443, 30363, 31145, 31779, 32260, 32584, 32747
+};
+
+// sin(2 * PI * k / 64) for a quarter wave, k = 0..16
+static const uint16_t _sine[AUDIO_FFT_SIZE / 4 + 1] PROGMEM = {
+  0, 3212, 6393, 9512, 12539, 15446, 18204, 20787, 23170, 25329, 27245, 28898, 30273, 31356, 32137, 32609, 32767
+};
+
+// the first FFT bin of each band, the last entry ends the last band
+static const uint8_t _band_bins[AUDIO_NUM_BANDS + 1] PROGMEM = {1, 2, 3, 4, 6, 9, 13, 19, 32};
+
+/*
+ * sin(2 * PI * k / 64) for k = 0..63
+ */
+static int16_t sine_q15(uint8_t k) {
+  k &= AUDIO_FFT_SIZE - 1;
+  if(k <= 16) return  (int16_t)pgm_read_word(&_sine[k]);
+  if(k <= 32) return  (int16_t)pgm_read_word(&_sine[32 - k]);
+  if(k <= 48) return -(int16_t)pgm_read_word(&_sine[k - 32]);
+  return -(int16_t)pgm_read_word(&_sine[64 - k]);
+}
+
+WS2812FXAudio::WS2812FXAudio(uint16_t sampleRate) : _sample_rate(sampleRate) {
+  reset();
+}
+
+/*
+ * Can be called from an interrupt handler (or the loop, not both).
+ */
+void WS2812FXAudio::addSample(int16_t s) {
+  uint16_t w = _written;
+  _ring[w & (AUDIO_FFT_SIZE - 1)] = s;
+  _written = w + 1;
+}
+
+void WS2812FXAudio::addSamples(const int16_t* s, uint16_t n) {
+  for(uint16_t i=0; i < n; i++) {
+    addSample(s[i]);
+  }
+}
+
+void WS2812FXAudio::reset(void) {
+  noInterrupts();
+  for(uint8_t i=0; i < AUDIO_FFT_SIZE; i++) _ring[i] = 0;
+  _written = 0;
+  interrupts();
+  _analyzed = 0;
+  memset(_bands, 0, sizeof(_bands));
+  _level = 0;
+  _peak = AUDIO_MIN_PEAK;
+  _bass_avg = 0;
+  _high_avg = 0;
+  _since_beat = 0;
+  _beat = false;
+  _beats = 0;
+  _windows = 0;
+}
+
+/*
+ * Analyzes the latest window, if half of its samples are new. Returns true
+ * if it did, the results are kept until the next window.
+ */
+bool WS2812FXAudio::analyze(void) {
+  noInterrupts();
+  uint16_t written = _written; // 16 bits can't be read in one go everywhere
+  interrupts();
+  uint16_t fresh = written - _analyzed;
+  if(fresh < AUDIO_FFT_SIZE / 2) return false;
+  _analyzed = written;
+  _since_beat = (_since_beat > 0xFFFF - fresh) ? 0xFFFF : _since_beat + fresh;
+  _windows++;
+
+  // the window, without its DC offset
+  int16_t re[AUDIO_FFT_SIZE], im[AUDIO_FFT_SIZE];
+  int32_t sum = 0;
+  for(uint8_t i=0; i < AUDIO_FFT_SIZE; i++) {
+    re[i] = _ring[(written + i) & (AUDIO_FFT_SIZE - 1)]; // oldest first
+    sum += re[i];
+  }
+  int16_t mean = sum >> AUDIO_FFT_LOG2;
+  for(uint8_t i=0; i < AUDIO_FFT_SIZE; i++) {
+    uint16_t w = pgm_read_word(&_hann[(i < AUDIO_FFT_SIZE / 2) ? i : AUDIO_FFT_SIZE - 1 - i]);
+    int32_t x = (int32_t)re[i] - mean;
+    re[i] = (x * w) >> 16; // Q14, leaves room for the butterflies
+    im[i] = 0;
+  }
+
+  fft(re, im);
+
+  // bands: sum of the bin magnitudes (max + 3/8 min, close enough to the root)
+  uint16_t logs[AUDIO_NUM_BANDS];
+  uint32_t total = 0, bass = 0, high = 0;
+  uint16_t loudest = 0;
+  uint8_t bin = pgm_read_byte(&_band_bins[0]);
+  for(uint8_t b=0; b < AUDIO_NUM_BANDS; b++) {
+    uint8_t end = pgm_read_byte(&_band_bins[b + 1]);
+    uint32_t energy = 0;
+    for(; bin < end; bin++) {
+      uint16_t r = abs(re[bin]), i = abs(im[bin]);
+      uint16_t hi = max(r, i), lo = min(r, i);
+      energy += hi + (lo >> 2) + (lo >> 3);
+    }
+    if(b < 2) bass += energy; else high += energy;
+    total += energy;
+    logs[b] = log2_8_8(energy);
+    loudest = max(loudest, logs[b]);
+  }
+
+  // automatic gain: follow the loudest band up at once, down slowly
+  _peak = max((uint16_t)(_peak - AUDIO_PEAK_DECAY), loudest);
+  _peak = max(_peak, (uint16_t)AUDIO_MIN_PEAK);
+
+  for(uint8_t b=0; b < AUDIO_NUM_BANDS; b++) {
+    uint8_t level = band_level(logs[b]);
+    _bands[b] = max(level, (uint8_t)((_bands[b] > AUDIO_FALL) ? _bands[b] - AUDIO_FALL : 0));
+  }
+  _level = band_level(log2_8_8(total >> 3)); // about the level of an average band
+
+  // beat: the bass jumps well above its average, more than the rest does
+  // (a clap or hi-hat lifts all bands), at most 4 per second
+  int16_t bass_log = log2_8_8(bass), high_log = log2_8_8(high);
+  if(_bass_avg == 0) {
+    _bass_avg = bass_log;
+    _high_avg = high_log;
+  }
+  int16_t rise = (bass_log - _bass_avg) - max(high_log - _high_avg, 0);
+  _beat = rise > AUDIO_BEAT_RISE && getBass() >= AUDIO_BEAT_LEVEL && _since_beat >= _sample_rate / 4;
+  if(_beat) {
+    _beats++;
+    _since_beat = 0;
+  }
+  _bass_avg += (bass_log - _bass_avg) >> 4;
+  _high_avg += (high_log - _high_avg) >> 4;
+  return true;
+}
+
+/*
+ * In place radix 2 FFT, decimation in time, every stage scaled by 1/2.
+ */
+void WS2812FXAudio::fft(int16_t* re, int16_t* im) {
+  for(uint8_t i=1, j=0; i < AUDIO_FFT_SIZE; i++) { // bit reversed order
+    uint8_t bit = AUDIO_FFT_SIZE >> 1;
+    for(; j & bit; bit >>= 1) j ^= bit;
+    j |= bit;
+    if(i < j) {
+      int16_t t = re[i]; re[i] = re[j]; re[j] = t; // im is all zero still
+    }
+  }
+
+  for(uint8_t stage=1; stage <= AUDIO_FFT_LOG2; stage++) {
+    uint8_t half = 1 << (stage - 1);
+    uint8_t step = AUDIO_FFT_SIZE >> stage; // twiddle index step
+    for(uint8_t k=0; k < half; k++) {
+      int32_t wr = sine_q15(k * step + AUDIO_FFT_SIZE / 4); // cos
+      int32_t wi = -sine_q15(k * step);
+      for(uint8_t i=k; i < AUDIO_FFT_SIZE; i += half << 1) {
+        uint8_t j = i + half;
+        int16_t tr = (wr * re[j] - wi * im[j]) >> 15;
+        int16_t ti = (wr * im[j] + wi * re[j]) >> 15;
+        re[j] = (re[i] - tr) >> 1;
+        im[j] = (im[i] - ti) >> 1;
+        re[i] = (re[i] + tr) >> 1;
+        im[i] = (im[i] + ti) >> 1;
+      }
+    }
+  }
+}
+
+/*
+ * Maps a log2 level onto 0..255, covering AUDIO_RANGE below the peak.
+ */
+uint8_t WS2812FXAudio::band_level(uint16_t l) {
+  uint16_t floor = _peak - AUDIO_RANGE;
+  if(l <= floor) return 0;
+  return min((l - floor) >> 3, 255);
+}
+
+/*
+ * log2(x) in 8.8 fixed point, the fraction interpolated linearly.
+ */
+uint16_t WS2812FXAudio::log2_8_8(uint32_t x) {
+  if(x == 0) return 0;
+  uint8_t n = 31;
+  while(!(x & 0x80000000UL)) {
+    x <<= 1;
+    n--;
+  }
+  return ((uint16_t)n << 8) | (uint8_t)(x >> 23);
+}
+
+bool WS2812FXAudio::isBeat(void) {
+  return _beat;
+}
+
+uint8_t WS2812FXAudio::getBand(uint8_t b) {
+  return (b < AUDIO_NUM_BANDS) ? _bands[b] : 0;
+}
+
+uint8_t WS2812FXAudio::getBass(void) {
+  return max(_bands[0], _bands[1]);
+}
+
+uint8_t WS2812FXAudio::getLevel(void) {
+  return _level;
+}
+
+const uint8_t* WS2812FXAudio::getBands(void) {
+  return _bands;
+}
+
+uint16_t WS2812FXAudio::getSampleRate(void) {
+  return _sample_rate;
+}
+
+/*
+ * The lower edge of band b in Hz.
+ */
+uint16_t WS2812FXAudio::getBandFrequency(uint8_t b) {
+  b = min(b, (uint8_t)AUDIO_NUM_BANDS);
+  return ((uint32_t)pgm_read_byte(&_band_bins[b]) * _sample_rate) >> AUDIO_FFT_LOG2;
+}
+
+uint32_t WS2812FXAudio::getBeats(void) {
+  return _beats;
+}
+
+uint32_t WS2812FXAudio::getWindows(void) {
+  return _windows;
+}
@@ -0,0 +1,116 @@
+/*
+  WS2812FXAudio.h - Audio analysis for the sound reactive WS2812FX modes.
+
+  FEATURES
+    * Samples go into a ring buffer, e.g. from an ADC interrupt or an I2S
+      callback, the analysis runs later in the loop
+    * 64 point fixed point FFT (Hann window, 16 bit integers, no floats)
+    * 8 frequency bands, logarithmically spaced, with automatic gain:
+      levels 0..255 cover 48dB below the loudest recent band
+    * Beat detection on the bass bands
+    * Analyzed once for all segments: WS2812FX::setAudio() makes service()
+      run analyze() at the start of every frame, the modes (Spectrum, Beat
+      Pulse, Bass Fire) only read the results
+
+  NOTES
+    * The bands depend on the sample rate: band b starts at
+      getBandFrequency(b), the bins of the FFT are sample rate / 64 Hz
+      wide. 4 to 10kHz suit the usual ADCs, the lowest band then starts
+      at 62 to 156Hz.
+    * A new window is analyzed once half of its samples are new. If
+      analyze() isn't called that often, the windows in between are
+      skipped.
+
+  LICENSE
+  The MIT License (MIT)
+  Copyright (c) 2016  Harm Aldick
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#ifndef WS2812FXAudio_h
+#define WS2812FXAudio_h
+
+#include <Arduino.h>
+
+#define AUDIO_FFT_SIZE   64   /* samples per window, the tables are made for 64 */
+#define AUDIO_FFT_LOG2   6
+#define AUDIO_NUM_BANDS  8
+#define AUDIO_RANGE      2048 /* 48dB (8 octaves in log2 8.8 fixed point), mapped to 0..255 */
+#define AUDIO_PEAK_DECAY 4    /* per window, how fast the gain comes back after loud parts */
+#define AUDIO_MIN_PEAK   (AUDIO_RANGE + 4 * 256) /* silence stays dark instead of amplifying noise */
+#define AUDIO_FALL       8    /* per window, how fast band levels fall */
+#define AUDIO_BEAT_RISE  256  /* bass this much (6dB) above its average is a beat */
+#define AUDIO_BEAT_LEVEL 96   /* ... and at least this loud (within 30dB of the loudest band) */
+
+class WS2812FXAudio {
+
+  public:
+    WS2812FXAudio(uint16_t sampleRate);
+
+    // signed 16 bit samples (e.g. (analogRead(pin) - 512) << 6), any DC offset is removed
+    void
+      addSample(int16_t s),
+      addSamples(const int16_t* s, uint16_t n),
+      reset(void);
+
+    bool
+      analyze(void),
+      isBeat(void);
+
+    uint8_t
+      getBand(uint8_t b),
+      getBass(void),
+      getLevel(void);
+
+    const uint8_t*
+      getBands(void);
+
+    uint16_t
+      getSampleRate(void),
+      getBandFrequency(uint8_t b);
+
+    uint32_t
+      getBeats(void),
+      getWindows(void);
+
+  private:
+    void
+      fft(int16_t* re, int16_t* im);
+
+    uint8_t
+      band_level(uint16_t l);
+
+    static uint16_t
+      log2_8_8(uint32_t x);
+
+    uint16_t _sample_rate;
+    volatile int16_t _ring[AUDIO_FFT_SIZE];
+    volatile uint16_t _written = 0; // samples added, the ring index is the lower bits
+    uint16_t _analyzed = 0;         // _written when the last window was analyzed
+
+    uint8_t _bands[AUDIO_NUM_BANDS] = {};
+    uint8_t _level = 0;
+    uint16_t _peak = AUDIO_MIN_PEAK; // loudest recent band, log2 8.8
+    int16_t _bass_avg = 0;           // average of the bass bands, log2 8.8
+    int16_t _high_avg = 0;           // ... and of the others
+    uint16_t _since_beat = 0;        // samples
+    bool _beat = false;
+    uint32_t _beats = 0;
+    uint32_t _windows = 0;
+};
+
+#endif
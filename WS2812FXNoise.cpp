@@ -0,0 +1,151 @@
+/*
+  WS2812FXNoise.cpp - Integer gradient noise for the organic WS2812FX modes.
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+
+  FIXED POINT
+
+    Positions within a cell and the fade curve are 0..255 (256 = one cell).
+    Every lattice point gets one of the 8 gradients (+-1, +-1, +-1) from its
+    hash. Along a row (y and z fixed) the y and z parts of the 4 corners of
+    an x plane interpolate to a straight line in x, so fill() works that
+    line out once per lattice plane and per LED only evaluates the two
+    lines and blends them.
+*/
+
+#include "WS2812FXNoise.h"
+
+#define NOISE_SCALE 160 /* raw values rarely leave +-256, stretched so their extremes clip (0.1%) */
+
+// Ken Perlin's permutation of 0..255, the hash of the lattice points
+static const uint8_t _perm[256] PROGMEM = {
+  151,160,137, 91, 90, 15,131, 13,201, 95, 96, 53,194,233,  7,225,140, 36,103, 30, 69,142,  8, 99, 37,240, 21, 10, 23,190,  6,148,
+  247,120,234, 75,  0, 26,197, 62, 94,252,219,203,117, 35, 11, 32, 57,177, 33, 88,237,149, 56, 87,174, 20,125,136,171,168, 68,175,
+   74,165, 71,134,139, 48, 27,166, 77,146,158,231, 83,111,229,122, 60,211,133,230,220,105, 92, 41, 55, 46,245, 40,244,102,143, 54,
+   65, 25, 63,161,  1,216, 80, 73,209, 76,132,187,208, 89, 18,169,200,196,135,130,116,188,159, 86,164,100,109,198,173,186,  3, 64,
+   52,217,226,250,124,123,  5,202, 38,147,118,126,255, 82, 85,212,207,206, 59,227, 47, 16, 58, 17,182,189, 28, 42,223,183,170,213,
+  119,248,152,  2, 44,154,163, 70,221,153,101,155,167, 43,172,  9,129, 22, 39,253, 19, 98,108,110, 79,113,224,232,178,185,112,104,
+  218,246, 97,228,251, 34,242,193,238,210,144, 12,191,179,162,241, 81, 51,145,235,249, 14,239,107, 49,192,214, 31,181,199,106,157,
+  184, 84,204,176,115,121, 50, 45,127,  4,150,254,138,236,205, 93,222,114, 67, 29, 24, 72,243,141,128,195, 78, 66,215, 61,156,180
+};
+
+#define PERM(i) pgm_read_byte(&_perm[(uint8_t)(i)])
+
+static int16_t lerp(int16_t a, int16_t b, uint8_t s) {
+  return a + (((int32_t)(b - a) * s) >> 8);
+}
+
+/*
+ * Smoothstep, 3t^2 - 2t^3: the noise eases in and out of every lattice point.
+ */
+uint8_t WS2812FXNoise::fade(uint8_t t) {
+  return ((uint32_t)t * t * (768 - 2 * t)) >> 16;
+}
+
+/*
+ * The y and z parts of the corners of plane X, blended with the fade of y
+ * and z (sy, sz): a line in the distance from the plane.
+ */
+WS2812FXNoise::plane WS2812FXNoise::lattice_plane(uint8_t X, uint16_t y, uint16_t z, uint8_t sy, uint8_t sz) {
+  uint8_t hx = PERM(X);
+  uint8_t hy0 = PERM(hx + (y >> 8)), hy1 = PERM(hx + (y >> 8) + 1);
+  uint8_t h[4] = {PERM(hy0 + (z >> 8)), PERM(hy0 + (z >> 8) + 1), PERM(hy1 + (z >> 8)), PERM(hy1 + (z >> 8) + 1)};
+  int16_t dy0 = y & 0xFF, dz0 = z & 0xFF;
+
+  int16_t slope[4], offset[4];
+  for(uint8_t c=0; c < 4; c++) {
+    int16_t dy = (c & 2) ? dy0 - 256 : dy0;
+    int16_t dz = (c & 1) ? dz0 - 256 : dz0;
+    slope[c] = (h[c] & 1) ? -256 : 256;
+    offset[c] = ((h[c] & 2) ? -dy : dy) + ((h[c] & 4) ? -dz : dz);
+  }
+  plane p;
+  p.slope = lerp(lerp(slope[0], slope[1], sz), lerp(slope[2], slope[3], sz), sy);
+  p.offset = lerp(lerp(offset[0], offset[1], sz), lerp(offset[2], offset[3], sz), sy);
+  return p;
+}
+
+uint8_t WS2812FXNoise::noise8(uint16_t x) {
+  return noise8(x, 0, 0);
+}
+
+uint8_t WS2812FXNoise::noise8(uint16_t x, uint16_t y) {
+  return noise8(x, y, 0);
+}
+
+uint8_t WS2812FXNoise::noise8(uint16_t x, uint16_t y, uint16_t z) {
+  uint8_t n;
+  fill_octave(&n, 1, x, 0, y, z, 256);
+  return n;
+}
+
+/*
+ * Octaves (1 to NOISE_MAX_OCTAVES) of noise summed, each twice as fine and
+ * half as strong as the one before.
+ */
+uint8_t WS2812FXNoise::fractal8(uint16_t x, uint16_t y, uint16_t z, uint8_t octaves) {
+  uint8_t n;
+  fill(&n, 1, x, 0, y, z, octaves);
+  return n;
+}
+
+void WS2812FXNoise::fill(uint8_t* out, uint16_t n, uint16_t x, uint16_t dx, uint16_t y, uint16_t z, uint8_t octaves) {
+  octaves = constrain(octaves, 1, NOISE_MAX_OCTAVES);
+  for(uint8_t o=0; o < octaves; o++) {
+    // octave o weighs 1 / 2^o, blended into the sum of the ones before,
+    // and is shifted so the lattice points of the octaves don't coincide
+    uint16_t shift = o * 0x2B7;
+    fill_octave(out, n, (x << o) + shift, dx << o, (y << o) + shift, (z << o) + shift, 256 / ((2 << o) - 1));
+  }
+}
+
+/*
+ * One octave of noise along a row, blended into out (256 replaces it).
+ */
+void WS2812FXNoise::fill_octave(uint8_t* out, uint16_t n, uint16_t x, uint16_t dx, uint16_t y, uint16_t z, uint16_t blend) {
+  uint8_t sy = fade(y & 0xFF), sz = fade(z & 0xFF);
+  uint8_t X = x >> 8;
+  plane p0 = lattice_plane(X, y, z, sy, sz);
+  plane p1 = lattice_plane(X + 1, y, z, sy, sz);
+
+  for(uint16_t i=0; i < n; i++, x += dx) {
+    if((uint8_t)(x >> 8) != X) { // the next cell, the planes move along
+      if((uint8_t)(x >> 8) == (uint8_t)(X + 1)) {
+        p0 = p1;
+      } else {
+        p0 = lattice_plane(x >> 8, y, z, sy, sz);
+      }
+      X = x >> 8;
+      p1 = lattice_plane(X + 1, y, z, sy, sz);
+    }
+    int16_t u = x & 0xFF;
+    int16_t v0 = p0.offset + (((int32_t)p0.slope * u) >> 8);
+    int16_t v1 = p1.offset + (((int32_t)p1.slope * (u - 256)) >> 8);
+    int16_t v = 128 + (((int32_t)lerp(v0, v1, fade(u)) * NOISE_SCALE) >> 8);
+    v = constrain(v, 0, 255);
+    out[i] = (blend >= 256) ? v : out[i] + (((v - out[i]) * (int16_t)blend) >> 8);
+  }
+}
@@ -0,0 +1,78 @@
+/*
+  WS2812FXNoise.h - Integer gradient noise for the organic WS2812FX modes.
+
+  FEATURES
+    * 1D, 2D and 3D gradient (Perlin) noise, integers only
+    * Several octaves summed (fractal noise) for finer detail
+    * fill() works out a whole row of values at once: the lattice is
+      evaluated once per noise cell, each LED costs only an interpolation
+    * Used by the Noise Lava, Noise Ocean and Noise Clouds modes, custom
+      modes can call it as well
+
+  NOTES
+    * Coordinates are 8.8 fixed point: the upper byte selects the lattice
+      cell, the lower byte is the position within it. The noise repeats
+      every 256 cells, so coordinates wrap around seamlessly.
+    * Results are 0..255, 128 on average. Features are about one cell
+      wide, so e.g. a step of 16 (1/16 cell) per LED gives blobs about 16
+      LEDs long.
+
+  LICENSE
+  The MIT License (MIT)
+  Copyright (c) 2016  Harm Aldick
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#ifndef WS2812FXNoise_h
+#define WS2812FXNoise_h
+
+#include <Arduino.h>
+
+#define NOISE_MAX_OCTAVES 4
+
+class WS2812FXNoise {
+
+  public:
+    static uint8_t
+      noise8(uint16_t x),
+      noise8(uint16_t x, uint16_t y),
+      noise8(uint16_t x, uint16_t y, uint16_t z),
+      fractal8(uint16_t x, uint16_t y, uint16_t z, uint8_t octaves);
+
+    // n values from x on in steps of dx, at y and z
+    static void
+      fill(uint8_t* out, uint16_t n, uint16_t x, uint16_t dx, uint16_t y, uint16_t z, uint8_t octaves = 1);
+
+  private:
+    // the noise on the plane of lattice x = X, within the cell at y, z:
+    // slope * (distance from the plane) + offset
+    typedef struct plane {
+      int16_t slope;
+      int16_t offset;
+    } plane;
+
+    static plane
+      lattice_plane(uint8_t X, uint16_t y, uint16_t z, uint8_t sy, uint8_t sz);
+
+    static void
+      fill_octave(uint8_t* out, uint16_t n, uint16_t x, uint16_t dx, uint16_t y, uint16_t z, uint16_t blend);
+
+    static uint8_t
+      fade(uint8_t t);
+};
+
+#endif
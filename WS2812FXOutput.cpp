@@ -0,0 +1,209 @@
+/*
+  WS2812FXOutput.cpp - Output drivers for WS2812FX.
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+
+  DDP PACKET LAYOUT
+
+    byte 0      flags: version 1 (0x40), push (0x01) on the last packet of a frame
+    byte 1      sequence number (1..15)
+    byte 2      data type: RGB, 8 bits per color (0x0B)
+    byte 3      destination id: the default output device (1)
+    byte 4..7   offset of the data within the frame in bytes, big endian
+    byte 8..9   length of the data in bytes, big endian
+    data        R, G, B per pixel
+*/
+
+#include "WS2812FXOutput.h"
+
+#define DDP_HEADER_SIZE 10
+#define DDP_FLAGS_VER1  0x40
+#define DDP_FLAGS_PUSH  0x01
+#define DDP_TYPE_RGB24  0x0B
+#define DDP_ID_DISPLAY  1
+
+/*
+ * Tells the color order of the strip from where the bytes of a known color
+ * end up. A 3 byte strip leaves the byte after the first pixel alone.
+ */
+void NeoPixelOutput::begin(void) {
+  _strip.begin();
+  _format = FORMAT_UNKNOWN;
+  if(_strip.numPixels() < 2) return;
+
+  _strip.clear();
+  _strip.setPixelColor(0, 1, 2, 3, 4);
+  uint8_t *p = _strip.getPixels();
+  uint8_t offsets[5] = {}; // by color value: none, r, g, b, w
+  for(uint8_t i=0; i < 4; i++) {
+    if(p[i] >= 1 && p[i] <= 4) offsets[p[i]] = i;
+  }
+  if(p[3] == 0) offsets[4] = offsets[1]; // no white
+  _strip.clear();
+  if(_strip.getBrightness() != 255) return; // the strip scales the colors, so it can't be told
+
+  _format = (offsets[4] << 6) | (offsets[1] << 4) | (offsets[2] << 2) | offsets[3];
+}
+
+bool NeoPixelOutput::canShow(void) {
+  return _strip.canShow();
+}
+
+void NeoPixelOutput::show(const uint8_t* pixels, uint16_t n, uint8_t format) {
+  n = min(n, _strip.numPixels());
+  if(format == _format) {
+    memcpy(_strip.getPixels(), pixels, n * FORMAT_BPP(format));
+  } else {
+    for(uint16_t i=0; i < n; i++) {
+      _strip.setPixelColor(i, getColor(pixels, i, format));
+    }
+  }
+  _strip.show();
+}
+
+void APA102Output::begin(void) {
+  pinMode(_data_pin, OUTPUT);
+  pinMode(_clock_pin, OUTPUT);
+}
+
+void APA102Output::show(const uint8_t* pixels, uint16_t n, uint8_t format) {
+  for(uint8_t i=0; i < 4; i++) { // start frame
+    shiftOut(_data_pin, _clock_pin, MSBFIRST, 0x00);
+  }
+  uint8_t bpp = FORMAT_BPP(format);
+  for(const uint8_t *p = pixels, *end = pixels + n * bpp; p < end; p += bpp) {
+    shiftOut(_data_pin, _clock_pin, MSBFIRST, 0xE0 | 31); // full global brightness
+    shiftOut(_data_pin, _clock_pin, MSBFIRST, p[FORMAT_B_OFFSET(format)]);
+    shiftOut(_data_pin, _clock_pin, MSBFIRST, p[FORMAT_G_OFFSET(format)]);
+    shiftOut(_data_pin, _clock_pin, MSBFIRST, p[FORMAT_R_OFFSET(format)]);
+  }
+  for(uint16_t i=0; i < (n + 15) / 16; i++) { // end frame, half a clock per LED to push the data through
+    shiftOut(_data_pin, _clock_pin, MSBFIRST, 0xFF);
+  }
+}
+
+/*
+ * If the buffer can't be allocated, the output has zero length.
+ */
+RAMOutput::RAMOutput(uint16_t n) : WS2812FXOutput(n) {
+  if((_pixels = (uint8_t*)malloc(n * 4)) != NULL) {
+    memset(_pixels, 0, n * 4);
+  } else {
+    _num_pixels = 0;
+  }
+}
+
+RAMOutput::~RAMOutput() {
+  free(_pixels);
+}
+
+void RAMOutput::show(const uint8_t* pixels, uint16_t n, uint8_t format) {
+  n = min(n, _num_pixels);
+  memcpy(_pixels, pixels, n * FORMAT_BPP(format));
+  _format = format;
+  _frames++;
+}
+
+uint32_t RAMOutput::getPixelColor(uint16_t i) {
+  return (i < _num_pixels) ? getColor(_pixels, i, _format) : 0;
+}
+
+uint32_t RAMOutput::getFrames(void) {
+  return _frames;
+}
+
+const uint8_t* RAMOutput::getPixels(void) {
+  return _pixels;
+}
+
+uint8_t RAMOutput::getFormat(void) {
+  return _format;
+}
+
+void FileOutput::show(const uint8_t* pixels, uint16_t n, uint8_t format) {
+  if(n == 0) return; // nothing to write, and no width to tell the height from
+  uint16_t width = (_width > 0) ? _width : n;
+  uint16_t height = (n + width - 1) / width;
+  if(_ppm) {
+    _out.print(F("P6\n"));
+    _out.print(width);
+    _out.print(' ');
+    _out.print(height);
+    _out.print(F("\n255\n"));
+  }
+
+  uint8_t buf[48]; // a multiple of 3, so pixels aren't split
+  uint8_t len = 0;
+  uint8_t bpp = FORMAT_BPP(format);
+  const uint8_t *p = pixels;
+  for(uint32_t i=0; i < (uint32_t)width * height; i++) {
+    if(i < n) {
+      buf[len++] = p[FORMAT_R_OFFSET(format)];
+      buf[len++] = p[FORMAT_G_OFFSET(format)];
+      buf[len++] = p[FORMAT_B_OFFSET(format)];
+      p += bpp;
+    } else { // the rest of the last row is black
+      buf[len++] = 0;
+      buf[len++] = 0;
+      buf[len++] = 0;
+    }
+    if(len == sizeof(buf)) {
+      _out.write(buf, len);
+      len = 0;
+    }
+  }
+  if(len > 0) _out.write(buf, len);
+}
+
+void UDPOutput::show(const uint8_t* pixels, uint16_t n, uint8_t format) {
+  _seq = (_seq % 15) + 1; // 0 means "no sequence number"
+  uint8_t bpp = FORMAT_BPP(format);
+  uint32_t total = (uint32_t)n * 3;
+  uint32_t offset = 0;
+  const uint8_t *p = pixels;
+  do {
+    uint16_t len = min(total - offset, (uint32_t)DDP_MAX_DATA);
+    uint8_t header[DDP_HEADER_SIZE] = {
+      (uint8_t)(DDP_FLAGS_VER1 | ((offset + len == total) ? DDP_FLAGS_PUSH : 0)), _seq, DDP_TYPE_RGB24, DDP_ID_DISPLAY,
+      (uint8_t)(offset >> 24), (uint8_t)(offset >> 16), (uint8_t)(offset >> 8), (uint8_t)offset,
+      (uint8_t)(len >> 8), (uint8_t)len
+    };
+    _udp.beginPacket(_ip, _port);
+    _udp.write(header, sizeof(header));
+    uint8_t buf[48];
+    for(uint16_t sent=0; sent < len; sent += sizeof(buf)) {
+      uint8_t chunk = min((uint16_t)(len - sent), (uint16_t)sizeof(buf));
+      for(uint8_t i=0; i < chunk; i += 3, p += bpp) {
+        buf[i]     = p[FORMAT_R_OFFSET(format)];
+        buf[i + 1] = p[FORMAT_G_OFFSET(format)];
+        buf[i + 2] = p[FORMAT_B_OFFSET(format)];
+      }
+      _udp.write(buf, chunk);
+    }
+    _udp.endPacket();
+    offset += len;
+  } while(offset < total);
+}
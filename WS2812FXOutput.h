@@ -0,0 +1,194 @@
+/*
+  WS2812FXOutput.h - Output drivers for WS2812FX.
+
+  FEATURES
+    * One interface for everything a frame can be sent to: the engine hands
+      over its pixels and their format, the driver sends them on
+    * NeoPixelOutput: a strip on a pin of its own (Adafruit_NeoPixel)
+    * APA102Output: APA102/SK9822 LEDs on a data and a clock pin
+    * RAMOutput: keeps the last frame in RAM, e.g. for tests off the device
+    * FileOutput: writes the frames to a file (or any Print) as PPM images
+      or raw RGB bytes
+    * UDPOutput: sends the frames over the network (DDP protocol)
+
+  NOTES
+    * Drivers are attached with WS2812FX::addOutput().
+    * The pixels handed to show() belong to the engine and may change as
+      soon as show() returns. Drivers which send in the background have to
+      copy them first and tell with canShow() when they're done.
+
+  LICENSE
+  The MIT License (MIT)
+  Copyright (c) 2016  Harm Aldick
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#ifndef WS2812FXOutput_h
+#define WS2812FXOutput_h
+
+#include <Adafruit_NeoPixel.h>
+#include <Udp.h>
+
+// pixel format: the byte offset of every color within a pixel, packed like
+// the color order of neoPixelType (e.g. NEO_GRB), 3 bytes per pixel if the
+// white offset equals the red one
+#define FORMAT_W_OFFSET(f) (((f) >> 6) & 0x03)
+#define FORMAT_R_OFFSET(f) (((f) >> 4) & 0x03)
+#define FORMAT_G_OFFSET(f) (((f) >> 2) & 0x03)
+#define FORMAT_B_OFFSET(f) ((f) & 0x03)
+#define FORMAT_BPP(f)      ((FORMAT_W_OFFSET(f) == FORMAT_R_OFFSET(f)) ? 3 : 4)
+#define FORMAT_UNKNOWN     0xFF
+
+#define DDP_PORT           4048
+#define DDP_MAX_DATA       1440 /* bytes of pixel data per packet, 480 RGB pixels */
+
+class WS2812FXOutput {
+
+  public:
+    WS2812FXOutput(uint16_t n) : _num_pixels(n) {}
+    virtual ~WS2812FXOutput() {}
+
+    // called by WS2812FX::addOutput()
+    virtual void begin(void) {}
+
+    // false while the last frame is still being sent
+    virtual bool canShow(void) { return true; }
+
+    // sends n pixels (at most numPixels()) in the given format
+    virtual void show(const uint8_t* pixels, uint16_t n, uint8_t format) = 0;
+
+    uint16_t numPixels(void) { return _num_pixels; }
+
+    // the color of pixel i (0xWWRRGGBB) of a frame
+    static uint32_t getColor(const uint8_t* pixels, uint16_t i, uint8_t format) {
+      const uint8_t *p = pixels + i * FORMAT_BPP(format);
+      uint32_t w = (FORMAT_BPP(format) == 4) ? (uint32_t)p[FORMAT_W_OFFSET(format)] << 24 : 0;
+      return w | ((uint32_t)p[FORMAT_R_OFFSET(format)] << 16) | ((uint32_t)p[FORMAT_G_OFFSET(format)] << 8) | p[FORMAT_B_OFFSET(format)];
+    }
+
+  protected:
+    uint16_t _num_pixels;
+};
+
+/*
+ * A strip on a pin of its own. The frame is copied into the strip's buffer
+ * (as it is, if the color order matches) and sent with its show(). Leave
+ * the strip's brightness alone, the engine applies it already.
+ */
+class NeoPixelOutput : public WS2812FXOutput {
+
+  public:
+    NeoPixelOutput(Adafruit_NeoPixel& strip) : WS2812FXOutput(strip.numPixels()), _strip(strip) {}
+
+    void
+      begin(void),
+      show(const uint8_t* pixels, uint16_t n, uint8_t format);
+
+    bool
+      canShow(void);
+
+  private:
+    Adafruit_NeoPixel& _strip;
+    uint8_t _format = FORMAT_UNKNOWN; // of the strip, FORMAT_UNKNOWN if it couldn't be told
+};
+
+/*
+ * APA102/SK9822 LEDs, clocked out with shiftOut() at full global brightness
+ * (the engine applies the brightness). White is dropped.
+ */
+class APA102Output : public WS2812FXOutput {
+
+  public:
+    APA102Output(uint16_t n, uint8_t dataPin, uint8_t clockPin) : WS2812FXOutput(n), _data_pin(dataPin), _clock_pin(clockPin) {}
+
+    void
+      begin(void),
+      show(const uint8_t* pixels, uint16_t n, uint8_t format);
+
+  private:
+    uint8_t _data_pin;
+    uint8_t _clock_pin;
+};
+
+/*
+ * Keeps a copy of the last frame, in the format it was sent in.
+ */
+class RAMOutput : public WS2812FXOutput {
+
+  public:
+    RAMOutput(uint16_t n);
+    ~RAMOutput();
+
+    void
+      show(const uint8_t* pixels, uint16_t n, uint8_t format);
+
+    uint32_t
+      getPixelColor(uint16_t i),
+      getFrames(void);
+
+    const uint8_t*
+      getPixels(void);
+
+    uint8_t
+      getFormat(void);
+
+  private:
+    uint8_t* _pixels;
+    uint8_t _format = NEO_GRB;
+    uint32_t _frames = 0;
+};
+
+/*
+ * Writes every frame to out: as a binary PPM image (P6, width pixels per
+ * row, 0 = all in one row) or as raw RGB bytes. Both can be appended to a
+ * single file, e.g. to be converted into a video. White is dropped.
+ */
+class FileOutput : public WS2812FXOutput {
+
+  public:
+    FileOutput(Print& out, uint16_t n, bool ppm = true, uint16_t width = 0) : WS2812FXOutput(n), _out(out), _ppm(ppm), _width(width) {}
+
+    void
+      show(const uint8_t* pixels, uint16_t n, uint8_t format);
+
+  private:
+    Print& _out;
+    bool _ppm;
+    uint16_t _width;
+};
+
+/*
+ * Sends every frame to ip with the Distributed Display Protocol (DDP), as
+ * understood e.g. by WLED and xLights, split into packets of DDP_MAX_DATA
+ * bytes. The udp object (e.g. WiFiUDP) has to be started by the sketch.
+ */
+class UDPOutput : public WS2812FXOutput {
+
+  public:
+    UDPOutput(UDP& udp, IPAddress ip, uint16_t n, uint16_t port = DDP_PORT) : WS2812FXOutput(n), _udp(udp), _ip(ip), _port(port) {}
+
+    void
+      show(const uint8_t* pixels, uint16_t n, uint8_t format);
+
+  private:
+    UDP& _udp;
+    IPAddress _ip;
+    uint16_t _port;
+    uint8_t _seq = 0;
+};
+
+#endif
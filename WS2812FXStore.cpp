@@ -0,0 +1,482 @@
+/*
+  WS2812FXStore.cpp - Persistent storage of WS2812FX segments and patterns.
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+
+  RECORD LAYOUT
+
+  Every record occupies one slot of STORE_SLOT_SIZE bytes:
+
+    byte 0      format version (upper 3 bits), payload length (lower 5 bits)
+    byte 1      record id
+    byte 2..5   sequence number, the highest valid one per id is the current copy
+    payload     0..STORE_MAX_PAYLOAD bytes
+    2 bytes     CRC-16 over all of the above, written last
+
+  Pattern header payload: generation (2 bytes), brightness, number of
+                          segments, duration (varint)
+  Segment payload:        generation of the pattern (2 bytes), mode (7 bits)
+                          + reverse (1 bit), speed, start and stop (varints),
+                          color flags (2 bits per color: black, RGB or WRGB)
+                          followed by the color bytes, options (only if not 0)
+
+  A pattern is saved as a new generation: all of its segments first, then
+  the header. The segments of the previous generation stay in their slots
+  until the header is complete. Only segment copies of the generation named
+  by the current header belong to the pattern, so a torn write leaves the
+  previous pattern in place. Segments the pattern no longer uses are
+  invalidated (version byte 0) after the header was written.
+*/
+
+#include "WS2812FXStore.h"
+
+#define COLOR_BLACK 0
+#define COLOR_RGB   1
+#define COLOR_WRGB  2
+
+#define PATTERN_ID(n) (STORE_USER_RECORDS + (n) * (MAX_NUM_SEGMENTS + 1))
+
+/*
+ * CRC-16/CCITT, bitwise to keep the flash footprint small.
+ */
+static uint16_t crc16_update(uint16_t crc, uint8_t data) {
+  crc ^= (uint16_t)data << 8;
+  for(uint8_t i=0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+  return crc;
+}
+
+/*
+ * Variable length integers: 7 bits per byte, MSB set if more bytes follow.
+ */
+static uint8_t put_varint(uint8_t* buf, uint16_t v) {
+  uint8_t n = 0;
+  while(v >= 0x80) {
+    buf[n++] = (v & 0x7F) | 0x80;
+    v >>= 7;
+  }
+  buf[n++] = v;
+  return n;
+}
+
+static uint8_t get_varint(const uint8_t* buf, uint8_t len, uint16_t* v) {
+  uint8_t n = 0;
+  uint8_t shift = 0;
+  *v = 0;
+  while(n < len && shift < 16) {
+    uint8_t b = buf[n++];
+    *v |= (uint16_t)(b & 0x7F) << shift;
+    if((b & 0x80) == 0) return n;
+    shift += 7;
+  }
+  return 0; // truncated
+}
+
+static uint8_t put_generation(uint8_t* buf, uint16_t generation) {
+  buf[0] = generation >> 8;
+  buf[1] = generation;
+  return 2;
+}
+
+static uint8_t pack_header(uint8_t* buf, const WS2812FX::pattern& p, uint16_t generation) {
+  uint8_t n = put_generation(buf, generation);
+  buf[n++] = p.brightness;
+  buf[n++] = p.numSegments;
+  return n + put_varint(buf + n, p.duration);
+}
+
+static uint8_t pack_segment(uint8_t* buf, const WS2812FX::segment& seg, uint16_t generation) {
+  uint8_t n = put_generation(buf, generation);
+  buf[n++] = (seg.mode & 0x7F) | (seg.reverse ? 0x80 : 0);
+  n += put_varint(buf + n, seg.speed);
+  n += put_varint(buf + n, seg.start);
+  n += put_varint(buf + n, seg.stop);
+
+  uint8_t flags = n++;
+  buf[flags] = 0;
+  for(uint8_t i=0; i < NUM_COLORS; i++) {
+    uint32_t c = seg.colors[i];
+    uint8_t type = (c == 0) ? COLOR_BLACK : ((c >> 24) ? COLOR_WRGB : COLOR_RGB);
+    buf[flags] |= type << (i * 2);
+    if(type == COLOR_WRGB) buf[n++] = c >> 24;
+    if(type != COLOR_BLACK) {
+      buf[n++] = c >> 16;
+      buf[n++] = c >> 8;
+      buf[n++] = c;
+    }
+  }
+  if(seg.options) buf[n++] = seg.options; // optional, older records end here
+  return n;
+}
+
+static bool unpack_segment(const uint8_t* buf, uint8_t len, WS2812FX::segment& seg) {
+  uint8_t n = 3;
+  uint8_t used;
+  if(len < 7) return false;
+  seg.mode = buf[2] & 0x7F;
+  seg.reverse = buf[2] & 0x80;
+  if((used = get_varint(buf + n, len - n, &seg.speed)) == 0) return false;
+  n += used;
+  if((used = get_varint(buf + n, len - n, &seg.start)) == 0) return false;
+  n += used;
+  if((used = get_varint(buf + n, len - n, &seg.stop)) == 0) return false;
+  n += used;
+  if(n >= len) return false;
+
+  uint8_t flags = buf[n++];
+  for(uint8_t i=0; i < NUM_COLORS; i++) {
+    uint8_t type = (flags >> (i * 2)) & 0x03;
+    uint8_t bytes = (type == COLOR_WRGB) ? 4 : ((type == COLOR_RGB) ? 3 : 0);
+    if(n + bytes > len) return false;
+    uint32_t c = 0;
+    for(uint8_t j=0; j < bytes; j++) {
+      c = (c << 8) | buf[n++];
+    }
+    seg.colors[i] = c;
+  }
+  seg.options = (n < len) ? buf[n++] : 0;
+  return n == len;
+}
+
+WS2812FXStore::WS2812FXStore(uint16_t base, uint16_t size, read_fn r, write_fn w, commit_fn c) {
+  _read = r;
+  _write = w;
+  _commit = c;
+  _base = base;
+  _num_slots = min(size / STORE_SLOT_SIZE, 254);
+  memset(_slots, STORE_NO_SLOT, sizeof(_slots));
+  memset(_pinned, STORE_NO_SLOT, sizeof(_pinned));
+}
+
+/*
+ * Scans the storage region and indexes the latest valid copy of every record.
+ * Returns the number of records found.
+ */
+uint8_t WS2812FXStore::begin(void) {
+  uint8_t newest = STORE_NO_SLOT;
+  memset(_slots, STORE_NO_SLOT, sizeof(_slots));
+  _seq = 0;
+
+  for(uint8_t s=0; s < _num_slots; s++) {
+    if(!slot_valid(s)) continue;
+
+    uint8_t id = _read(slot_address(s) + 1);
+    uint32_t seq = slot_seq(s);
+    if(_slots[id] == STORE_NO_SLOT || seq > slot_seq(_slots[id])) {
+      _slots[id] = s;
+    }
+
+    if(newest == STORE_NO_SLOT || seq >= _seq) {
+      _seq = seq;
+      newest = s;
+    }
+  }
+
+  // segments belong to a pattern in the generation of its header, the rest
+  // (an unfinished save, segments no longer used) is free to be reused
+  for(uint8_t n=0; n < STORE_MAX_PATTERNS; n++) {
+    uint8_t id = PATTERN_ID(n);
+    uint8_t num_segments = 0;
+    uint16_t generation = 0;
+    if(_slots[id] != STORE_NO_SLOT && slot_length(_slots[id]) >= 5) {
+      num_segments = _read(slot_address(_slots[id]) + STORE_HEADER_SIZE + 3);
+      generation = slot_generation(_slots[id]);
+    }
+    for(uint8_t i=0; i < MAX_NUM_SEGMENTS; i++) {
+      uint8_t& s = _slots[id + 1 + i];
+      if(s == STORE_NO_SLOT) continue;
+      if(i >= num_segments) {
+        s = STORE_NO_SLOT;
+      } else if(slot_length(s) < 2 || slot_generation(s) != generation) {
+        s = find_slot(id + 1 + i, generation);
+      }
+    }
+  }
+
+  // continue writing behind the most recently written record
+  _head = (newest == STORE_NO_SLOT) ? 0 : (newest + 1) % _num_slots;
+
+  uint8_t found = 0;
+  for(uint8_t i=0; i < STORE_MAX_RECORDS; i++) {
+    if(_slots[i] != STORE_NO_SLOT) found++;
+  }
+  return found;
+}
+
+/*
+ * Invalidates all records.
+ */
+void WS2812FXStore::format(void) {
+  for(uint8_t s=0; s < _num_slots; s++) {
+    _write(slot_address(s), 0);
+  }
+  _bytes_written += _num_slots;
+  memset(_slots, STORE_NO_SLOT, sizeof(_slots));
+  _head = 0;
+  _seq = 0;
+  _dirty = true;
+}
+
+/*
+ * Calls the commit function, if anything was written since the last commit.
+ */
+void WS2812FXStore::commit(void) {
+  if(_dirty && _commit != NULL) {
+    _commit();
+  }
+  _dirty = false;
+}
+
+/*
+ * Saves a record. If the stored copy is identical, nothing is written.
+ * Otherwise the record is appended to the next free slot, the old copy
+ * stays in place until it gets reused.
+ */
+bool WS2812FXStore::saveRecord(uint8_t id, const uint8_t* data, uint8_t len) {
+  if(id >= STORE_MAX_RECORDS || len > STORE_MAX_PAYLOAD) return false;
+
+  if(_slots[id] != STORE_NO_SLOT && slot_equals(_slots[id], data, len)) {
+    return true;
+  }
+  return append(id, data, len);
+}
+
+/*
+ * Writes a new copy of a record to the next slot which isn't in use.
+ */
+bool WS2812FXStore::append(uint8_t id, const uint8_t* data, uint8_t len) {
+  for(uint8_t i=0; i < _num_slots; i++) {
+    uint8_t s = _head;
+    _head = (_head + 1) % _num_slots;
+    if(!slot_live(s)) {
+      write_slot(s, id, data, len);
+      _slots[id] = s;
+      return true;
+    }
+  }
+  return false; // every slot holds a current record, the region is too small
+}
+
+/*
+ * Copies the current version of a record to data. Returns the record length,
+ * 0 if there is no such record.
+ */
+uint8_t WS2812FXStore::loadRecord(uint8_t id, uint8_t* data, uint8_t len) {
+  if(id >= STORE_MAX_RECORDS || _slots[id] == STORE_NO_SLOT) return 0;
+
+  uint8_t s = _slots[id];
+  uint8_t n = slot_length(s);
+  if(n > len) return 0;
+
+  uint16_t addr = slot_address(s) + STORE_HEADER_SIZE;
+  for(uint8_t i=0; i < n; i++) {
+    data[i] = _read(addr + i);
+  }
+  return n;
+}
+
+/*
+ * Saves a pattern, if it changed, as a new generation: the segments first,
+ * the header last. Until the header is written, the previous generation
+ * stays in place and is the one loaded.
+ */
+bool WS2812FXStore::savePattern(uint8_t n, const WS2812FX::pattern& p) {
+  if(n >= STORE_MAX_PATTERNS || p.numSegments > MAX_NUM_SEGMENTS) return false;
+
+  uint8_t id = PATTERN_ID(n);
+  uint8_t head[STORE_MAX_PAYLOAD];
+  uint8_t buf[STORE_MAX_PAYLOAD];
+  uint16_t generation = (_slots[id] == STORE_NO_SLOT) ? 0 : slot_generation(_slots[id]);
+
+  bool same = _slots[id] != STORE_NO_SLOT && slot_equals(_slots[id], head, pack_header(head, p, generation));
+  for(uint8_t i=0; same && i < p.numSegments; i++) {
+    same = _slots[id + 1 + i] != STORE_NO_SLOT && slot_equals(_slots[id + 1 + i], buf, pack_segment(buf, p.segments[i], generation));
+  }
+  if(same) return true;
+
+  generation++;
+  memcpy(_pinned, _slots + id, sizeof(_pinned));
+  bool ok = true;
+  for(uint8_t i=0; ok && i < p.numSegments; i++) {
+    ok = append(id + 1 + i, buf, pack_segment(buf, p.segments[i], generation));
+  }
+  if(ok) ok = append(id, head, pack_header(head, p, generation));
+
+  if(!ok) { // out of slots, the previous generation is still the current one
+    memcpy(_slots + id, _pinned, sizeof(_pinned));
+  } else {
+    // segments the pattern no longer uses don't need to occupy a slot
+    for(uint8_t i=p.numSegments; i < MAX_NUM_SEGMENTS; i++) {
+      uint8_t s = _pinned[1 + i];
+      if(s == STORE_NO_SLOT) continue;
+      _write(slot_address(s), 0);
+      _bytes_written++;
+      _slots[id + 1 + i] = STORE_NO_SLOT;
+    }
+  }
+  memset(_pinned, STORE_NO_SLOT, sizeof(_pinned));
+  return ok;
+}
+
+/*
+ * Loads a pattern. p is only modified, if the header and all of its segments
+ * could be read.
+ */
+bool WS2812FXStore::loadPattern(uint8_t n, WS2812FX::pattern& p) {
+  if(n >= STORE_MAX_PATTERNS) return false;
+
+  uint8_t id = PATTERN_ID(n);
+  uint8_t buf[STORE_MAX_PAYLOAD];
+  uint8_t len = loadRecord(id, buf, sizeof(buf));
+  if(len < 5 || buf[3] > MAX_NUM_SEGMENTS) return false;
+
+  WS2812FX::pattern tmp = {};
+  if(get_varint(buf + 4, len - 4, &tmp.duration) == 0) return false;
+  uint8_t generation[2] = {buf[0], buf[1]};
+  tmp.brightness = buf[2];
+  tmp.numSegments = buf[3];
+
+  for(uint8_t i=0; i < tmp.numSegments; i++) {
+    len = loadRecord(id + 1 + i, buf, sizeof(buf));
+    if(len < 2 || buf[0] != generation[0] || buf[1] != generation[1]) return false; // from another save
+    if(!unpack_segment(buf, len, tmp.segments[i])) return false;
+  }
+  p = tmp;
+  return true;
+}
+
+uint8_t WS2812FXStore::getNumSlots(void) {
+  return _num_slots;
+}
+
+uint32_t WS2812FXStore::getBytesWritten(void) {
+  return _bytes_written;
+}
+
+uint16_t WS2812FXStore::slot_address(uint8_t s) {
+  return _base + (uint16_t)s * STORE_SLOT_SIZE;
+}
+
+uint8_t WS2812FXStore::slot_length(uint8_t s) {
+  return _read(slot_address(s)) & 0x1F;
+}
+
+uint16_t WS2812FXStore::slot_generation(uint8_t s) {
+  uint16_t addr = slot_address(s) + STORE_HEADER_SIZE;
+  return ((uint16_t)_read(addr) << 8) | _read(addr + 1);
+}
+
+/*
+ * Looks for the latest valid copy of a record in the given generation.
+ */
+uint8_t WS2812FXStore::find_slot(uint8_t id, uint16_t generation) {
+  uint8_t found = STORE_NO_SLOT;
+  for(uint8_t s=0; s < _num_slots; s++) {
+    if(_read(slot_address(s) + 1) != id || !slot_valid(s)) continue;
+    if(slot_length(s) < 2 || slot_generation(s) != generation) continue;
+    if(found == STORE_NO_SLOT || slot_seq(s) > slot_seq(found)) found = s;
+  }
+  return found;
+}
+
+uint32_t WS2812FXStore::slot_seq(uint8_t s) {
+  uint16_t addr = slot_address(s) + 2;
+  uint32_t seq = 0;
+  for(uint8_t i=0; i < 4; i++) {
+    seq = (seq << 8) | _read(addr + i);
+  }
+  return seq;
+}
+
+/*
+ * A slot is valid, if it has the current format version, a known id and
+ * a matching CRC. Torn writes and erased or foreign data fail this test.
+ */
+bool WS2812FXStore::slot_valid(uint8_t s) {
+  uint16_t addr = slot_address(s);
+  uint8_t head = _read(addr);
+  uint8_t len = head & 0x1F;
+  if((head >> 5) != STORE_VERSION || len > STORE_MAX_PAYLOAD) return false;
+  if(_read(addr + 1) >= STORE_MAX_RECORDS) return false;
+
+  uint16_t crc = 0xFFFF;
+  uint8_t n = STORE_HEADER_SIZE + len;
+  for(uint8_t i=0; i < n; i++) {
+    crc = crc16_update(crc, _read(addr + i));
+  }
+  return crc == (((uint16_t)_read(addr + n) << 8) | _read(addr + n + 1));
+}
+
+/*
+ * A slot is live, if it holds the current copy of a record or belongs to
+ * the pattern being replaced.
+ */
+bool WS2812FXStore::slot_live(uint8_t s) {
+  for(uint8_t i=0; i < STORE_MAX_RECORDS; i++) {
+    if(_slots[i] == s) return true;
+  }
+  for(uint8_t i=0; i < sizeof(_pinned); i++) {
+    if(_pinned[i] == s) return true;
+  }
+  return false;
+}
+
+bool WS2812FXStore::slot_equals(uint8_t s, const uint8_t* data, uint8_t len) {
+  if(slot_length(s) != len) return false;
+  uint16_t addr = slot_address(s) + STORE_HEADER_SIZE;
+  for(uint8_t i=0; i < len; i++) {
+    if(_read(addr + i) != data[i]) return false;
+  }
+  return true;
+}
+
+void WS2812FXStore::write_slot(uint8_t s, uint8_t id, const uint8_t* data, uint8_t len) {
+  uint8_t head[STORE_HEADER_SIZE];
+  _seq++;
+  head[0] = (STORE_VERSION << 5) | len;
+  head[1] = id;
+  head[2] = _seq >> 24;
+  head[3] = _seq >> 16;
+  head[4] = _seq >> 8;
+  head[5] = _seq;
+
+  uint16_t addr = slot_address(s);
+  uint16_t crc = 0xFFFF;
+  for(uint8_t i=0; i < STORE_HEADER_SIZE; i++) {
+    crc = crc16_update(crc, head[i]);
+    _write(addr++, head[i]);
+  }
+  for(uint8_t i=0; i < len; i++) {
+    crc = crc16_update(crc, data[i]);
+    _write(addr++, data[i]);
+  }
+  _write(addr++, crc >> 8);
+  _write(addr, crc);
+
+  _bytes_written += STORE_HEADER_SIZE + len + 2;
+  _dirty = true;
+}
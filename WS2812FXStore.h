@@ -0,0 +1,128 @@
+/*
+  WS2812FXStore.h - Persistent storage of WS2812FX segments and patterns.
+
+  FEATURES
+    * Compact, bit packed records (a single colored segment takes about 9 bytes)
+    * Every record carries a format version and a CRC-16, damaged or
+      foreign data is ignored instead of being loaded
+    * Incremental: only records and patterns which actually changed are
+      written
+    * Log structured: new copies are appended round robin over the whole
+      storage region (simple wear-levelling), the previous copy is kept
+      until the new one is complete, so a power loss while writing
+      (torn write) falls back to the last good copy
+    * Patterns are saved as a whole: the segments carry the generation of
+      their pattern and are written before its header, so a torn write
+      loads the previous pattern, never a mix of old and new segments
+    * Storage agnostic: bytes are read and written through user supplied
+      functions, e.g. wrapping EEPROM.read()/EEPROM.write()
+
+  NOTES
+    * The region has to be larger than the data it holds, as old copies are
+      only reused after new ones were written. STORE_SIZE(records) is the
+      least it takes for a number of records in use, STORE_MAX_SIZE holds
+      all patterns and user records with all segments. More room spreads
+      the writes over more bytes.
+    * On ESP8266 the EEPROM emulation rewrites its whole flash sector on
+      EEPROM.commit(), so save everything first and commit() once.
+
+  LICENSE
+  The MIT License (MIT)
+  Copyright (c) 2016  Harm Aldick
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#ifndef WS2812FXStore_h
+#define WS2812FXStore_h
+
+#include "WS2812FX.h"
+
+#define STORE_VERSION      2    /* bump, if the record layout changes */
+#define STORE_MAX_PATTERNS 8
+#define STORE_USER_RECORDS 4    /* record ids 0..3 are free for the sketch's own settings */
+#define STORE_MAX_PAYLOAD  26   /* a fully populated segment record */
+#define STORE_HEADER_SIZE  6    /* version/length, id, sequence number */
+#define STORE_SLOT_SIZE    (STORE_HEADER_SIZE + STORE_MAX_PAYLOAD + 2)
+#define STORE_MAX_RECORDS  (STORE_USER_RECORDS + STORE_MAX_PATTERNS * (MAX_NUM_SEGMENTS + 1))
+#define STORE_NO_SLOT      0xFF
+
+// the smallest region for a number of records, with room for the new copy of a pattern
+#define STORE_SIZE(records) (((records) + MAX_NUM_SEGMENTS + 1) * STORE_SLOT_SIZE)
+#define STORE_MAX_SIZE      STORE_SIZE(STORE_MAX_RECORDS)
+
+class WS2812FXStore {
+
+  public:
+    typedef uint8_t (*read_fn)(uint16_t address);
+    typedef void (*write_fn)(uint16_t address, uint8_t value);
+    typedef void (*commit_fn)(void);
+
+    WS2812FXStore(uint16_t base, uint16_t size, read_fn r, write_fn w, commit_fn c = NULL);
+
+    void
+      commit(void),
+      format(void);
+
+    bool
+      saveRecord(uint8_t id, const uint8_t* data, uint8_t len),
+      savePattern(uint8_t n, const WS2812FX::pattern& p),
+      loadPattern(uint8_t n, WS2812FX::pattern& p);
+
+    uint8_t
+      begin(void),
+      loadRecord(uint8_t id, uint8_t* data, uint8_t len),
+      getNumSlots(void);
+
+    uint32_t
+      getBytesWritten(void);
+
+  private:
+    bool
+      append(uint8_t id, const uint8_t* data, uint8_t len),
+      slot_valid(uint8_t s),
+      slot_live(uint8_t s),
+      slot_equals(uint8_t s, const uint8_t* data, uint8_t len);
+
+    uint8_t
+      find_slot(uint8_t id, uint16_t generation),
+      slot_length(uint8_t s);
+
+    uint32_t
+      slot_seq(uint8_t s);
+
+    uint16_t
+      slot_address(uint8_t s),
+      slot_generation(uint8_t s);
+
+    void
+      write_slot(uint8_t s, uint8_t id, const uint8_t* data, uint8_t len);
+
+    read_fn _read;
+    write_fn _write;
+    commit_fn _commit;
+
+    uint16_t _base;
+    uint8_t _num_slots;
+    uint8_t _head = 0;
+    bool _dirty = false;
+    uint32_t _seq = 0;
+    uint32_t _bytes_written = 0;
+    uint8_t _slots[STORE_MAX_RECORDS]; // slot holding the latest copy of each record
+    uint8_t _pinned[MAX_NUM_SEGMENTS + 1]; // slots of the pattern being replaced, kept until its new header is written
+};
+
+#endif
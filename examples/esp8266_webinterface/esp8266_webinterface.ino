@@ -37,6 +37,7 @@
   CHANGELOG
   2016-11-26 initial version
   2018-01-06 added custom effects list option and auto-cycle feature
+  2026-10-18 mode list is built by the browser from the library's JSON mode catalog
   
 */
 #include <ESP8266WiFi.h>
@@ -73,7 +74,6 @@ extern const char main_js[];
 
 unsigned long auto_last_change = 0;
 unsigned long last_wifi_check_time = 0;
-String modes = "";
 uint8_t myModes[] = {}; // *** optionally create a custom list of effect/mode numbers
 boolean auto_cycle = false;
 
@@ -86,9 +86,6 @@ void setup(){
   Serial.println();
   Serial.println("Starting...");
 
-  modes.reserve(5000);
-  modes_setup();
-
   Serial.println("WS2812FX setup");
   ws2812fx.init();
   ws2812fx.setMode(DEFAULT_MODE);
@@ -104,6 +101,7 @@ void setup(){
   server.on("/", srv_handle_index_html);
   server.on("/main.js", srv_handle_main_js);
   server.on("/modes", srv_handle_modes);
+  server.on("/mymodes", srv_handle_my_modes);
   server.on("/set", srv_handle_set);
   server.onNotFound(srv_handle_not_found);
   server.begin();
@@ -184,22 +182,6 @@ void wifi_setup() {
 }
 
 
-/*
- * Build <li> string for all modes.
- */
-void modes_setup() {
-  modes = "";
-  uint8_t num_modes = sizeof(myModes) > 0 ? sizeof(myModes) : ws2812fx.getModeCount();
-  for(uint8_t i=0; i < num_modes; i++) {
-    uint8_t m = sizeof(myModes) > 0 ? myModes[i] : i;
-    modes += "<li><a href='#' class='m' id='";
-    modes += m;
-    modes += "'>";
-    modes += ws2812fx.getModeName(m);
-    modes += "</a></li>";
-  }
-}
-
 /* #####################################################
 #  Webserver Functions
 ##################################################### */
@@ -217,7 +199,17 @@ void srv_handle_main_js() {
 }
 
 void srv_handle_modes() {
-  server.send(200,"text/plain", modes);
+  server.send_P(200,"application/json", (PGM_P)ws2812fx.getModesJSON()); // mode names, straight from flash
+}
+
+void srv_handle_my_modes() {
+  char list[sizeof(myModes) * 4 + 3] = "["; // custom list of mode numbers, [] if none
+  for(uint8_t i=0; i < sizeof(myModes); i++) {
+    if(i > 0) strcat(list, ",");
+    itoa(myModes[i], list + strlen(list), 10);
+  }
+  strcat(list, "]");
+  server.send(200,"application/json", list);
 }
 
 void srv_handle_set() {
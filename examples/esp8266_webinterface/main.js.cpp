@@ -94,20 +94,37 @@ function drawColorbar(rgb = [0, 0, 0]) {
   }
 }
 
-function setup(){
+function getJSON(url, callback) {
   var xhttp = new XMLHttpRequest();
   xhttp.onreadystatechange = function() {
     if (xhttp.readyState == 4 && xhttp.status == 200) {
-      document.getElementById('mode').innerHTML = xhttp.responseText;
-      elems = document.querySelectorAll('ul li a'); // adds listener also to existing s and b buttons
-      [].forEach.call(elems, function(el) {
-        el.addEventListener('touchstart', handle_M_B_S, false);
-        el.addEventListener('click', handle_M_B_S, false);
-      });
+      callback(JSON.parse(xhttp.responseText));
     }
   };
-  xhttp.open('GET', 'modes', true);
+  xhttp.open('GET', url, true);
   xhttp.send();
+}
+
+function buildModes(names, myModes) {
+  var ids = myModes.length > 0 ? myModes : names.map(function(name, i) { return i; });
+  var html = '';
+  ids.forEach(function(id) {
+    html += "<li><a href='#' class='m' id='" + id + "'>" + names[id] + "</a></li>";
+  });
+  document.getElementById('mode').innerHTML = html;
+  elems = document.querySelectorAll('ul li a'); // adds listener also to existing s and b buttons
+  [].forEach.call(elems, function(el) {
+    el.addEventListener('touchstart', handle_M_B_S, false);
+    el.addEventListener('click', handle_M_B_S, false);
+  });
+}
+
+function setup(){
+  getJSON('modes', function(names) {
+    getJSON('mymodes', function(myModes) {
+      buildModes(names, myModes);
+    });
+  });
  
   var can = document.getElementById('colorbar');
   var ctx = can.getContext('2d');
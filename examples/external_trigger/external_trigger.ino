@@ -6,6 +6,8 @@
 #define ANALOG_PIN A0
 #define ANALOG_THRESHOLD 512
 
+#define BUTTON_PIN 2 // must support interrupts
+
 #define TIMER_MS 3000
 
 // Parameter 1 = number of pixels in strip
@@ -19,12 +21,26 @@
 WS2812FX ws2812fx = WS2812FX(LED_COUNT, LED_PIN, NEO_RGB + NEO_KHZ800);
 
 unsigned long last_trigger = 0;
+unsigned long last_report = 0;
 unsigned long now = 0;
 
+// trigger() can be called by an interrupt handler, also while the loop calls
+// it, the event is timestamped right away and handled by the next service()
+void button_pressed() {
+  ws2812fx.trigger(1UL << 1); // the second segment only
+}
+
 void setup() {
+  Serial.begin(115200);
   ws2812fx.init();
   ws2812fx.setBrightness(255);
-  ws2812fx.setMode(FX_MODE_RANDOM_COLOR);
+  // two slow segments, which mostly change when triggered
+  ws2812fx.setSegment(0, 0,           LED_COUNT/2-1, FX_MODE_RANDOM_COLOR,     RED, SPEED_MAX, false);
+  ws2812fx.setSegment(1, LED_COUNT/2, LED_COUNT-1,   FX_MODE_FIREWORKS_RANDOM, RED, SPEED_MAX, false);
+  ws2812fx.start();
+
+  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(BUTTON_PIN), button_pressed, FALLING);
 }
 
 void loop() {
@@ -32,15 +48,31 @@ void loop() {
 
   ws2812fx.service();
 
-  // trigger on a regular basis
+  // trigger all segments on a regular basis
   if(now - last_trigger > TIMER_MS) {
     ws2812fx.trigger();
     last_trigger = now;
   }
 
-  // trigger, if analog value is above threshold
-  // this comes in handy, when using a microphone on analog input
-  if(analogRead(ANALOG_PIN) > ANALOG_THRESHOLD) {
-    ws2812fx.trigger();
+  // trigger the first segment, if analog value is above threshold, the louder
+  // the stronger (this comes in handy, when using a microphone on analog input)
+  int level = analogRead(ANALOG_PIN);
+  if(level > ANALOG_THRESHOLD) {
+    ws2812fx.trigger(1UL << 0, map(level, ANALOG_THRESHOLD, 1023, 1, 255));
+  }
+
+  // how long it takes from a trigger to the LEDs
+  if(now - last_report > 5000) {
+    const WS2812FX::stats& stats = ws2812fx.getStats();
+    Serial.print(F("triggers: "));
+    Serial.print(stats.triggers);
+    Serial.print(F(", dropped: "));
+    Serial.print(stats.triggers_dropped);
+    Serial.print(F(", latency: "));
+    Serial.print(stats.trigger_latency_us);
+    Serial.print(F(" us, max: "));
+    Serial.print(stats.max_trigger_latency_us);
+    Serial.println(F(" us"));
+    last_report = now;
   }
 }
\ No newline at end of file
@@ -0,0 +1,76 @@
+/*
+  WS2812FX sound reactive demo.
+  
+  FEATURES
+    * example of a microphone on an analog pin feeding the audio analysis,
+      shared by three segments: a spectrum, a beat pulse and a bass fire
+
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick 
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+  
+  CHANGELOG
+  2026-10-18 initial version
+  
+*/
+
+#include <WS2812FX.h>
+#include <WS2812FXAudio.h>
+
+#define LED_COUNT 60
+#define LED_PIN 12
+
+#define MIC_PIN A0
+#define SAMPLE_RATE 8000 // Hz, the lowest band starts at SAMPLE_RATE / 64
+
+WS2812FX ws2812fx = WS2812FX(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
+WS2812FXAudio audio = WS2812FXAudio(SAMPLE_RATE);
+
+unsigned long next_sample = 0;
+
+void setup() {
+  ws2812fx.init();
+  ws2812fx.setBrightness(128);
+  ws2812fx.setAudio(&audio); // service() analyzes the samples once per frame
+
+  ws2812fx.setNumSegments(3);
+  ws2812fx.setSegment(0, 0,  31, FX_MODE_SPECTRUM,   BLACK,  1000, false);
+  ws2812fx.setSegment(1, 32, 45, FX_MODE_BEAT_PULSE, BLUE,   1000, false);
+  ws2812fx.setSegment(2, 46, 59, FX_MODE_BASS_FIRE,  ORANGE, 1000, false);
+  ws2812fx.start();
+}
+
+void loop() {
+  // sample the microphone at SAMPLE_RATE; a timer interrupt (or I2S on the
+  // ESP32) samples more evenly, addSample() can be called from there as well
+  unsigned long now = micros();
+  if(now - next_sample < 0x80000000UL) {
+    audio.addSample((analogRead(MIC_PIN) - 512) << 6);
+    next_sample += 1000000UL / SAMPLE_RATE;
+    if(now - next_sample < 0x80000000UL) next_sample = now; // fell behind, e.g. while sending a frame
+  }
+
+  ws2812fx.service(500); // render in small slices, so the sampling goes on
+}
@@ -29,6 +29,8 @@
   
   CHANGELOG
   2018-02-26 initial version
+  2026-10-18 added a second effect, registered with addCustomMode()
+  2026-10-18 random chase moves its pixels with shift()
 */
 
 #include <WS2812FX.h>
@@ -45,6 +47,13 @@ void setup() {
   ws2812fx.setBrightness(255);
   ws2812fx.setSpeed(50);
   ws2812fx.setCustomMode(customEffect);
+
+  // effects added with addCustomMode() get a mode number of their own and
+  // can be used on any segment, here the second half of the strip
+  static uint8_t hue = 0;
+  uint8_t gradient = ws2812fx.addCustomMode(F("Gradient"), gradientEffect, &hue);
+  ws2812fx.setSegment(0, 0,           LED_COUNT/2-1, FX_MODE_CUSTOM, RED, 50, false);
+  ws2812fx.setSegment(1, LED_COUNT/2, LED_COUNT-1,   gradient,       RED, 20, false);
   ws2812fx.start();
 }
 
@@ -53,9 +62,7 @@ void loop() {
 }
 
 uint16_t customEffect(void) { // random chase
-  for(uint16_t i=LED_COUNT-1; i>0; i--) {
-    ws2812fx.setPixelColor(i, ws2812fx.getPixelColor(i-1));
-  }
+  ws2812fx.shift(0, 1); // move the pixels of segment 0 one step along
   uint32_t color = ws2812fx.getPixelColor(1);
   int r = random(6) != 0 ? (color >> 16 & 0xFF) : random(256);
   int g = random(6) != 0 ? (color >> 8  & 0xFF) : random(256);
@@ -64,3 +71,11 @@ uint16_t customEffect(void) { // random chase
   return ws2812fx.getSpeed(); // return the delay until the next animation step (in msec)
 }
 
+uint16_t gradientEffect(WS2812FX::span& s, void* user) { // moving rainbow gradient
+  uint8_t* hue = (uint8_t*)user; // the context passed to addCustomMode()
+  for(uint16_t i=0; i<s.length; i++) {
+    s.setPixel(i, ws2812fx.color_wheel(*hue + i * 256 / s.length));
+  }
+  (*hue)++;
+  return s.seg->speed; // the segment's own speed
+}
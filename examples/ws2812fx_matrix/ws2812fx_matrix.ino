@@ -0,0 +1,72 @@
+/*
+  WS2812FX LED matrix demo.
+  
+  FEATURES
+    * example of a serpentine wired LED matrix, cycling through the 2D modes
+
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick 
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+  
+  CHANGELOG
+  2026-10-18 initial version
+  
+*/
+
+#include <WS2812FX.h>
+
+#define LED_PIN       12  // digital pin used to drive the LED matrix
+#define MATRIX_WIDTH  16
+#define MATRIX_HEIGHT 8
+#define LED_COUNT     (MATRIX_WIDTH * MATRIX_HEIGHT)
+
+WS2812FX ws2812fx = WS2812FX(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
+
+uint8_t modes[] = {FX_MODE_TEXT_2D, FX_MODE_PLASMA_2D, FX_MODE_RAINBOW_2D};
+uint8_t current = 0;
+unsigned long last_change = 0;
+
+void setup() {
+  ws2812fx.init();
+  ws2812fx.setBrightness(40);
+
+  // a single panel, every other row wired right to left
+  ws2812fx.setMatrix(MATRIX_WIDTH, MATRIX_HEIGHT, MATRIX_SERPENTINE);
+  ws2812fx.setText("Hello WS2812FX!");
+
+  // colors: text, background
+  ws2812fx.setSegment(0, 0, LED_COUNT-1, modes[current], (const uint32_t[]) {ORANGE, BLACK, BLACK}, 1000, false);
+  ws2812fx.start();
+}
+
+void loop() {
+  ws2812fx.service();
+
+  if(millis() - last_change > 15000) {
+    current = (current + 1) % sizeof(modes);
+    ws2812fx.setMode(modes[current]);
+    last_change = millis();
+  }
+}
@@ -0,0 +1,72 @@
+/*
+  WS2812FX multiple outputs demo.
+  
+  FEATURES
+    * example of one WS2812FX instance driving four strips on pins of their
+      own (one of them APA102), with segments running across the strips
+
+
+  LICENSE
+
+  The MIT License (MIT)
+
+  Copyright (c) 2016  Harm Aldick 
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+
+  
+  CHANGELOG
+  2026-10-18 initial version
+  
+*/
+
+#include <WS2812FX.h>
+#include <WS2812FXOutput.h>
+
+#define STRIP_LENGTH 60 // LEDs per strip
+#define LED_COUNT    (4 * STRIP_LENGTH)
+
+// the first strip is driven by the WS2812FX instance itself, it holds all LEDs
+WS2812FX ws2812fx = WS2812FX(LED_COUNT, 12, NEO_GRB + NEO_KHZ800);
+
+// the other strips are added as outputs, each shows a part of the LEDs
+Adafruit_NeoPixel strip2 = Adafruit_NeoPixel(STRIP_LENGTH, 13, NEO_GRB + NEO_KHZ800);
+Adafruit_NeoPixel strip3 = Adafruit_NeoPixel(STRIP_LENGTH, 14, NEO_GRB + NEO_KHZ800);
+NeoPixelOutput output2 = NeoPixelOutput(strip2);
+NeoPixelOutput output3 = NeoPixelOutput(strip3);
+
+// the last strip is an APA102 strip on a data and a clock pin
+APA102Output output4 = APA102Output(STRIP_LENGTH, 15, 16);
+
+void setup() {
+  ws2812fx.init();
+  ws2812fx.addOutput(output2, 1 * STRIP_LENGTH); // strip2 shows LEDs 60 - 119
+  ws2812fx.addOutput(output3, 2 * STRIP_LENGTH);
+  ws2812fx.addOutput(output4, 3 * STRIP_LENGTH);
+  ws2812fx.setBrightness(100);
+
+  // one rainbow over the first two strips, a scanner over the other two
+  ws2812fx.setSegment(0, 0,                LED_COUNT/2-1, FX_MODE_RAINBOW_CYCLE,  RED,    2000, false);
+  ws2812fx.setSegment(1, LED_COUNT/2,      LED_COUNT-1,   FX_MODE_LARSON_SCANNER, PURPLE, 2000, false);
+  ws2812fx.start();
+}
+
+void loop() {
+  ws2812fx.service();
+}
@@ -33,12 +33,16 @@
   
   CHANGELOG
   2018-02-21 initial version
+  2026-10-18 stream mode catalog and state JSON from the library
+  2026-10-18 patterns are saved with WS2812FXStore (compact, CRC checked, only changes are written)
+  2026-10-18 patterns are played by the library's playlist, no blackout between patterns
 */
 
 #include <WS2812FX.h>
 #include <ESP8266WebServer.h>
 #include <ArduinoJson.h>
 #include <EEPROM.h>
+#include <WS2812FXStore.h>
 
 uint8_t  dataPin = D1; // default digital pin used to drive the LED strip
 uint16_t numLeds = 30; // default number of LEDs on the strip
@@ -47,17 +51,11 @@ uint16_t numLeds = 30; // default number of LEDs on the strip
 #define WIFI_PASSWORD "xxxxxxxx" // WiFi network password
 #define HTTP_PORT 80
 
-#define MAX_NUM_PATTERNS 8
-
-typedef struct Pattern { // 252 bytes/pattern
-  uint8_t brightness;
-  int duration;
-  uint8_t numSegments;
-  WS2812FX::segment segments[MAX_NUM_SEGMENTS];
-} Pattern;
+#define MAX_NUM_PATTERNS STORE_MAX_PATTERNS
+#define EEPROM_SIZE STORE_MAX_SIZE // all patterns with all segments, at most 4096 on ESP8266
 
 // setup a couple default patterns
-Pattern patterns[MAX_NUM_PATTERNS] = {
+WS2812FX::pattern patterns[MAX_NUM_PATTERNS] = {
   {128, 10, 1, {
     {FX_MODE_LARSON_SCANNER, {0x800080, 0, 0}, 3000, 0, numLeds-1, false}
   }},
@@ -67,17 +65,19 @@ Pattern patterns[MAX_NUM_PATTERNS] = {
 };
 
 int numPatterns = 2;
-int currentPattern = 0;
-unsigned long lastTime = 0;
 
 WS2812FX ws2812fx = WS2812FX(numLeds, dataPin, NEO_GRB + NEO_KHZ800);
 ESP8266WebServer server(HTTP_PORT);
+WS2812FXStore store(0, EEPROM_SIZE,
+  [](uint16_t a) { return EEPROM.read(a); },
+  [](uint16_t a, uint8_t v) { EEPROM.write(a, v); },
+  []() { EEPROM.commit(); }); // for ESP8266 (pass NULL if using an Arduino)
 
 void setup() {
   Serial.begin(115200);
   Serial.println("\r\n");
 
-  EEPROM.begin(2048); // for ESP8266 (comment out if using an Arduino)
+  EEPROM.begin(EEPROM_SIZE); // for ESP8266 (comment out if using an Arduino)
 
   // init WiFi
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -98,31 +98,15 @@ void setup() {
   // restore pattern data from eeprom
   restoreFromEEPROM();
 
-  // init LED strip with a default segment
+  // init LED strip and play the patterns
   ws2812fx.init();
-  ws2812fx.setBrightness(128);
-  ws2812fx.setSegment(0, 0, numLeds-1, FX_MODE_STATIC, RED, 3000, false);
+  ws2812fx.setPlaylist(patterns, numPatterns);
   ws2812fx.start();
 }
 
 void loop() {
-  ws2812fx.service();
+  ws2812fx.service(); // switches patterns when it's time
   server.handleClient();
-
-  // if it's time to change pattern, do it
-  unsigned long now = millis();
-  if(lastTime == 0 || (now - lastTime > patterns[currentPattern].duration * 1000)) {
-    ws2812fx.clear();
-    ws2812fx.resetSegments();
-
-    currentPattern = (currentPattern + 1) % numPatterns;
-    ws2812fx.setBrightness(patterns[currentPattern].brightness);
-    for(int i=0; i<patterns[currentPattern].numSegments; i++) {
-      WS2812FX::segment seg = patterns[currentPattern].segments[i];
-      ws2812fx.setSegment(i, seg.start, seg.stop, seg.mode, seg.colors, seg.speed, seg.reverse);
-    }
-    lastTime = now;
-  }
 }
 
 void configServer() {
@@ -131,18 +115,18 @@ void configServer() {
     server.send(404, "text/plain", "Page not found");
   });
 
-  // send the WS2812 mode info in JSON format
+  // send the WS2812 mode info in JSON format (the mode catalog is sent straight from flash)
   server.on("/getModes", [](){
-    char modes[1000] = "[";
-    for(uint8_t i=0; i < ws2812fx.getModeCount(); i++) {
-      strcat(modes, "\"");
-      strcat_P(modes, (PGM_P)ws2812fx.getModeName(i));
-      strcat(modes, "\",");
-    }
-    modes[strlen(modes)-1] = ']';
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.send_P(200, "application/json", (PGM_P)ws2812fx.getModesJSON());
+  });
 
+  // send the current brightness and segment setup in JSON format
+  server.on("/getState", [](){
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    server.send(200, "application/json", modes);
+    server.setContentLength(ws2812fx.getStateJSONLength());
+    server.send(200, "application/json", "");
+    ws2812fx.printStateJSON(server.client());
   });
 
   server.on("/upload", HTTP_OPTIONS, [](){ // CORS preflight request
@@ -160,6 +144,7 @@ void configServer() {
     DynamicJsonBuffer jsonBuffer(1000);
     JsonObject& deviceJson = jsonBuffer.parseObject(data);
     if (deviceJson.success()) {
+      ws2812fx.setPlaylist(NULL, 0); // stop playing before the patterns are changed
       ws2812fx.stop();
       ws2812fx.clear();
       ws2812fx.resetSegments();
@@ -213,8 +198,7 @@ void configServer() {
         saveToEEPROM();
       }
 
-      currentPattern = 0;
-      lastTime = 0;
+      ws2812fx.setPlaylist(patterns, numPatterns);
       ws2812fx.start();
     }
 
@@ -223,30 +207,30 @@ void configServer() {
   });
 }
 
-#define EEPROM_MAGIC_NUMBER 0x010e0d05
+#define CONFIG_RECORD 0 // user record holding pin, LED count and number of patterns
 void saveToEEPROM() {
   Serial.println("saving to EEPROM");
-  EEPROM.put(sizeof(int) * 0, (int)EEPROM_MAGIC_NUMBER);
-  EEPROM.put(sizeof(int) * 1, (int)ws2812fx.getPin());
-  EEPROM.put(sizeof(int) * 2, (int)ws2812fx.getLength());
-  EEPROM.put(sizeof(int) * 3, (int)numPatterns);
-  EEPROM.put(sizeof(int) * 4, patterns);
-  EEPROM.commit(); // for ESP8266 (comment out if using an Arduino)
+  uint8_t config[] = {ws2812fx.getPin(), (uint8_t)(ws2812fx.getLength() >> 8), (uint8_t)ws2812fx.getLength(), (uint8_t)numPatterns};
+  store.saveRecord(CONFIG_RECORD, config, sizeof(config));
+  for(int i=0; i < numPatterns; i++) {
+    store.savePattern(i, patterns[i]);
+  }
+  store.commit();
+  Serial.print("EEPROM bytes written so far: "); Serial.println(store.getBytesWritten());
 }
 
 void restoreFromEEPROM() {
-  int magicNumber = 0;
-  int pin;
-  int length;
-  EEPROM.get(sizeof(int) * 0, magicNumber);
-  if(magicNumber == EEPROM_MAGIC_NUMBER) {
+  uint8_t config[4];
+  store.begin();
+  if(store.loadRecord(CONFIG_RECORD, config, sizeof(config)) == sizeof(config)) {
     Serial.println("restoring from EEPROM");
-    EEPROM.get(sizeof(int) * 1, pin);
-    ws2812fx.setPin(pin);
-    EEPROM.get(sizeof(int) * 2, length);
-    ws2812fx.setLength(length);
-    EEPROM.get(sizeof(int) * 3, numPatterns);
-    EEPROM.get(sizeof(int) * 4, patterns);
+    ws2812fx.setPin(config[0]);
+    ws2812fx.setLength((config[1] << 8) | config[2]);
+    numPatterns = 0;
+    while(numPatterns < config[3] && store.loadPattern(numPatterns, patterns[numPatterns])) {
+      numPatterns++; // a damaged pattern ends the list
+    }
+    if(numPatterns == 0) numPatterns = 1;
   }
 }
 
@@ -105,6 +105,7 @@ char index_html[] PROGMEM = R"=====(
     var pin = "?";
     var numPixels = 30;
     var segmentIndex = 0;
+    var modeFlags = []; // see WS2812FX::getModeFlags()
     var segments = [
       {start: 0, stop: 9, mode:0, speed:200, reverse:false, colors:['#ff0000','#00ff00','#0000ff']}
     ];
@@ -243,6 +244,12 @@ char index_html[] PROGMEM = R"=====(
         $('#color0').val(segments[segmentIndex].colors[0]);
         $('#color1').val(segments[segmentIndex].colors[1]);
         $('#color2').val(segments[segmentIndex].colors[2]);
+
+        // only offer the colors the mode uses (the lowest two bits of its flags)
+        var numColors = (modeFlags.length > 0) ? modeFlags[segments[segmentIndex].mode] & 0x03 : 3;
+        for (var i = 0; i < 3; i++) {
+          $('#color' + i).toggle(i < numColors);
+        }
       }
     }
 
@@ -307,6 +314,10 @@ char index_html[] PROGMEM = R"=====(
         $.each(data, function (i, item) {
           $('#modes').append(new Option(item, i));
         });
+        $.getJSON("getmodeflags", function(data){
+          modeFlags = data;
+          updateWidgets();
+        });
         updateWidgets();
       });
     }
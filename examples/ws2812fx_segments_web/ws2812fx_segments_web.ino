@@ -35,6 +35,8 @@
   CHANGELOG
   2017-10-02 initial version
   2017-10-08 added web interface
+  2026-10-18 stream segment and mode JSON from the library
+  2026-10-18 render in slices of 2ms, so requests are handled in between
   
 */
 
@@ -42,6 +44,7 @@
 #include <ESP8266WebServer.h>
 #include <ArduinoJson.h>
 #include <ArduinoOTA.h>
+#include <StreamString.h>
 
 extern const char index_html[];
 
@@ -107,35 +110,9 @@ void setup() {
 
   // send the segment info in JSON format
   server.on("/getsegments", [](){
-    DynamicJsonBuffer jsonBuffer(1000);
-    JsonObject& root = jsonBuffer.createObject();
-    root["pin"] = ws2812fx.getPin();
-    root["numPixels"] = ws2812fx.numPixels();
-    root["numSegments"] = ws2812fx.getNumSegments();
-    JsonArray& jsonSegments = root.createNestedArray("segments");
-
-    WS2812FX::segment* segments = ws2812fx.getSegments();
-    for(int i=0; i<ws2812fx.getNumSegments(); i++) {
-      WS2812FX::segment seg = segments[i];
-      JsonObject& jsonSegment = jsonBuffer.createObject();
-      jsonSegment["start"] = seg.start;
-      jsonSegment["stop"] = seg.stop;
-      jsonSegment["mode"] = seg.mode;
-      jsonSegment["speed"] = seg.speed;
-      jsonSegment["reverse"] = seg.reverse;
-      JsonArray& jsonColors = jsonSegment.createNestedArray("colors");
-      jsonColors.add(seg.colors[0]); // the web interface expects three color values
-      jsonColors.add(seg.colors[1]);
-      jsonColors.add(seg.colors[2]);
-      jsonSegments.add(jsonSegment);
-    }
-    // root.printTo(Serial);
-
-    int bufferSize = root.measureLength() + 1;
-    char *json = (char*)malloc(sizeof(char) * (bufferSize));
-    root.printTo(json, sizeof(char) * bufferSize);
-    server.send(200, "application/json", json);
-    free(json);
+    server.setContentLength(ws2812fx.getStateJSONLength());
+    server.send(200, "application/json", "");
+    ws2812fx.printStateJSON(server.client());
   });
 
   // receive the segment info in JSON format and setup the WS2812 strip
@@ -161,19 +138,16 @@ void setup() {
     server.send(200, "text/plain", "OK");
   });
 
-  // send the WS2812 mode info
+  // send the WS2812 mode info (the mode catalog is sent straight from flash)
   server.on("/getmodes", [](){
-    DynamicJsonBuffer jsonBuffer(1000);
-    JsonArray& root = jsonBuffer.createArray();
-    for(uint8_t i=0; i < ws2812fx.getModeCount(); i++) {
-      root.add(ws2812fx.getModeName(i));
-    }
+    server.send_P(200, "application/json", (PGM_P)ws2812fx.getModesJSON());
+  });
 
-    int bufferSize = root.measureLength() + 1;
-    char *json = (char*)malloc(sizeof(char) * (bufferSize));
-    root.printTo(json, sizeof(char) * bufferSize);
-    server.send(200, "application/json", json);
-    free(json);
+  // send the flags of the modes, e.g. how many colors each one uses
+  server.on("/getmodeflags", [](){
+    StreamString flags;
+    ws2812fx.printModeFlagsJSON(flags);
+    server.send(200, "application/json", flags);
   });
 
   server.onNotFound([](){
@@ -192,7 +166,7 @@ void setup() {
 }
 
 void loop() {
-  ws2812fx.service();
+  ws2812fx.service(2000); // a frame of many long segments takes several calls
   server.handleClient();
   ArduinoOTA.handle();
 }
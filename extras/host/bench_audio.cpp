@@ -0,0 +1,27 @@
+/*
+  bench_audio.cpp - Time WS2812FXAudio::analyze() takes for one window of
+  AUDIO_FFT_SIZE samples.
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXAudio.h"
+#include "host.h"
+#include <math.h>
+
+#define RATE 8000
+#define WINDOWS 20000
+
+int main() {
+  int16_t samples[AUDIO_FFT_SIZE];
+  for(int i=0; i<AUDIO_FFT_SIZE; i++) samples[i] = (int16_t)(10000 * sin(2 * M_PI * 440 * i / RATE)) + random(-500, 500);
+
+  WS2812FXAudio audio(RATE);
+  double start = now_us();
+  for(int i=0; i<WINDOWS; i++) {
+    audio.addSamples(samples, AUDIO_FFT_SIZE);
+    audio.analyze();
+  }
+  double t = (now_us() - start) / WINDOWS;
+  printf("audio: %.2f us per window of %d samples, %u analyzed\n", t, AUDIO_FFT_SIZE, (unsigned)audio.getWindows());
+  return 0;
+}
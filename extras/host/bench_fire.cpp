@@ -0,0 +1,68 @@
+/*
+  bench_fire.cpp - Time per frame of Fire per 1000 LEDs at a few strip
+  lengths, against Fire Flicker, and of its diffusion kernel alone: in
+  place, as the mode does it, and into a second buffer.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define FRAMES 2000
+#define ROUNDS 20
+#define KERNEL_LEN 1000
+#define KERNEL_ROUNDS 20000
+
+static double frame_us(uint16_t leds, uint8_t mode) {
+  WS2812FX ws2812fx(leds, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, leds - 1, mode, RED, 1000, false);
+  ws2812fx.setSegmentMemory(0, leds);
+  ws2812fx.start();
+  randomSeed(1);
+  double best = 1e9;
+  for(int r=0; r < ROUNDS; r++) {
+    double start = now_us();
+    for(int i=0; i < FRAMES / ROUNDS; i++) {
+      advance_ms(1001); // every call renders
+      ws2812fx.service();
+    }
+    best = min(best, (now_us() - start) / (FRAMES / ROUNDS));
+  }
+  return best;
+}
+
+volatile unsigned sink;
+
+int main() {
+  uint16_t lengths[] = {60, 300, 1000, 3000};
+  for(uint8_t i=0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    double fire = frame_us(lengths[i], FX_MODE_FIRE);
+    double flicker = frame_us(lengths[i], FX_MODE_FIRE_FLICKER);
+    printf("fire: %4u LEDs, Fire %8.2f us/frame (%6.2f per 1000 LEDs), Fire Flicker %8.2f us/frame\n",
+      lengths[i], fire, fire * 1000 / lengths[i], flicker);
+  }
+
+  // the diffusion step, heat drifting up by one LED per frame
+  static uint8_t heat[KERNEL_LEN], next[KERNEL_LEN];
+  for(uint16_t i=0; i < KERNEL_LEN; i++) heat[i] = next[i] = (i * 37) & 0xFF;
+  double best_in_place = 1e9, best_copy = 1e9;
+  for(int r=0; r < ROUNDS; r++) {
+    double start = now_us();
+    for(int k=0; k < KERNEL_ROUNDS / ROUNDS; k++) {
+      heat[0] = k;
+      for(uint16_t i=KERNEL_LEN - 1; i >= 2; i--) heat[i] = ((heat[i - 1] + 2 * heat[i - 2]) * 85) >> 8;
+    }
+    best_in_place = min(best_in_place, (now_us() - start) / (KERNEL_ROUNDS / ROUNDS));
+    start = now_us();
+    for(int k=0; k < KERNEL_ROUNDS / ROUNDS; k++) {
+      next[0] = k;
+      for(uint16_t i=2; i < KERNEL_LEN; i++) next[i] = (heat[i - 1] + 2 * heat[i - 2]) / 3;
+      memcpy(heat, next, KERNEL_LEN);
+    }
+    best_copy = min(best_copy, (now_us() - start) / (KERNEL_ROUNDS / ROUNDS));
+  }
+  sink = heat[KERNEL_LEN / 2];
+  printf("fire: diffusion of %u LEDs, in place %.2f us, into a second buffer %.2f us\n", KERNEL_LEN, best_in_place, best_copy);
+  return 0;
+}
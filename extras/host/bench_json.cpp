@@ -0,0 +1,100 @@
+/*
+  bench_json.cpp - Response time and heap of the mode list and state
+  requests, the way the web examples answered them before (String built in
+  setup(), strcat into a stack buffer) and with the library's JSON output.
+  Only the server side is measured, into a client which takes any write.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define REQUESTS 20000
+
+// stands in for the WiFiClient of the web server
+class Client : public Print {
+  public:
+    size_t write(uint8_t c) { sum += c; bytes++; return 1; }
+    size_t write(const uint8_t* b, size_t n) { for(size_t i=0; i<n; i++) sum += b[i]; bytes += n; return n; }
+    unsigned long sum = 0, bytes = 0;
+};
+
+static WS2812FX ws2812fx(300, 5, NEO_GRB + NEO_KHZ800);
+static Client client;
+static String* modes;
+
+// esp8266_webinterface: the <li> list was built once by modes_setup()
+static void old_webinterface_setup(void) {
+  modes = new String();
+  modes->reserve(5000);
+  for(uint8_t m=0; m < ws2812fx.getModeCount(); m++) {
+    *modes += "<li><a href='#' class='m' id='";
+    *modes += m;
+    *modes += "'>";
+    *modes += ws2812fx.getModeName(m);
+    *modes += "</a></li>";
+  }
+}
+
+static void old_webinterface_modes(void) {
+  client.write((const uint8_t*)modes->c_str(), modes->length()); // server.send(200, "text/plain", modes)
+}
+
+// ws2812fx_patterns_web: /getModes built the list into a stack buffer on every request
+// (1000 bytes then, the names have outgrown that since, so it's bigger here)
+static void old_patterns_web_modes(void) {
+  char modes[2000] = "[";
+  for(uint8_t i=0; i < ws2812fx.getModeCount(); i++) {
+    strcat(modes, "\"");
+    strcat_P(modes, (PGM_P)ws2812fx.getModeName(i));
+    strcat(modes, "\",");
+  }
+  modes[strlen(modes)-1] = ']';
+  String content(modes); // server.send() takes the content as a String
+  client.write((const uint8_t*)content.c_str(), content.length());
+}
+
+static void new_modes(void) {
+  ws2812fx.printModesJSON(client); // what server.send_P() of getModesJSON() does
+}
+
+static void new_state(void) {
+  ws2812fx.getStateJSONLength(); // server.setContentLength()
+  ws2812fx.printStateJSON(client);
+}
+
+static void measure(const char* name, void (*request)(void), size_t resident) {
+  size_t used = heap_used, allocs = heap_allocs;
+  heap_peak = heap_used;
+  client.bytes = 0;
+  request();
+  unsigned long bytes = client.bytes;
+  size_t peak = heap_peak - used;
+  size_t calls = heap_allocs - allocs;
+
+  double best = 1e9;
+  for(int r=0; r<5; r++) {
+    double start = now_us();
+    for(int i=0; i<REQUESTS / 5; i++) request();
+    best = min(best, (now_us() - start) / (REQUESTS / 5));
+  }
+  printf("json: %-26s %5lu bytes, %6.2f us/request, heap: %4u resident, %4u peak per request, %u allocations\n",
+    name, bytes, best, (unsigned)resident, (unsigned)peak, (unsigned)calls);
+}
+
+int main() {
+  ws2812fx.init();
+  for(uint8_t i=0; i<MAX_NUM_SEGMENTS; i++) {
+    ws2812fx.setSegment(i, i * 30, i * 30 + 29, i, RED, 1000, false);
+  }
+
+  size_t used = heap_used;
+  double start = now_us();
+  old_webinterface_setup();
+  printf("json: old webinterface modes_setup() %.2f us, once\n", now_us() - start);
+  measure("old webinterface /modes", old_webinterface_modes, heap_used - used);
+  measure("old patterns_web /getModes", old_patterns_web_modes, 0);
+  measure("printModesJSON()", new_modes, 0);
+  measure("printStateJSON()", new_state, 0);
+  delete modes;
+  return 0;
+}
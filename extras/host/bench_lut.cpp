@@ -0,0 +1,74 @@
+/*
+  bench_lut.cpp - Sending a frame of 1000 LEDs with gamma and white balance
+  through the lookup table, against brightness only and against scaling
+  every byte as it's written, with and without pow() for the gamma. Then
+  what rebuilding the table costs when the brightness changes (the gamma
+  curve is kept) and when the gamma changes (pow() runs 256 times).
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define LEDS 1000
+#define FRAMES 2000
+#define ROUNDS 20
+
+volatile unsigned sink;
+
+static double show_us(WS2812FX& ws2812fx, float gamma, uint32_t balance, bool vary_brightness, bool vary_gamma) {
+  ws2812fx.setGamma(gamma);
+  ws2812fx.setColorCorrection(balance);
+  double best = 1e9;
+  for(int r=0; r < ROUNDS; r++) {
+    double start = now_us();
+    for(int f=0; f < FRAMES / ROUNDS; f++) {
+      if(vary_brightness) ws2812fx.setBrightness(100 + (f & 1));
+      if(vary_gamma) ws2812fx.setGamma(gamma + (f & 1) * 0.1);
+      ws2812fx.show();
+    }
+    best = min(best, (now_us() - start) / (FRAMES / ROUNDS));
+  }
+  return best;
+}
+
+int main() {
+  WS2812FX ws2812fx(LEDS, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(200);
+  for(uint16_t i=0; i < LEDS; i++) ws2812fx.setPixelColor(i, i * 0x030507);
+
+  double plain = show_us(ws2812fx, 1.0, 0xFFFFFFFF, false, false);
+  double lut = show_us(ws2812fx, 2.2, 0xFFFFB0F0, false, false);
+  double brightness = show_us(ws2812fx, 2.2, 0xFFFFB0F0, true, false);
+  double gamma = show_us(ws2812fx, 2.2, 0xFFFFB0F0, false, true);
+  printf("lut: %d LEDs, show() brightness only %.2f us, gamma + white balance %.2f us\n", LEDS, plain, lut);
+  printf("lut: with the brightness changing every frame %.2f us, the gamma %.2f us\n", brightness, gamma);
+
+  // scaling every byte when it's written, as setPixelColor() would have to
+  uint16_t balance[] = {0xFF + 1, 0xB0 + 1, 0xF0 + 1};
+  uint16_t scale = 201;
+  static uint8_t out[LEDS * 3];
+  double best_mul = 1e9, best_pow = 1e9;
+  for(int r=0; r < ROUNDS; r++) {
+    double start = now_us();
+    for(int f=0; f < FRAMES / ROUNDS; f++) {
+      for(uint16_t i=0; i < LEDS * 3; i++) {
+        uint8_t v = (i * 0x07 + f) & 0xFF;
+        out[i] = (((v * balance[i % 3]) >> 8) * scale) >> 8;
+      }
+    }
+    best_mul = min(best_mul, (now_us() - start) / (FRAMES / ROUNDS));
+    start = now_us();
+    for(int f=0; f < FRAMES / ROUNDS / 10; f++) {
+      for(uint16_t i=0; i < LEDS * 3; i++) {
+        uint8_t v = (i * 0x07 + f) & 0xFF;
+        uint16_t g = (uint16_t)(pow(v / 255.0, 2.2) * 255.0 + 0.5);
+        out[i] = (((g * balance[i % 3]) >> 8) * scale) >> 8;
+      }
+    }
+    best_pow = min(best_pow, (now_us() - start) / (FRAMES / ROUNDS / 10));
+  }
+  sink = out[LEDS];
+  printf("lut: per write, white balance and brightness %.2f us, with pow() for the gamma %.2f us\n", best_mul, best_pow);
+  return 0;
+}
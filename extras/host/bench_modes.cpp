@@ -0,0 +1,36 @@
+/*
+  bench_modes.cpp - Time per frame of every built-in mode on 300 LEDs,
+  rendering and output, every call renders a frame. Builds against the
+  original library as well, for a before and after.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define LEDS 300
+#define FRAMES 5000
+#define ROUNDS 50
+
+int main() {
+  WS2812FX ws2812fx(LEDS, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  for(uint8_t m=0; m < ws2812fx.getModeCount(); m++) {
+    if(m == FX_MODE_CUSTOM) continue;
+    randomSeed(m + 1);
+    ws2812fx.setSegment(0, 0, LEDS - 1, m, RED, 1000, false);
+    ws2812fx.start();
+    double best = 1e9;
+    for(int r=0; r < ROUNDS; r++) {
+      double start = now_us();
+      for(int i=0; i < FRAMES / ROUNDS; i++) {
+        advance_ms(1001); // longer than any mode's delay, so every call renders
+        ws2812fx.service();
+      }
+      best = min(best, (now_us() - start) / (FRAMES / ROUNDS));
+    }
+    ws2812fx.stop();
+    printf("modes: %2u %-26s %7.2f us/frame\n", m, (const char*)ws2812fx.getModeName(m), best);
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*
+  bench_noise.cpp - WS2812FXNoise::fill() against fractal8() per LED and
+  against float Perlin noise as a custom effect would write it, then the
+  frame time of the noise modes on 1000 LEDs.
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXNoise.h"
+#include "host.h"
+#include <math.h>
+
+#define LEDS 1000
+#define ROWS 5000
+
+// Ken Perlin's improved noise, in float
+static int perm[512];
+static float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+static float lerp(float t, float a, float b) { return a + t * (b - a); }
+static float grad(int h, float x, float y, float z) {
+  h &= 15;
+  float u = h < 8 ? x : y, v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+  return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+static float perlin(float x, float y, float z) {
+  int X = (int)floorf(x) & 255, Y = (int)floorf(y) & 255, Z = (int)floorf(z) & 255;
+  x -= floorf(x);
+  y -= floorf(y);
+  z -= floorf(z);
+  float u = fade(x), v = fade(y), w = fade(z);
+  int A = perm[X] + Y, AA = perm[A] + Z, AB = perm[A + 1] + Z, B = perm[X + 1] + Y, BA = perm[B] + Z, BB = perm[B + 1] + Z;
+  return lerp(w, lerp(v, lerp(u, grad(perm[AA], x, y, z), grad(perm[BA], x - 1, y, z)),
+                         lerp(u, grad(perm[AB], x, y - 1, z), grad(perm[BB], x - 1, y - 1, z))),
+                 lerp(v, lerp(u, grad(perm[AA + 1], x, y, z - 1), grad(perm[BA + 1], x - 1, y, z - 1)),
+                         lerp(u, grad(perm[AB + 1], x, y - 1, z - 1), grad(perm[BB + 1], x - 1, y - 1, z - 1))));
+}
+
+volatile unsigned sink;
+
+int main() {
+  for(int i=0; i<256; i++) perm[i] = perm[i + 256] = (i * 151 + 7) & 255;
+  uint8_t row[LEDS];
+  unsigned acc = 0;
+
+  for(uint8_t octaves=1; octaves<=3; octaves++) {
+    double t0 = now_us();
+    for(int r=0; r<ROWS; r++) {
+      WS2812FXNoise::fill(row, LEDS, r * 5, 16, 0, r * 2, octaves);
+      acc += row[r % LEDS];
+    }
+    double t1 = now_us();
+    for(int r=0; r<ROWS/10; r++) {
+      for(int i=0; i<LEDS; i++) row[i] = WS2812FXNoise::fractal8(r * 5 + i * 16, 0, r * 2, octaves);
+      acc += row[r % LEDS];
+    }
+    double t2 = now_us();
+    for(int r=0; r<ROWS/10; r++) {
+      for(int i=0; i<LEDS; i++) {
+        float s = 0, a = 1, f = 1, total = 0;
+        for(int o=0; o<octaves; o++) {
+          s += a * perlin((r * 5 + i * 16) / 256.0f * f, 0.5f, r * 2 / 256.0f * f);
+          total += a;
+          a *= 0.5f;
+          f *= 2;
+        }
+        row[i] = (uint8_t)fminf(255, fmaxf(0, 128 + s / total * 160));
+      }
+      acc += row[r % LEDS];
+    }
+    double t3 = now_us();
+    printf("noise: %u octave(s), fill() %.1f ns, fractal8() %.1f ns, float %.1f ns per LED\n", octaves,
+      (t1 - t0) * 1000 / ROWS / LEDS, (t2 - t1) * 1000 / (ROWS / 10) / LEDS, (t3 - t2) * 1000 / (ROWS / 10) / LEDS);
+  }
+  sink = acc;
+
+  WS2812FX ws2812fx(LEDS, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  uint8_t modes[] = {FX_MODE_NOISE_LAVA, FX_MODE_NOISE_OCEAN, FX_MODE_NOISE_CLOUDS, FX_MODE_RAINBOW_CYCLE};
+  for(uint8_t i=0; i<sizeof(modes); i++) {
+    ws2812fx.setSegment(0, 0, LEDS - 1, modes[i], RED, 1000, false);
+    ws2812fx.start();
+    double start = now_us();
+    for(int f=0; f<2000; f++) {
+      advance_ms(20);
+      ws2812fx.service();
+    }
+    printf("noise: %-14s %.1f us per frame of %d LEDs\n", (const char*)ws2812fx.getModeName(modes[i]), (now_us() - start) / 2000, LEDS);
+  }
+  return 0;
+}
@@ -0,0 +1,37 @@
+/*
+  bench_outputs.cpp - Frame time of 8000 LEDs split over eight in-memory
+  outputs of 1000 LEDs each (render, conversion and copy).
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXOutput.h"
+#include "host.h"
+
+#define OUTPUTS 8
+#define OUTPUT_LEDS 1000
+#define FRAMES 2000
+
+int main() {
+  WS2812FX ws2812fx(OUTPUTS * OUTPUT_LEDS, 5, NEO_GRB + NEO_KHZ800);
+  RAMOutput* outputs[OUTPUTS];
+
+  ws2812fx.init();
+  ws2812fx.setBrightness(128);
+  for(int i=0; i<OUTPUTS; i++) {
+    outputs[i] = new RAMOutput(OUTPUT_LEDS);
+    ws2812fx.addOutput(*outputs[i], i * OUTPUT_LEDS);
+    ws2812fx.setSegment(i, i * OUTPUT_LEDS, (i + 1) * OUTPUT_LEDS - 1, FX_MODE_RAINBOW_CYCLE, RED, 10, false);
+  }
+  ws2812fx.start();
+
+  double start = now_us();
+  for(int i=0; i<FRAMES; i++) {
+    advance_ms(11);
+    ws2812fx.service();
+  }
+  double t = (now_us() - start) / FRAMES;
+  printf("outputs: %d x %d LEDs, %.1f us/frame, %u frames each\n", OUTPUTS, OUTPUT_LEDS, t, outputs[OUTPUTS - 1]->getFrames());
+
+  for(int i=0; i<OUTPUTS; i++) delete outputs[i];
+  return 0;
+}
@@ -0,0 +1,53 @@
+/*
+  bench_particles.cpp - Frame time of Multi Comet by pool size and strip
+  length, next to modes which draw every LED.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define FRAMES 300
+
+static double frame_time(WS2812FX& ws2812fx, long* live) {
+  double start = now_us();
+  for(int f=0; f<FRAMES; f++) {
+    advance_ms(16);
+    ws2812fx.service();
+    *live += ws2812fx.getParticleCount(0);
+  }
+  return (now_us() - start) / FRAMES;
+}
+
+int main() {
+  uint16_t lengths[] = {1000, 4000};
+  uint16_t pools[] = {16, 64, 128, 256};
+  uint8_t modes[] = {FX_MODE_COMET, FX_MODE_FIREWORKS, FX_MODE_LARSON_SCANNER};
+
+  for(uint8_t l=0; l<2; l++) {
+    uint16_t len = lengths[l];
+    for(uint8_t p=0; p<4; p++) {
+      WS2812FX ws2812fx(len, 5, NEO_GRB + NEO_KHZ800);
+      ws2812fx.init();
+      ws2812fx.setSegment(0, 0, len - 1, FX_MODE_MULTI_COMET, RED, 1000, false);
+      ws2812fx.start();
+      ws2812fx.setParticles(0, pools[p]);
+      for(long f=0; f<200000 && ws2812fx.getParticleCount(0) < pools[p]; f++) { // fill the pool
+        advance_ms(16);
+        ws2812fx.service();
+      }
+      long live = 0;
+      double t = frame_time(ws2812fx, &live);
+      printf("particles: %4u LEDs, pool %3u, %5.1f alive, %.1f us/frame\n", len, pools[p], (double)live / FRAMES, t);
+    }
+    for(uint8_t m=0; m<sizeof(modes); m++) {
+      WS2812FX ws2812fx(len, 5, NEO_GRB + NEO_KHZ800);
+      ws2812fx.init();
+      ws2812fx.setSegment(0, 0, len - 1, modes[m], RED, 1000, false);
+      ws2812fx.start();
+      long live = 0;
+      double t = frame_time(ws2812fx, &live);
+      printf("particles: %4u LEDs, %s, %.1f us/frame\n", len, (const char*)ws2812fx.getModeName(modes[m]), t);
+    }
+  }
+  return 0;
+}
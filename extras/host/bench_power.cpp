@@ -0,0 +1,63 @@
+/*
+  bench_power.cpp - Frame time of 1000 LEDs with the current limiter off,
+  on but under budget and on and dimming, with brightness only and with
+  gamma (lookup table), for a plain and a mirrored segment.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define LEDS 1000
+#define FRAMES 500
+#define ROUNDS 200
+
+int main() {
+  const char* names[] = {"plain", "mirrored"};
+  uint8_t options[] = {0, SEGMENT_OPTION_MIRROR};
+  uint32_t budgets[] = {0, 1000000, 5000};
+  WS2812FX* fx[2][2][3];
+  double best[2][2][3];
+
+  for(int g=0; g<2; g++) {
+    for(int o=0; o<2; o++) {
+      for(int b=0; b<3; b++) {
+        WS2812FX* ws2812fx = fx[g][o][b] = new WS2812FX(LEDS, 5, NEO_GRB + NEO_KHZ800);
+        ws2812fx->init();
+        ws2812fx->setBrightness(255);
+        ws2812fx->setGamma(g ? 2.2 : 1.0);
+        ws2812fx->setMaxCurrent(budgets[b]);
+        ws2812fx->setSegment(0, 0, LEDS - 1, FX_MODE_RAINBOW_CYCLE, RED, 10, options[o]);
+        ws2812fx->start();
+        best[g][o][b] = 1e9;
+      }
+    }
+  }
+
+  // the configurations take turns, the best round of each counts, which
+  // keeps the noise of the rest of the system out
+  for(int r=0; r<ROUNDS; r++) {
+    for(int g=0; g<2; g++) {
+      for(int o=0; o<2; o++) {
+        for(int b=0; b<3; b++) {
+          double start = now_us();
+          for(int i=0; i<FRAMES; i++) {
+            advance_ms(11);
+            fx[g][o][b]->service();
+          }
+          best[g][o][b] = min(best[g][o][b], (now_us() - start) / FRAMES);
+        }
+      }
+    }
+  }
+
+  for(int g=0; g<2; g++) {
+    for(int o=0; o<2; o++) {
+      double* t = best[g][o];
+      printf("power: %d LEDs, %s, %s: limiter off %.2f us/frame, under budget %.2f (%+.1f%%), dimming %.2f (%+.1f%%), %u mA\n",
+        LEDS, g ? "gamma" : "brightness", names[o], t[0], t[1], (t[1] / t[0] - 1) * 100, t[2], (t[2] / t[0] - 1) * 100,
+        fx[g][o][2]->getPowerEstimate());
+      for(int b=0; b<3; b++) delete fx[g][o][b];
+    }
+  }
+  return 0;
+}
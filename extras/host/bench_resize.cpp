@@ -0,0 +1,34 @@
+/*
+  bench_resize.cpp - Time and allocations of setLength() plus a frame, on
+  the heap and on a pixel buffer of the sketch.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define RESIZES 1000
+
+static uint8_t pixelBuffer[1000 * 6];
+
+static void resizes(WS2812FX& ws2812fx, const char* name) {
+  size_t allocs = heap_allocs;
+  double start = now_us();
+  for(int i=0; i<RESIZES; i++) {
+    ws2812fx.setLength(100 + (i * 37) % 900);
+    advance_ms(20);
+    ws2812fx.service();
+  }
+  double t = (now_us() - start) / RESIZES;
+  printf("resize: %-6s %.2f us per resize and frame, %u allocations\n", name, t, (unsigned)(heap_allocs - allocs));
+}
+
+int main() {
+  WS2812FX ws2812fx(300, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setSegment(0, 0, 299, FX_MODE_STATIC, RED, 1000, false);
+  ws2812fx.start();
+  resizes(ws2812fx, "heap");
+  ws2812fx.setPixelBuffer(pixelBuffer, sizeof(pixelBuffer));
+  resizes(ws2812fx, "buffer");
+  return 0;
+}
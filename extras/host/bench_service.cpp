@@ -0,0 +1,65 @@
+/*
+  bench_service.cpp - How long a single service() call keeps the loop busy
+  with 10 segments of 1500 LEDs, all due every frame: without a budget every
+  call renders and sends a whole frame, with one the frame is spread over
+  several calls. Prints the mean, p99.9 and max per call and per frame.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define SEGMENTS 10
+#define SEGMENT_LEN 1500
+#define FRAMES 2000
+#define MAX_CALLS (FRAMES * 50)
+
+static double calls[MAX_CALLS], frames[FRAMES];
+
+static int compare(const void* a, const void* b) {
+  return (*(const double*)a > *(const double*)b) - (*(const double*)a < *(const double*)b);
+}
+
+static double percentile(double* v, size_t n, double p) {
+  qsort(v, n, sizeof(double), compare);
+  return v[min(n - 1, (size_t)(n * p))];
+}
+
+int main() {
+  uint8_t modes[SEGMENTS] = {FX_MODE_RAINBOW_CYCLE, FX_MODE_FIRE, FX_MODE_NOISE_LAVA, FX_MODE_RUNNING_LIGHTS,
+    FX_MODE_COMET, FX_MODE_TWINKLE_FADE, FX_MODE_LARSON_SCANNER, FX_MODE_FIREWORKS, FX_MODE_THEATER_CHASE_RAINBOW,
+    FX_MODE_BREATH};
+  WS2812FX ws2812fx(SEGMENTS * SEGMENT_LEN, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  for(uint8_t i=0; i < SEGMENTS; i++) {
+    ws2812fx.setSegment(i, i * SEGMENT_LEN, (i + 1) * SEGMENT_LEN - 1, modes[i], RED, 1000, false);
+  }
+  ws2812fx.start();
+  real_micros = true; // the budget is measured in real time
+
+  uint16_t budgets[] = {0, 200, 50};
+  for(uint8_t b=0; b < sizeof(budgets) / sizeof(budgets[0]); b++) {
+    size_t n = 0;
+    for(int f=0; f < FRAMES; f++) {
+      advance_ms(1001); // every segment is due
+      unsigned long shows = Adafruit_NeoPixel::showCount;
+      double frame = 0;
+      do {
+        double start = now_us();
+        ws2812fx.service(budgets[b]);
+        double t = now_us() - start;
+        calls[n++] = t;
+        frame += t;
+      } while(Adafruit_NeoPixel::showCount == shows && n < MAX_CALLS);
+      frames[f] = frame;
+    }
+    double mean = 0;
+    for(size_t i=0; i < n; i++) mean += calls[i];
+    mean /= n;
+    double p999 = percentile(calls, n, 0.999);
+    double frame_p999 = percentile(frames, FRAMES, 0.999);
+    printf("service: %ux%u LEDs, budget %4u us: %5.2f calls/frame, per call mean %7.1f us, p99.9 %7.1f us, max %7.1f us; "
+      "per frame p99.9 %7.1f us\n", SEGMENTS, SEGMENT_LEN, budgets[b], (double)n / FRAMES, mean, p999, calls[n - 1], frame_p999);
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+/*
+  bench_shift.cpp - What moving a segment by one pixel costs by its length:
+  shift() against the pixel by pixel copy Running Random used before, with
+  getPixelColor() and setPixelColor().
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define ROUNDS 20
+#define PIXELS_PER_ROUND 2000000UL
+
+int main() {
+  uint16_t lengths[] = {10, 100, 1000, 10000};
+  for(uint8_t l=0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+    uint16_t len = lengths[l];
+    WS2812FX ws2812fx(len, 5, NEO_GRB + NEO_KHZ800);
+    ws2812fx.init();
+    ws2812fx.setBrightness(255);
+    ws2812fx.setSegment(0, 0, len - 1, FX_MODE_STATIC, RED, 1000, false);
+    for(uint16_t i=0; i < len; i++) ws2812fx.setPixelColor(i, i * 0x010203);
+    unsigned long calls = PIXELS_PER_ROUND / len;
+
+    double best_shift = 1e9, best_loop = 1e9;
+    for(int r=0; r < ROUNDS; r++) {
+      double start = now_us();
+      for(unsigned long c=0; c < calls; c++) ws2812fx.shift(0, 1);
+      best_shift = min(best_shift, (now_us() - start) / calls);
+      start = now_us();
+      for(unsigned long c=0; c < calls; c++) {
+        for(uint16_t i=len - 1; i > 0; i--) ws2812fx.setPixelColor(i, ws2812fx.getPixelColor(i - 1));
+      }
+      best_loop = min(best_loop, (now_us() - start) / calls);
+    }
+    printf("shift: %5u LEDs, shift() %9.3f us (%6.3f ns/LED), pixel by pixel %9.3f us (%6.3f ns/LED)\n",
+      len, best_shift, best_shift * 1000 / len, best_loop, best_loop * 1000 / len);
+  }
+  return 0;
+}
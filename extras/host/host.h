@@ -0,0 +1,36 @@
+/*
+  host.h - Helpers shared by the host tests and benchmarks.
+
+  A test reports every failed CHECK() and returns non-zero from main() with
+  done(). A benchmark prints its timings, measured with now_us(). Both can
+  watch the heap through heap_used, heap_peak and heap_allocs.
+*/
+
+#ifndef WS2812FX_HOST_H
+#define WS2812FX_HOST_H
+
+#include <stdio.h>
+#include <time.h>
+
+// heap use of everything linked in, see stub/heap.cpp
+extern size_t heap_used, heap_peak, heap_allocs, heap_limit;
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); failures++; } \
+  } while(0)
+
+static inline int done(const char* name) {
+  printf("%s: %s\n", name, failures ? "FAILED" : "ok");
+  return failures ? 1 : 0;
+}
+
+// wall clock time, unlike micros(), which only moves with advance_ms()
+static inline double now_us(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+#endif
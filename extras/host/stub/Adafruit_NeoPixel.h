@@ -0,0 +1,42 @@
+/*
+  Adafruit_NeoPixel.h - The Adafruit_NeoPixel interface used by the library,
+  for the host build. show() only counts and copies the frame.
+*/
+
+#ifndef ADAFRUIT_NEOPIXEL_H
+#define ADAFRUIT_NEOPIXEL_H
+#include "Arduino.h"
+#define NEO_RGB  ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB  ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_RGBW ((3 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRBW ((3 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+typedef uint16_t neoPixelType;
+class Adafruit_NeoPixel {
+ public:
+  Adafruit_NeoPixel(uint16_t n, uint8_t p=6, neoPixelType t=NEO_GRB + NEO_KHZ800);
+  Adafruit_NeoPixel(void);
+  ~Adafruit_NeoPixel();
+  void begin(void), show(void), setPin(uint8_t p),
+    setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b),
+    setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w),
+    setPixelColor(uint16_t n, uint32_t c), setBrightness(uint8_t), clear(),
+    updateLength(uint16_t n), updateType(neoPixelType t);
+  uint8_t *getPixels(void) const;
+  uint8_t getBrightness(void) const;
+  int8_t getPin(void) { return pin; };
+  uint16_t numPixels(void) const;
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b), Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w);
+  uint32_t getPixelColor(uint16_t n) const;
+  inline bool canShow(void) { return true; }
+  static unsigned long showCount;
+  static uint16_t lastShowLen; static uint8_t lastShow[4096];
+ protected:
+  boolean is800KHz, begun;
+  uint16_t numLEDs, numBytes;
+  int8_t pin;
+  uint8_t brightness, *pixels, rOffset, gOffset, bOffset, wOffset;
+  uint32_t endTime;
+};
+#endif
@@ -0,0 +1,183 @@
+/*
+  Arduino.cpp - The parts of the Arduino core and Adafruit_NeoPixel the
+  library needs, for the host build.
+
+  millis() and micros() only move with advance_ms(), so a run is the same
+  every time (unless a benchmark sets real_micros, for service() budgets).
+  random() is a fixed LCG for the same reason. show() keeps a copy of the
+  last frame sent in lastShow.
+*/
+
+#include "Adafruit_NeoPixel.h"
+#include <time.h>
+
+static unsigned long fake_ms = 0, fake_us = 0;
+static unsigned long rnd = 12345;
+
+bool real_micros = false;
+
+unsigned long millis(void) { return fake_ms; }
+unsigned long micros(void) {
+  if(!real_micros) return fake_us;
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return fake_us + t.tv_sec * 1000000UL + t.tv_nsec / 1000;
+}
+
+void delay(unsigned long d) { (void)d; }
+void advance_ms(unsigned long d) { fake_ms += d; fake_us += d * 1000; }
+
+long random(long h) {
+  rnd = rnd * 1103515245UL + 12345UL;
+  return h ? (long)((rnd >> 8) % (unsigned long)h) : 0;
+}
+long random(long l, long h) { return h > l ? l + random(h - l) : l; }
+void randomSeed(unsigned long s) { rnd = s; }
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+unsigned long shiftOutCount = 0;
+
+
+unsigned long Adafruit_NeoPixel::showCount = 0;
+uint16_t Adafruit_NeoPixel::lastShowLen = 0;
+uint8_t Adafruit_NeoPixel::lastShow[4096];
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, uint8_t p, neoPixelType t) :
+  begun(false), brightness(0), pixels(NULL), endTime(0) {
+  updateType(t);
+  updateLength(n);
+  setPin(p);
+}
+
+Adafruit_NeoPixel::Adafruit_NeoPixel() :
+  is800KHz(true), begun(false), numLEDs(0), numBytes(0), pin(-1), brightness(0), pixels(NULL),
+  rOffset(1), gOffset(0), bOffset(2), wOffset(1), endTime(0) {}
+
+Adafruit_NeoPixel::~Adafruit_NeoPixel() { if(pixels) free(pixels); }
+
+void Adafruit_NeoPixel::begin(void) { begun = true; }
+
+void Adafruit_NeoPixel::updateLength(uint16_t n) {
+  if(pixels) free(pixels);
+  numBytes = n * ((wOffset == rOffset) ? 3 : 4);
+  if((pixels = (uint8_t *)malloc(numBytes))) {
+    memset(pixels, 0, numBytes);
+    numLEDs = n;
+  } else {
+    numLEDs = numBytes = 0;
+  }
+}
+
+void Adafruit_NeoPixel::updateType(neoPixelType t) {
+  boolean oldThreeBytesPerPixel = (wOffset == rOffset);
+  wOffset = (t >> 6) & 0b11;
+  rOffset = (t >> 4) & 0b11;
+  gOffset = (t >> 2) & 0b11;
+  bOffset = t & 0b11;
+  is800KHz = (t < 256);
+  if(pixels) {
+    boolean newThreeBytesPerPixel = (wOffset == rOffset);
+    if(newThreeBytesPerPixel != oldThreeBytesPerPixel) updateLength(numLEDs);
+  }
+}
+
+void Adafruit_NeoPixel::show(void) {
+  showCount++;
+  lastShowLen = numLEDs;
+  memcpy(lastShow, pixels, numBytes < sizeof(lastShow) ? numBytes : sizeof(lastShow));
+}
+
+void Adafruit_NeoPixel::setPin(uint8_t p) { pin = p; }
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+  if(n < numLEDs) {
+    if(brightness) {
+      r = (r * brightness) >> 8;
+      g = (g * brightness) >> 8;
+      b = (b * brightness) >> 8;
+    }
+    uint8_t *p;
+    if(wOffset == rOffset) {
+      p = &pixels[n * 3];
+    } else {
+      p = &pixels[n * 4];
+      p[wOffset] = 0;
+    }
+    p[rOffset] = r;
+    p[gOffset] = g;
+    p[bOffset] = b;
+  }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+  if(n < numLEDs) {
+    if(brightness) {
+      r = (r * brightness) >> 8;
+      g = (g * brightness) >> 8;
+      b = (b * brightness) >> 8;
+      w = (w * brightness) >> 8;
+    }
+    uint8_t *p;
+    if(wOffset == rOffset) {
+      p = &pixels[n * 3];
+    } else {
+      p = &pixels[n * 4];
+      p[wOffset] = w;
+    }
+    p[rOffset] = r;
+    p[gOffset] = g;
+    p[bOffset] = b;
+  }
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
+  setPixelColor(n, (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c, (uint8_t)(c >> 24));
+}
+
+uint32_t Adafruit_NeoPixel::Color(uint8_t r, uint8_t g, uint8_t b) {
+  return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+uint32_t Adafruit_NeoPixel::Color(uint8_t r, uint8_t g, uint8_t b, uint8_t w) {
+  return ((uint32_t)w << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
+  if(n >= numLEDs) return 0;
+  uint8_t *p = &pixels[n * ((wOffset == rOffset) ? 3 : 4)];
+  uint32_t w = (wOffset == rOffset) ? 0 : p[wOffset], r = p[rOffset], g = p[gOffset], b = p[bOffset];
+  if(brightness) {
+    w = (w << 8) / brightness;
+    r = (r << 8) / brightness;
+    g = (g << 8) / brightness;
+    b = (b << 8) / brightness;
+  }
+  return (w << 24) | (r << 16) | (g << 8) | b;
+}
+
+uint8_t *Adafruit_NeoPixel::getPixels(void) const { return pixels; }
+
+uint16_t Adafruit_NeoPixel::numPixels(void) const { return numLEDs; }
+
+void Adafruit_NeoPixel::setBrightness(uint8_t b) {
+  uint8_t newBrightness = b + 1;
+  if(newBrightness != brightness) {
+    uint8_t c, *ptr = pixels, oldBrightness = brightness - 1;
+    uint16_t scale;
+    if(oldBrightness == 0) scale = 0;
+    else if(b == 255) scale = 65535 / oldBrightness;
+    else scale = (((uint16_t)newBrightness << 8) - 1) / oldBrightness;
+    for(uint16_t i=0; i<numBytes; i++) {
+      c = *ptr;
+      *ptr++ = (c * scale) >> 8;
+    }
+    brightness = newBrightness;
+  }
+}
+
+uint8_t Adafruit_NeoPixel::getBrightness(void) const { return brightness - 1; }
+
+void Adafruit_NeoPixel::clear() { memset(pixels, 0, numBytes); }
@@ -0,0 +1,64 @@
+/*
+  Arduino.h - Just enough of the Arduino core to build the library on the
+  host. See Arduino.cpp.
+*/
+
+#ifndef ARDUINO_STUB_H
+#define ARDUINO_STUB_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+typedef bool boolean;
+typedef uint8_t byte;
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+#define pgm_read_byte(a) (*(const uint8_t*)(a))
+#define pgm_read_word(a) (*(const uint16_t*)(a))
+#define pgm_read_dword(a) (*(const uint32_t*)(a))
+#define pgm_read_ptr(a) (*(void* const*)(a))
+#define memcpy_P memcpy
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strcat_P strcat
+#define min(a,b) ((a)<(b)?(a):(b))
+#define max(a,b) ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+#define abs(x) ((x)>0?(x):-(x))
+#define noInterrupts()
+#define interrupts()
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long);
+long random(long);
+long random(long, long);
+void randomSeed(unsigned long);
+long map(long, long, long, long, long);
+void advance_ms(unsigned long); // host only: moves millis() and micros() on
+extern bool real_micros;        // host only: micros() moves with the wall clock as well, for budgets
+#define OUTPUT 1
+#define MSBFIRST 1
+inline void pinMode(uint8_t, uint8_t) {}
+extern unsigned long shiftOutCount;
+inline void shiftOut(uint8_t, uint8_t, uint8_t, uint8_t) { shiftOutCount++; }
+class Print {
+public:
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* b, size_t n) { size_t r=0; while(n--) r+=write(*b++); return r; }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const char* s) { return write(s); }
+  size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned long v, int base = 10) { char b[16]; snprintf(b, 16, base==16?"%lx":"%lu", v); return write(b); }
+  size_t print(long v, int base = 10) { char b[16]; snprintf(b, 16, "%ld", v); return write(b); }
+  size_t print(unsigned int v, int base = 10) { return print((unsigned long)v, base); }
+  size_t print(int v, int base = 10) { return print((long)v, base); }
+  size_t print(unsigned char v, int base = 10) { return print((unsigned long)v, base); }
+  size_t println(const char* s) { return print(s) + print('\n'); }
+};
+#include "WString.h"
+#endif
@@ -0,0 +1,64 @@
+/*
+  EEPROM.cpp - File backed EEPROM for the host build, see EEPROM.h.
+*/
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+/*
+ * Opens the file, a new one is created erased (0xFF) and grown to size.
+ */
+void EEPROMClass::begin(size_t size) {
+  end();
+  _file = fopen(_path, "r+b");
+  if(_file == NULL) _file = fopen(_path, "w+b");
+  if(_file == NULL) return;
+  fseek(_file, 0, SEEK_END);
+  for(long n = ftell(_file); n < (long)size; n++) fputc(0xFF, _file);
+  fflush(_file);
+  _size = size;
+  _cut = -1;
+  _writes = 0;
+}
+
+uint8_t EEPROMClass::read(int address) {
+  if(_file == NULL || address < 0 || (size_t)address >= _size) return 0;
+  fseek(_file, address, SEEK_SET);
+  return (uint8_t)fgetc(_file);
+}
+
+void EEPROMClass::write(int address, uint8_t value) {
+  _writes++;
+  if(_file == NULL || address < 0 || (size_t)address >= _size) return;
+  if(_cut >= 0 && _writes > (unsigned long)_cut) return;
+  fseek(_file, address, SEEK_SET);
+  fputc(value, _file);
+  fflush(_file);
+}
+
+bool EEPROMClass::commit(void) {
+  return _file != NULL;
+}
+
+void EEPROMClass::end(void) {
+  if(_file != NULL) fclose(_file);
+  _file = NULL;
+  _size = 0;
+}
+
+size_t EEPROMClass::length(void) {
+  return _size;
+}
+
+void EEPROMClass::setFile(const char* path) {
+  snprintf(_path, sizeof(_path), "%s", path);
+}
+
+void EEPROMClass::cutPowerAfter(long writes) {
+  _cut = (writes < 0) ? -1 : (long)_writes + writes;
+}
+
+unsigned long EEPROMClass::getWrites(void) {
+  return _writes;
+}
@@ -0,0 +1,36 @@
+/*
+  EEPROM.h - The EEPROM library of the ESP8266 core, for the host build,
+  backed by a file. Every write goes to the file right away (as with the
+  EEPROM of an AVR), so a test can cut the power at any write with
+  cutPowerAfter() and start over from what made it into the file.
+*/
+
+#ifndef EEPROM_STUB_H
+#define EEPROM_STUB_H
+#include "Arduino.h"
+
+class EEPROMClass {
+  public:
+    void begin(size_t size);
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    bool commit(void);
+    void end(void);
+    size_t length(void);
+
+    // host only
+    void setFile(const char* path);   // before begin(), "eeprom.bin" by default
+    void cutPowerAfter(long writes);  // writes after that many more are lost, -1 never
+    unsigned long getWrites(void);    // writes since begin(), lost ones included
+
+  private:
+    FILE* _file = NULL;
+    char _path[256] = "eeprom.bin";
+    size_t _size = 0;
+    long _cut = -1;
+    unsigned long _writes = 0;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
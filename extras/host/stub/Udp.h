@@ -0,0 +1,20 @@
+/*
+  Udp.h - The UDP and IPAddress interfaces used by UDPOutput, for the host
+  build.
+*/
+
+#ifndef UDP_STUB_H
+#define UDP_STUB_H
+#include "Arduino.h"
+class IPAddress {
+public:
+  IPAddress(uint8_t a=0, uint8_t b=0, uint8_t c=0, uint8_t d=0) { ip[0]=a; ip[1]=b; ip[2]=c; ip[3]=d; }
+  uint8_t ip[4];
+};
+class UDP : public Print {
+public:
+  virtual int beginPacket(IPAddress ip, uint16_t port) = 0;
+  virtual int endPacket() = 0;
+  using Print::write;
+};
+#endif
@@ -0,0 +1,41 @@
+/*
+  WString.h - The part of Arduino's String the old web examples used, for
+  comparing against them on the host. It grows like the real one: realloc()
+  to exactly the length needed, unless reserve() made room before.
+*/
+
+#ifndef WSTRING_STUB_H
+#define WSTRING_STUB_H
+
+class String {
+public:
+  String(const char* s = "") : buffer(NULL), capacity(0), len(0) { concat(s, strlen(s)); }
+  ~String() { free(buffer); }
+  bool reserve(unsigned int size) {
+    if(buffer && capacity >= size) return true;
+    char* b = (char*)realloc(buffer, size + 1);
+    if(b == NULL) return false;
+    if(buffer == NULL) b[0] = 0;
+    buffer = b;
+    capacity = size;
+    return true;
+  }
+  String& operator=(const char* s) { len = 0; if(buffer) buffer[0] = 0; concat(s, strlen(s)); return *this; }
+  String& operator+=(const char* s) { concat(s, strlen(s)); return *this; }
+  String& operator+=(const __FlashStringHelper* s) { return *this += (const char*)s; }
+  String& operator+=(unsigned char v) { char b[4]; snprintf(b, 4, "%u", v); return *this += b; }
+  const char* c_str() const { return buffer ? buffer : ""; }
+  unsigned int length() const { return len; }
+private:
+  void concat(const char* s, unsigned int n) {
+    if(!reserve(len + n)) return;
+    memcpy(buffer + len, s, n + 1);
+    len += n;
+  }
+  char* buffer;
+  unsigned int capacity, len;
+  String(const String&);
+  String& operator=(const String&);
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+  heap.cpp - Counts the heap use of the library for the host tests. The
+  Makefile links every program with malloc(), calloc(), realloc() and free()
+  wrapped (-Wl,--wrap), so these see all calls made by the library and the
+  tests, but not those made inside the C and C++ runtime.
+
+  Allocations larger than heap_limit fail, to test running out of memory.
+*/
+
+#include <stddef.h>
+#include <string.h>
+
+extern "C" {
+  void* __real_malloc(size_t n);
+  void* __real_realloc(void* p, size_t n);
+  void __real_free(void* p);
+}
+
+size_t heap_used = 0, heap_peak = 0, heap_allocs = 0, heap_limit = (size_t)-1;
+
+// every block starts with its size, padded to keep the alignment of malloc()
+#define HEAP_HEADER 16
+
+static void* track(void* block, size_t n) {
+  if(block == NULL) return NULL;
+  *(size_t*)block = n;
+  heap_used += n;
+  if(heap_used > heap_peak) heap_peak = heap_used;
+  return (char*)block + HEAP_HEADER;
+}
+
+static size_t untrack(void* p) {
+  size_t n = *(size_t*)((char*)p - HEAP_HEADER);
+  heap_used -= n;
+  return n;
+}
+
+extern "C" void* __wrap_malloc(size_t n) {
+  heap_allocs++;
+  if(n > heap_limit) return NULL;
+  return track(__real_malloc(n + HEAP_HEADER), n);
+}
+
+extern "C" void* __wrap_calloc(size_t count, size_t size) {
+  size_t n = count * size;
+  if(size != 0 && n / size != count) return NULL;
+  void* p = __wrap_malloc(n);
+  if(p != NULL) memset(p, 0, n);
+  return p;
+}
+
+extern "C" void* __wrap_realloc(void* p, size_t n) {
+  if(p == NULL) return __wrap_malloc(n);
+  heap_allocs++;
+  if(n > heap_limit) return NULL;
+  size_t old = untrack(p);
+  void* block = __real_realloc((char*)p - HEAP_HEADER, n + HEAP_HEADER);
+  if(block == NULL) { // the old block is still there
+    heap_used += old;
+    return NULL;
+  }
+  return track(block, n);
+}
+
+extern "C" void __wrap_free(void* p) {
+  if(p == NULL) return;
+  untrack(p);
+  __real_free((char*)p - HEAP_HEADER);
+}
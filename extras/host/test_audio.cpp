@@ -0,0 +1,126 @@
+/*
+  test_audio.cpp - WS2812FXAudio fed with generated signals at 8kHz: a kick
+  drum at 120 BPM, a sine sweep and low noise, checked for beats and bands,
+  with the audio modes running on a strip.
+
+  Given 16 bit mono WAV files on the command line, it prints the analysis
+  of those instead.
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXAudio.h"
+#include "host.h"
+#include <math.h>
+
+#define RATE 8000
+#define SECONDS 10
+#define SAMPLES (RATE * SECONDS)
+#define FRAME (RATE / 100) // 10ms per frame
+
+static int16_t samples[SAMPLES];
+
+// 50ms kicks falling from 120Hz to 50Hz, every 500ms, on a quiet 400Hz tone
+static void kick(void) {
+  double phase = 0;
+  for(int i=0; i<SAMPLES; i++) {
+    double t = (double)(i % (RATE / 2)) / RATE;
+    phase += 2 * M_PI * (50 + 70 * exp(-t * 40)) / RATE;
+    samples[i] = (int16_t)(20000 * exp(-t * 20) * sin(phase) + 2000 * sin(2 * M_PI * 400 * i / RATE));
+  }
+}
+
+// 100Hz to 3200Hz, exponentially
+static void sweep(void) {
+  double phase = 0;
+  for(int i=0; i<SAMPLES; i++) {
+    phase += 2 * M_PI * 100 * pow(32, (double)i / SAMPLES) / RATE;
+    samples[i] = (int16_t)(10000 * sin(phase));
+  }
+}
+
+static void noise(void) {
+  for(int i=0; i<SAMPLES; i++) samples[i] = random(-40, 40);
+}
+
+static uint32_t load(const char* file, uint16_t* rate) {
+  FILE* f = fopen(file, "rb");
+  uint8_t header[44];
+  if(f == NULL || fread(header, 1, sizeof(header), f) != sizeof(header)) {
+    if(f) fclose(f);
+    return 0;
+  }
+  *rate = header[24] | header[25] << 8;
+  uint32_t n = fread(samples, 2, SAMPLES, f);
+  fclose(f);
+  return n;
+}
+
+// the band with the highest peak and the beats counted, per second of the
+// signal, played frame by frame through the modes
+static void run(uint32_t n, uint16_t rate, uint8_t loudest[SECONDS], uint32_t beats[SECONDS], bool print) {
+  WS2812FXAudio audio(rate);
+  WS2812FX ws2812fx(64, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setAudio(&audio);
+  ws2812fx.setNumSegments(3);
+  ws2812fx.setSegment(0, 0, 31, FX_MODE_SPECTRUM, RED, 1000, false);
+  ws2812fx.setSegment(1, 32, 47, FX_MODE_BEAT_PULSE, BLUE, 1000, false);
+  ws2812fx.setSegment(2, 48, 63, FX_MODE_BASS_FIRE, ORANGE, 1000, false);
+  ws2812fx.start();
+
+  uint16_t frame = rate / 100;
+  uint8_t peak[AUDIO_NUM_BANDS] = {};
+  for(uint32_t i=0; i + frame <= n; i += frame) {
+    audio.addSamples(samples + i, frame);
+    advance_ms(10);
+    ws2812fx.service();
+    uint32_t s = i / rate;
+    if(s >= SECONDS) break;
+    for(uint8_t b=0; b<AUDIO_NUM_BANDS; b++) peak[b] = max(peak[b], audio.getBand(b));
+    if((i + frame) % rate < frame) { // the last frame of the second
+      uint8_t l = 0;
+      for(uint8_t b=1; b<AUDIO_NUM_BANDS; b++) if(peak[b] > peak[l]) l = b;
+      loudest[s] = l;
+      beats[s] = audio.getBeats();
+      if(print) {
+        printf("  %2us peaks", (unsigned)s);
+        for(uint8_t b=0; b<AUDIO_NUM_BANDS; b++) printf(" %3u", peak[b]);
+        printf(", beats %u\n", (unsigned)audio.getBeats());
+      }
+      memset(peak, 0, sizeof(peak));
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  uint8_t loudest[SECONDS];
+  uint32_t beats[SECONDS];
+
+  if(argc > 1) {
+    for(int i=1; i<argc; i++) {
+      uint16_t rate = 0;
+      uint32_t n = load(argv[i], &rate);
+      printf("%s: %u samples at %uHz\n", argv[i], (unsigned)n, rate);
+      if(n > 0 && rate >= 100) run(n, rate, loudest, beats, true);
+    }
+    return 0;
+  }
+
+  kick();
+  run(SAMPLES, RATE, loudest, beats, false);
+  for(int s=0; s<SECONDS; s++) CHECK(loudest[s] == 0);
+  CHECK(beats[SECONDS - 1] >= 18 && beats[SECONDS - 1] <= 20); // two kicks a second
+
+  sweep();
+  run(SAMPLES, RATE, loudest, beats, false);
+  for(int s=1; s<SECONDS; s++) CHECK(loudest[s] >= loudest[s - 1]);
+  CHECK(loudest[0] <= 1 && loudest[SECONDS - 1] >= AUDIO_NUM_BANDS - 2);
+  CHECK(beats[SECONDS - 1] <= 1);
+
+  noise();
+  run(SAMPLES, RATE, loudest, beats, false);
+  CHECK(beats[SECONDS - 1] == 0);
+
+  return done("audio");
+}
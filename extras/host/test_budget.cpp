@@ -0,0 +1,54 @@
+/*
+  test_budget.cpp - With a budget, service() spreads a frame over several
+  calls, all segments of it render with the same time and the frame is sent
+  exactly once, when it's complete.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define SEGMENTS 10
+
+static WS2812FX::segment_runtime* runtimes[SEGMENTS];
+
+// takes 1 ms to render, a new color every frame
+static uint16_t slow(WS2812FX::span& s, void* user) {
+  runtimes[s.seg->start / 10] = s.runtime;
+  for(uint16_t i=0; i < s.length; i++) s.setPixel(i, s.runtime->counter_mode_call + 1);
+  advance_ms(1);
+  return 100;
+}
+
+int main() {
+  WS2812FX ws2812fx(SEGMENTS * 10, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  uint8_t mode = ws2812fx.addCustomMode(F("Slow"), slow);
+  for(uint8_t i=0; i < SEGMENTS; i++) ws2812fx.setSegment(i, i * 10, i * 10 + 9, mode, RED, 1000, false);
+  ws2812fx.start();
+
+  for(uint8_t frame=0; frame < 5; frame++) {
+    advance_ms(200); // all due
+    unsigned long start = millis();
+    unsigned long shows = Adafruit_NeoPixel::showCount;
+    uint8_t calls = 0;
+    do {
+      ws2812fx.service(2500); // 3 segments per call
+      calls++;
+      CHECK(Adafruit_NeoPixel::lastShow[2] == (Adafruit_NeoPixel::showCount == shows ? frame : frame + 1)); // blue of LED 0
+    } while(Adafruit_NeoPixel::showCount == shows && calls < 100);
+    CHECK(calls == 4);
+    CHECK(Adafruit_NeoPixel::showCount == shows + 1);
+    for(uint8_t i=0; i < SEGMENTS; i++) {
+      CHECK(runtimes[i]->next_time == start + 100); // the time the frame started, not when the segment rendered
+      CHECK(ws2812fx.getPixelColor(i * 10) == (uint32_t)frame + 1);
+    }
+    CHECK(millis() == start + SEGMENTS);
+
+    // nothing is due until the next frame, nothing more is sent
+    ws2812fx.service(2500);
+    CHECK(Adafruit_NeoPixel::showCount == shows + 1);
+  }
+
+  return done("budget");
+}
@@ -0,0 +1,65 @@
+/*
+  test_custom_modes.cpp - addCustomMode() numbers the modes after the
+  built-in ones, up to MAX_CUSTOM_MODES, hands them their user pointer,
+  and the flags passed along are reported and acted on: a custom mode
+  flagged FX_STATIC is only drawn again when its settings change, one with
+  the default flags every time it's due.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+// counts its calls in the int user points to
+static uint16_t counted(WS2812FX::span& s, void* user) {
+  (*(int*)user)++;
+  for(uint16_t i=0; i < s.length; i++) s.setPixel(i, s.seg->colors[0]);
+  return 100;
+}
+
+static void frames(WS2812FX& ws2812fx, uint8_t n) {
+  for(uint8_t f=0; f < n; f++) {
+    advance_ms(101);
+    ws2812fx.service();
+  }
+}
+
+int main() {
+  WS2812FX ws2812fx(20, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  CHECK(ws2812fx.getModeCount() == MODE_COUNT);
+
+  int any_calls = 0, static_calls = 0;
+  uint8_t any = ws2812fx.addCustomMode(F("Any"), counted, &any_calls);
+  uint8_t fixed = ws2812fx.addCustomMode(F("Fixed"), counted, &static_calls, FX_COLORS(1) | FX_STATIC);
+  CHECK(any == MODE_COUNT && fixed == MODE_COUNT + 1);
+  CHECK(ws2812fx.getModeCount() == MODE_COUNT + 2);
+  CHECK(strcmp((const char*)ws2812fx.getModeName(fixed), "Fixed") == 0);
+  CHECK(ws2812fx.getModeFlags(any) == FX_CUSTOM_FLAGS);
+  CHECK(ws2812fx.getModeFlags(fixed) == (FX_COLORS(1) | FX_STATIC));
+
+  ws2812fx.setSegment(0, 0, 9, any, RED, 1000, false);
+  ws2812fx.setSegment(1, 10, 19, fixed, GREEN, 1000, false);
+  ws2812fx.start();
+  frames(ws2812fx, 10);
+  CHECK(any_calls == 10);
+  CHECK(static_calls == 1); // drawn once, the frame stays
+  CHECK(ws2812fx.getPixelColor(0) == RED && ws2812fx.getPixelColor(10) == GREEN);
+
+  // a new color is a new frame, once
+  ws2812fx.setSegment(1, 10, 19, fixed, BLUE, 1000, false);
+  frames(ws2812fx, 10);
+  CHECK(static_calls == 2);
+  CHECK(ws2812fx.getPixelColor(10) == BLUE);
+
+  // no more than MAX_CUSTOM_MODES
+  for(uint8_t i=2; i < MAX_CUSTOM_MODES; i++) {
+    CHECK(ws2812fx.addCustomMode(F("More"), counted, &any_calls, FX_COLORS(i % 4)) == MODE_COUNT + i);
+    CHECK(ws2812fx.getModeFlags(MODE_COUNT + i) == FX_COLORS(i % 4));
+  }
+  CHECK(ws2812fx.addCustomMode(F("Too many"), counted, &any_calls) == 255);
+  CHECK(ws2812fx.getModeCount() == MODE_COUNT + MAX_CUSTOM_MODES);
+  CHECK(ws2812fx.getModeFlags(MODE_COUNT + MAX_CUSTOM_MODES) == FX_CUSTOM_FLAGS);
+
+  return done("custom modes");
+}
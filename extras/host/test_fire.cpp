@@ -0,0 +1,94 @@
+/*
+  test_fire.cpp - Fire's heat evolves frame by frame like the reference
+  below, given the same random numbers. The heat lives in the segment's
+  memory, which is taken once and reused every frame: with the memory
+  reserved by setSegmentMemory(), Fire never allocates.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define LEN 60
+
+// one frame of Fire, as the mode is documented
+static void reference(uint8_t* heat, uint16_t len) {
+  uint8_t cooling = min(FIRE_COOLING * 10 / len + 2, 255);
+  uint16_t seed = random(65536);
+  for(uint16_t i=0; i < len; i++) {
+    seed = seed * 2053 + 13849;
+    uint8_t c = ((seed >> 8) * cooling) >> 8;
+    heat[i] = (heat[i] > c) ? heat[i] - c : 0;
+  }
+  for(uint16_t i=len - 1; i >= 2; i--) heat[i] = ((heat[i - 1] + 2 * heat[i - 2]) * 85) >> 8;
+  if(random(256) < FIRE_SPARKING) {
+    uint16_t i = random(min(len, (uint16_t)7));
+    heat[i] = min(heat[i] + random(160, 256), 255);
+  }
+}
+
+int main() {
+  WS2812FX ws2812fx(2 * LEN, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, LEN - 1, FX_MODE_FIRE, RED, 1000, false);
+  CHECK(ws2812fx.setPalette(2, PALETTE_HEAT)); // not shown, for the colors of the heat
+  CHECK(ws2812fx.setSegmentMemory(0, LEN));
+  ws2812fx.start();
+
+  // the same heat as the reference, frame by frame, without allocating
+  uint8_t heat[LEN] = {0};
+  size_t allocs = heap_allocs;
+  uint16_t hot = 0;
+  for(uint16_t frame=0; frame < 500; frame++) {
+    advance_ms(20);
+    randomSeed(1000 + frame);
+    ws2812fx.service();
+    randomSeed(1000 + frame);
+    reference(heat, LEN);
+    for(uint16_t i=0; i < LEN; i++) {
+      if(ws2812fx.getPixelColor(i) != ws2812fx.getPaletteColor(2, heat[i])) {
+        printf("frame %u, LED %u: %06x, expected heat %u\n", frame, i, ws2812fx.getPixelColor(i), heat[i]);
+        CHECK(ws2812fx.getPixelColor(i) == ws2812fx.getPaletteColor(2, heat[i]));
+        return done("fire");
+      }
+      if(heat[i] > 128) hot++;
+    }
+  }
+  CHECK(hot > 0); // it did burn
+  CHECK(heap_allocs == allocs);
+  CHECK(ws2812fx.getSegmentMemory(0) == LEN);
+
+  // without a reservation, the first frame takes the memory and every later one reuses it
+  ws2812fx.setSegment(1, LEN, 2 * LEN - 1, FX_MODE_FIRE, RED, 1000, true);
+  CHECK(ws2812fx.getSegmentMemory(1) == 0);
+  advance_ms(20);
+  ws2812fx.service();
+  CHECK(ws2812fx.getSegmentMemory(1) == LEN);
+  allocs = heap_allocs;
+  for(uint16_t frame=0; frame < 100; frame++) {
+    advance_ms(20);
+    ws2812fx.service();
+  }
+  CHECK(heap_allocs == allocs);
+  CHECK(ws2812fx.getSegmentMemory(1) == LEN);
+
+  // the memory is kept when the mode changes, and the heat starts over with Fire again
+  ws2812fx.setSegment(1, LEN, 2 * LEN - 1, FX_MODE_STATIC, RED, 1000, true);
+  advance_ms(20);
+  ws2812fx.service();
+  CHECK(ws2812fx.getSegmentMemory(1) == LEN);
+  ws2812fx.setMode(FX_MODE_FIRE); // from the first frame
+  memset(heat, 0, sizeof(heat));
+  allocs = heap_allocs;
+  for(uint16_t frame=0; frame < 10; frame++) {
+    advance_ms(20);
+    randomSeed(2000 + frame);
+    ws2812fx.service();
+    randomSeed(2000 + frame);
+    reference(heat, LEN);
+    for(uint16_t i=0; i < LEN; i++) CHECK(ws2812fx.getPixelColor(i) == ws2812fx.getPaletteColor(2, heat[i]));
+  }
+  CHECK(heap_allocs == allocs);
+
+  return done("fire");
+}
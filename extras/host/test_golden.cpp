@@ -0,0 +1,74 @@
+/*
+  test_golden.cpp - The original 56 modes (0..55) draw the same frames as
+  before their pixel loops were rewritten: 2..39 LEDs and 76..298 LEDs in
+  steps of 37, forward and reverse, RGB and RGBW, 300 frames each.
+
+  golden/modes.txt holds a hash of the frames for every mode, color order
+  and direction, over all lengths, captured from the library before the
+  rewrite. "test_golden capture" prints the table for the library it was
+  built with, to capture it again after a deliberate change.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define GOLDEN_MODES 56
+#define GOLDEN_FRAMES 300
+#define GOLDEN_FILE "golden/modes.txt"
+
+static const uint32_t colors[] = {0x20FF8040, 0x0000FF00, 0x400000FF};
+
+static unsigned long frames_hash(uint8_t mode, neoPixelType type, bool reverse) {
+  unsigned long h = 5381;
+  for(uint16_t len=2; len <= 298; len = (len == 39) ? 76 : (len < 39 ? len + 1 : len + 37)) {
+    randomSeed(mode + 1);
+    WS2812FX ws2812fx(len, 5, type);
+    ws2812fx.init();
+    ws2812fx.setBrightness(255);
+    ws2812fx.setSegment(0, 0, len - 1, mode, colors, 500, reverse);
+    ws2812fx.start();
+    uint16_t bytes = len * ((type == (NEO_GRBW + NEO_KHZ800)) ? 4 : 3);
+    for(int k=0; k < GOLDEN_FRAMES; k++) {
+      advance_ms(13);
+      ws2812fx.service();
+      uint8_t* p = ws2812fx.getPixels();
+      for(uint16_t i=0; i < bytes; i++) h = (h * 33) ^ p[i];
+    }
+  }
+  return h;
+}
+
+int main(int argc, char** argv) {
+  bool capture = (argc > 1 && strcmp(argv[1], "capture") == 0);
+  FILE* f = capture ? NULL : fopen(GOLDEN_FILE, "r");
+  if(!capture && f == NULL) {
+    printf("%s: missing\n", GOLDEN_FILE);
+    failures++;
+    return done("golden");
+  }
+
+  neoPixelType types[] = {NEO_GRB + NEO_KHZ800, NEO_GRBW + NEO_KHZ800};
+  for(uint8_t m=0; m < GOLDEN_MODES; m++) {
+    for(uint8_t t=0; t < 2; t++) {
+      for(uint8_t reverse=0; reverse < 2; reverse++) {
+        unsigned long h = frames_hash(m, types[t], reverse);
+        if(capture) {
+          printf("%u %s %s %lx\n", m, t ? "rgbw" : "rgb", reverse ? "reverse" : "forward", h);
+          continue;
+        }
+        unsigned int gm;
+        char type[8], dir[8];
+        unsigned long gh;
+        if(fscanf(f, "%u %7s %7s %lx", &gm, type, dir, &gh) != 4 || gm != m) {
+          printf("%s: no entry for mode %u\n", GOLDEN_FILE, m);
+          failures++;
+        } else if(gh != h) {
+          printf("mode %u (%s), %s, %s: frames differ\n", m, (const char*)WS2812FX(1, 5, types[t]).getModeName(m), type, dir);
+          failures++;
+        }
+      }
+    }
+  }
+  if(f != NULL) fclose(f);
+  return capture ? 0 : done("golden");
+}
@@ -0,0 +1,102 @@
+/*
+  test_layers.cpp - A layer is blended over the segment below it with every
+  blend mode and opacity, can be turned off and on again, follows its
+  segment's length and gets its buffer from setSegmentLayer(), so rendering
+  never allocates.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define BELOW 0x204080
+#define ABOVE 0x80C010
+
+static void frame(WS2812FX& ws2812fx) {
+  advance_ms(1001);
+  ws2812fx.service();
+}
+
+static uint8_t blend(uint8_t mode, uint8_t b, uint8_t l, uint8_t opacity) {
+  uint16_t a = opacity + 1;
+  switch(mode) {
+    case BLEND_ADD:    return min(b + ((l * a) >> 8), 255);
+    case BLEND_SCREEN: l = 255 - (((255 - b) * (255 - l)) >> 8); break;
+    case BLEND_MAX:    l = max(b, l); break;
+  }
+  return (l * a + b * (256 - a)) >> 8;
+}
+
+// LEDs first to last show the layer, the rest what's below (all of it at opacity 0)
+static bool shown(uint8_t mode, uint8_t opacity, uint16_t first, uint16_t last) {
+  for(uint16_t i=0; i < 20; i++) {
+    const uint8_t* p = Adafruit_NeoPixel::lastShow + i * 3; // G, R, B
+    for(uint8_t c=0; c < 3; c++) {
+      uint8_t b = BELOW >> (c == 0 ? 8 : c == 1 ? 16 : 0);
+      uint8_t l = ABOVE >> (c == 0 ? 8 : c == 1 ? 16 : 0);
+      if(p[c] != ((opacity > 0 && i >= first && i <= last) ? blend(mode, b, l, opacity) : b)) return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  WS2812FX ws2812fx(20, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, 19, FX_MODE_STATIC, BELOW, 1000, false);
+  ws2812fx.setSegment(1, 5, 14, FX_MODE_STATIC, ABOVE, 1000, false);
+  ws2812fx.start();
+
+  size_t allocs = heap_allocs;
+  CHECK(ws2812fx.setSegmentLayer(1, BLEND_ALPHA, 255));
+  CHECK(heap_allocs == allocs + 1);
+  allocs = heap_allocs;
+
+  uint8_t modes[] = {BLEND_ALPHA, BLEND_ADD, BLEND_SCREEN, BLEND_MAX};
+  uint8_t opacities[] = {255, 128, 1, 0};
+  for(uint8_t m=0; m < 4; m++) {
+    for(uint8_t o=0; o < 4; o++) {
+      CHECK(ws2812fx.setSegmentLayer(1, modes[m], opacities[o]));
+      frame(ws2812fx);
+      if(!shown(modes[m], opacities[o], 5, 14)) {
+        printf("blend mode %u, opacity %u: not blended\n", modes[m], opacities[o]);
+        CHECK(false);
+      }
+    }
+  }
+  CHECK(heap_allocs == allocs);
+
+  // off, the segment draws over what's below, and on again
+  CHECK(ws2812fx.setSegmentLayer(1, BLEND_NONE));
+  frame(ws2812fx);
+  CHECK(shown(BLEND_ALPHA, 255, 5, 14));
+  CHECK(ws2812fx.getPixelColor(10) == ABOVE);
+  ws2812fx.setSegment(0, 0, 19, FX_MODE_STATIC, BELOW, 1000, false);
+  allocs = heap_allocs;
+  CHECK(ws2812fx.setSegmentLayer(1, BLEND_ADD, 128));
+  CHECK(heap_allocs == allocs + 1);
+  allocs = heap_allocs;
+  for(int i=0; i < 10; i++) frame(ws2812fx);
+  CHECK(shown(BLEND_ADD, 128, 5, 14));
+  CHECK(ws2812fx.getPixelColor(10) == BELOW);
+  CHECK(heap_allocs == allocs);
+
+  // longer, the layer grows with the segment, outside of service()
+  ws2812fx.setSegment(1, 2, 17, FX_MODE_STATIC, ABOVE, 1000, false);
+  ws2812fx.start(); // from the first frame
+  CHECK(heap_allocs == allocs + 1);
+  allocs = heap_allocs;
+  for(int i=0; i < 10; i++) frame(ws2812fx);
+  CHECK(shown(BLEND_ADD, 128, 2, 17));
+  CHECK(heap_allocs == allocs);
+
+  // no memory for the buffer, the segment stays a regular one
+  CHECK(ws2812fx.setSegmentLayer(1, BLEND_NONE));
+  heap_limit = 15;
+  CHECK(!ws2812fx.setSegmentLayer(1, BLEND_MAX));
+  heap_limit = (size_t)-1;
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPixelColor(10) == ABOVE);
+
+  return done("layers");
+}
@@ -0,0 +1,57 @@
+/*
+  test_lut.cpp - The bytes sent with gamma and white balance on are what the
+  formula gives for every value of every channel, for a few gammas, white
+  balances and brightnesses, RGB and RGBW, also when only the brightness
+  changed since the table was built.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+static uint8_t reference(uint8_t i, float gamma, uint8_t balance, uint8_t brightness) {
+  uint16_t v = (gamma == 1.0) ? i : (uint16_t)(pow(i / 255.0, gamma) * 255.0 + 0.5);
+  return (((v * (balance + 1)) >> 8) * (brightness + 1)) >> 8;
+}
+
+static void check(neoPixelType type) {
+  bool rgbw = (type == NEO_GRBW + NEO_KHZ800);
+  uint8_t bpp = rgbw ? 4 : 3;
+  WS2812FX ws2812fx(256, 5, type);
+  ws2812fx.init();
+  for(uint16_t i=0; i < 256; i++) { // every value once per channel
+    ws2812fx.setPixelColor(i, ((uint32_t)(i * 7 & 0xFF) << 24) | ((uint32_t)i << 16) | ((255 - i) << 8) | (i * 3 & 0xFF));
+  }
+
+  float gammas[] = {1.0, 1.8, 2.2, 2.8};
+  uint32_t balances[] = {0xFFFFFFFF, 0xFFFFB0F0, 0x80FF4000, 0x40FFFFFF};
+  uint8_t brightnesses[] = {255, 128, 17};
+  for(uint8_t g=0; g < 4; g++) {
+    for(uint8_t c=0; c < 4; c++) {
+      ws2812fx.setGamma(gammas[g]);
+      ws2812fx.setColorCorrection(balances[c]);
+      for(uint8_t b=0; b < 3; b++) {
+        ws2812fx.setBrightness(brightnesses[b]);
+        ws2812fx.show();
+        uint8_t bad = 0;
+        for(uint16_t i=0; i < 256 && !bad; i++) {
+          const uint8_t* p = Adafruit_NeoPixel::lastShow + i * bpp; // G, R, B(, W)
+          uint8_t values[] = {(uint8_t)i, (uint8_t)(255 - i), (uint8_t)(i * 3), (uint8_t)(i * 7)};
+          uint8_t sent[] = {p[1], p[0], p[2], rgbw ? p[3] : (uint8_t)0};
+          for(uint8_t k=0; k < bpp; k++) {
+            uint8_t balance = (balances[c] >> (k == 3 ? 24 : 16 - 8 * k)) & 0xFF;
+            if(sent[k] != reference(values[k], gammas[g], balance, brightnesses[b])) bad = 1;
+          }
+        }
+        if(bad) printf("%s, gamma %.1f, balance %08x, brightness %u: not the formula\n",
+          rgbw ? "RGBW" : "RGB", gammas[g], balances[c], brightnesses[b]);
+        CHECK(!bad);
+      }
+    }
+  }
+}
+
+int main() {
+  check(NEO_GRB + NEO_KHZ800);
+  check(NEO_GRBW + NEO_KHZ800);
+  return done("lut");
+}
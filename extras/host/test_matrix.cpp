@@ -0,0 +1,99 @@
+/*
+  test_matrix.cpp - setMatrix() maps matrix positions to the LED indices
+  worked out by hand for plain and serpentine rows, the rotations and tiled
+  panels. Positions off the matrix map to numLEDs.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+// the LED index of every position, row by row from the top left
+static void check(WS2812FX& ws2812fx, uint16_t w, uint16_t h, const uint16_t* expected) {
+  CHECK(ws2812fx.getMatrixWidth() == w && ws2812fx.getMatrixHeight() == h);
+  for(uint16_t y=0; y < h; y++) {
+    for(uint16_t x=0; x < w; x++) {
+      if(ws2812fx.XY(x, y) != expected[y * w + x]) {
+        printf("%u,%u: %u, expected %u\n", x, y, ws2812fx.XY(x, y), expected[y * w + x]);
+        CHECK(ws2812fx.XY(x, y) == expected[y * w + x]);
+      }
+    }
+  }
+  CHECK(ws2812fx.XY(w, 0) == 16 && ws2812fx.XY(0, h) == 16);
+}
+
+int main() {
+  WS2812FX ws2812fx(16, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+
+  // no matrix, a single row
+  CHECK(ws2812fx.getMatrixWidth() == 16 && ws2812fx.getMatrixHeight() == 1);
+  CHECK(ws2812fx.XY(5, 0) == 5);
+
+  const uint16_t rows[] = {
+    0, 1,  2,  3,
+    4, 5,  6,  7,
+    8, 9, 10, 11};
+  ws2812fx.setMatrix(4, 3);
+  check(ws2812fx, 4, 3, rows);
+
+  const uint16_t serpentine[] = {
+    0, 1,  2,  3,
+    7, 6,  5,  4,
+    8, 9, 10, 11};
+  ws2812fx.setMatrix(4, 3, MATRIX_SERPENTINE);
+  check(ws2812fx, 4, 3, serpentine);
+
+  // turned clockwise, LED 0 is at the top right
+  const uint16_t rotate90[] = {
+     8, 4, 0,
+     9, 5, 1,
+    10, 6, 2,
+    11, 7, 3};
+  ws2812fx.setMatrix(4, 3, MATRIX_ROTATE_90);
+  check(ws2812fx, 3, 4, rotate90);
+
+  const uint16_t rotate180[] = {
+    11, 10, 9, 8,
+     7,  6, 5, 4,
+     3,  2, 1, 0};
+  ws2812fx.setMatrix(4, 3, MATRIX_ROTATE_180);
+  check(ws2812fx, 4, 3, rotate180);
+
+  const uint16_t rotate270[] = {
+    3, 7, 11,
+    2, 6, 10,
+    1, 5,  9,
+    0, 4,  8};
+  ws2812fx.setMatrix(4, 3, MATRIX_ROTATE_270);
+  check(ws2812fx, 3, 4, rotate270);
+
+  const uint16_t serpentine180[] = {
+    11, 10, 9, 8,
+     4,  5, 6, 7,
+     3,  2, 1, 0};
+  ws2812fx.setMatrix(4, 3, MATRIX_SERPENTINE | MATRIX_ROTATE_180);
+  check(ws2812fx, 4, 3, serpentine180);
+
+  // 2 x 2 panels of 2 x 2 LEDs
+  const uint16_t tiled[] = {
+     0,  1,  4,  5,
+     2,  3,  6,  7,
+     8,  9, 12, 13,
+    10, 11, 14, 15};
+  ws2812fx.setMatrix(2, 2, MATRIX_ROWS, 2, 2);
+  check(ws2812fx, 4, 4, tiled);
+
+  const uint16_t tiledSerpentine[] = {
+     0,  1,  4,  5,
+     3,  2,  7,  6,
+    12, 13,  8,  9,
+    15, 14, 11, 10};
+  ws2812fx.setMatrix(2, 2, MATRIX_SERPENTINE | MATRIX_PANELS_SERPENTINE, 2, 2);
+  check(ws2812fx, 4, 4, tiledSerpentine);
+
+  // off again
+  ws2812fx.setMatrix(0, 0);
+  CHECK(ws2812fx.getMatrixWidth() == 16 && ws2812fx.getMatrixHeight() == 1);
+
+  return done("matrix");
+}
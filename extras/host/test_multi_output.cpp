@@ -0,0 +1,59 @@
+/*
+  test_multi_output.cpp - Several strips driven by one instance with
+  addOutput(): each shows its part of the frame, also after setLength().
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXOutput.h"
+#include "host.h"
+
+static void run(WS2812FX& ws2812fx, int frames) {
+  for(int i=0; i<frames; i++) {
+    advance_ms(20);
+    ws2812fx.service();
+  }
+}
+
+int main() {
+  // LEDs 0..9 on the pin of the instance, 10..19 on a GRB strip, 20..29 on an RGB strip
+  WS2812FX ws2812fx(30, 5, NEO_GRB + NEO_KHZ800);
+  Adafruit_NeoPixel grb(10, 6, NEO_GRB + NEO_KHZ800);
+  Adafruit_NeoPixel rgb(10, 7, NEO_RGB + NEO_KHZ800);
+  NeoPixelOutput out_grb(grb), out_rgb(rgb);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  CHECK(ws2812fx.addOutput(out_grb, 10));
+  CHECK(ws2812fx.addOutput(out_rgb, 20));
+  CHECK(!ws2812fx.addOutput(out_rgb, 30)); // past the end
+  ws2812fx.setSegment(0, 0, 29, FX_MODE_RAINBOW_CYCLE, RED, 1000, false);
+  ws2812fx.start();
+  run(ws2812fx, 20);
+  for(uint16_t i=0; i<10; i++) {
+    CHECK(grb.getPixelColor(i) == ws2812fx.Adafruit_NeoPixel::getPixelColor(10 + i));
+    CHECK(rgb.getPixelColor(i) == ws2812fx.Adafruit_NeoPixel::getPixelColor(20 + i));
+  }
+
+  // shrinking the strip below the first LED of an output leaves it alone
+  WS2812FX split(100, 5, NEO_GRB + NEO_KHZ800);
+  RAMOutput first(50), second(50);
+  split.init();
+  split.setBrightness(255);
+  split.addOutput(first, 0);
+  split.addOutput(second, 50);
+  split.setSegment(0, 0, 99, FX_MODE_RAINBOW_CYCLE, RED, 1000, false);
+  split.start();
+  run(split, 10);
+  uint32_t frames = second.getFrames();
+  CHECK(frames > 0);
+  split.setLength(30);
+  run(split, 10);
+  CHECK(second.getFrames() == frames);
+  CHECK(first.getFrames() > frames);
+  split.setLength(60);
+  split.setSegment(0, 0, 59, FX_MODE_STATIC, BLUE, 1000, false);
+  run(split, 10);
+  CHECK(second.getFrames() > frames);
+  CHECK(second.getPixelColor(9) == BLUE);
+
+  return done("multi output");
+}
@@ -0,0 +1,71 @@
+/*
+  test_noise.cpp - WS2812FXNoise: fill() gives the same values as
+  fractal8() per LED, the values spread over the whole range around 128
+  and change smoothly from one LED to the next.
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXNoise.h"
+#include "host.h"
+#include <math.h>
+
+int main() {
+  uint8_t row[256];
+
+  int mismatches = 0;
+  for(uint32_t t=0; t<2000; t++) {
+    uint16_t x = t * 37, dx = t % 300, y = t * 101, z = t * 7;
+    uint8_t octaves = 1 + t % NOISE_MAX_OCTAVES;
+    WS2812FXNoise::fill(row, 100, x, dx, y, z, octaves);
+    for(int i=0; i<100; i++) {
+      if(row[i] != WS2812FXNoise::fractal8(x + i * dx, y, z, octaves)) mismatches++;
+    }
+  }
+  CHECK(mismatches == 0);
+
+  // 3D, about a quarter of a noise cell per LED
+  long histogram[256] = {};
+  double sum = 0, sum2 = 0;
+  long n = 0;
+  int jump = 0;
+  for(uint32_t y=0; y<65536; y+=997) {
+    for(uint32_t z=0; z<65536; z+=4099) {
+      WS2812FXNoise::fill(row, 256, y * 7, 61, y, z, 1);
+      for(int i=0; i<256; i++) {
+        histogram[row[i]]++;
+        sum += row[i];
+        sum2 += row[i] * row[i];
+        n++;
+      }
+      // a 16th of a noise cell per LED
+      WS2812FXNoise::fill(row, 256, y * 7, 16, y, z, 1);
+      for(int i=1; i<256; i++) jump = max(jump, abs(row[i] - row[i - 1]));
+    }
+  }
+  double mean = sum / n, sd = sqrt(sum2 / n - mean * mean);
+  CHECK(mean > 120 && mean < 136);
+  CHECK(sd > 35 && sd < 60);
+  CHECK(histogram[0] > 0 && histogram[255] > 0);
+  CHECK(histogram[0] + histogram[255] < n / 100); // clipped
+  CHECK(jump < 32);
+
+  // 1D and 2D stay in range around the middle
+  uint8_t lo = 255, hi = 0;
+  for(uint32_t x=0; x<65536; x++) {
+    uint8_t v = WS2812FXNoise::noise8(x);
+    lo = min(lo, v);
+    hi = max(hi, v);
+  }
+  CHECK(lo < 96 && hi > 160);
+  lo = 255, hi = 0;
+  for(uint32_t x=0; x<65536; x+=13) {
+    for(uint32_t y=0; y<65536; y+=1031) {
+      uint8_t v = WS2812FXNoise::noise8(x, y);
+      lo = min(lo, v);
+      hi = max(hi, v);
+    }
+  }
+  CHECK(lo < 32 && hi > 224);
+
+  return done("noise");
+}
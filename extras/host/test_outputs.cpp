@@ -0,0 +1,108 @@
+/*
+  test_outputs.cpp - The output drivers (WS2812FXOutput) get the pixels of
+  their range of the strip, in their own format.
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXOutput.h"
+#include "host.h"
+
+// collects what FileOutput writes
+class Buffer : public Print {
+  public:
+    size_t write(uint8_t c) { if(len < sizeof(data)) data[len] = c; len++; return 1; }
+    uint8_t data[1024];
+    size_t len = 0;
+};
+
+// records the DDP packets UDPOutput sends
+class Packets : public UDP {
+  public:
+    int beginPacket(IPAddress ip, uint16_t port) { packets++; pos = 0; return 1; }
+    int endPacket(void) { return 1; }
+    size_t write(uint8_t c) { if(pos < sizeof(header)) header[pos] = c; pos++; bytes++; return 1; }
+    uint8_t header[10];
+    size_t pos = 0, bytes = 0;
+    int packets = 0;
+};
+
+// an output which isn't ready while busy is set
+class Busy : public WS2812FXOutput {
+  public:
+    Busy() : WS2812FXOutput(5) {}
+    bool canShow(void) { return !busy; }
+    void show(const uint8_t* pixels, uint16_t n, uint8_t format) { shows++; }
+    bool busy = false;
+    int shows = 0;
+};
+
+int main() {
+  WS2812FX ws2812fx(40, 5, NEO_GRBW + NEO_KHZ800);
+  Adafruit_NeoPixel grbw(10, 6, NEO_GRBW + NEO_KHZ800);
+  Adafruit_NeoPixel rgb(10, 7, NEO_RGB + NEO_KHZ800);
+  NeoPixelOutput out_grbw(grbw), out_rgb(rgb);
+  RAMOutput ram(10);
+  Buffer buffer;
+  FileOutput file(buffer, 10, true, 5);
+  Packets udp;
+  UDPOutput ddp(udp, IPAddress(10, 0, 0, 2), 40);
+
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  CHECK(ws2812fx.addOutput(out_grbw, 0));
+  CHECK(ws2812fx.addOutput(out_rgb, 10));
+  CHECK(ws2812fx.addOutput(ram, 20));
+  CHECK(ws2812fx.addOutput(file, 30));
+  CHECK(ws2812fx.addOutput(ddp, 0));
+  ws2812fx.setSegment(0, 0, 39, FX_MODE_RAINBOW_CYCLE, RED, 1000, false);
+  ws2812fx.start();
+  for(int i=0; i<20; i++) {
+    advance_ms(10);
+    ws2812fx.service();
+  }
+
+  for(uint16_t i=0; i<10; i++) {
+    CHECK(grbw.getPixelColor(i) == ws2812fx.Adafruit_NeoPixel::getPixelColor(i));
+    CHECK(rgb.getPixelColor(i) == (ws2812fx.Adafruit_NeoPixel::getPixelColor(10 + i) & 0xFFFFFF));
+    CHECK(ram.getPixelColor(i) == ws2812fx.Adafruit_NeoPixel::getPixelColor(20 + i));
+  }
+  CHECK(ram.getFrames() > 0);
+
+  // P6 header for 10 pixels in rows of 5, then 30 bytes of RGB per frame
+  CHECK(buffer.len % (11 + 30) == 0);
+  CHECK(memcmp(buffer.data, "P6\n5 2\n255\n", 11) == 0);
+  uint32_t c = ws2812fx.Adafruit_NeoPixel::getPixelColor(30);
+  size_t last = buffer.len - 30;
+  CHECK(buffer.data[last] == (uint8_t)(c >> 16) && buffer.data[last + 1] == (uint8_t)(c >> 8) && buffer.data[last + 2] == (uint8_t)c);
+
+  // one DDP packet per frame: version 1 + push, RGB24, 120 bytes
+  CHECK(udp.packets == (int)ram.getFrames());
+  CHECK(udp.header[0] == 0x41 && udp.header[2] == 0x0B && udp.header[3] == 1);
+  CHECK((udp.header[8] << 8 | udp.header[9]) == 120);
+
+  // empty frames don't write anything (and don't divide by a width of 0)
+  Buffer empty;
+  FileOutput file_empty(empty, 10, true);
+  file_empty.show(grbw.getPixels(), 0, NEO_GRBW);
+  CHECK(empty.len == 0);
+
+  // a busy output holds back the frame for all outputs
+  WS2812FX small(5, 5, NEO_GRB + NEO_KHZ800);
+  Busy busy;
+  small.init();
+  small.addOutput(busy, 0);
+  small.setSegment(0, 0, 4, FX_MODE_RAINBOW_CYCLE, RED, 10, false);
+  small.start();
+  busy.busy = true;
+  for(int i=0; i<5; i++) {
+    advance_ms(11);
+    small.service();
+  }
+  CHECK(busy.shows == 0);
+  busy.busy = false;
+  advance_ms(11);
+  small.service();
+  CHECK(busy.shows == 1);
+
+  return done("outputs");
+}
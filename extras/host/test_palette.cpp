@@ -0,0 +1,134 @@
+/*
+  test_palette.cpp - A palette's table has its 16 colors every 17th entry
+  and blends between them, the modes draw with it (or with the color wheel
+  without one), modes with a palette of their own draw the same colors
+  without the table, a crossfade moves PALETTE_FADE_ENTRIES entries per
+  frame, and fading to PALETTE_NONE ends exactly on the color wheel and
+  frees the table.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+static void frame(WS2812FX& ws2812fx) {
+  advance_ms(11); // every segment renders
+  ws2812fx.service();
+}
+
+// entries that changed since before, and how far the one that moved most did
+static uint16_t moved(WS2812FX& ws2812fx, const uint32_t* before, uint8_t* most) {
+  uint16_t count = 0;
+  *most = 0;
+  for(uint16_t i=0; i < 256; i++) {
+    uint32_t c = ws2812fx.getPaletteColor(0, i);
+    if(c != before[i]) count++;
+    for(uint8_t shift=0; shift < 24; shift += 8) {
+      int16_t d = abs((int16_t)((c >> shift) & 0xFF) - (int16_t)((before[i] >> shift) & 0xFF));
+      if(d > *most) *most = d;
+    }
+  }
+  return count;
+}
+
+int main() {
+  WS2812FX ws2812fx(60, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, 19, FX_MODE_RAINBOW, RED, 2560, false); // a frame every 10ms
+  ws2812fx.setSegment(1, 20, 39, FX_MODE_NOISE_OCEAN, RED, 640, false);
+  ws2812fx.setSegment(2, 40, 59, FX_MODE_NOISE_OCEAN, RED, 640, false);
+  ws2812fx.start();
+
+  // no palette, the color wheel
+  for(uint16_t i=0; i < 256; i++) CHECK(ws2812fx.getPaletteColor(0, i) == ws2812fx.color_wheel(i));
+  for(uint8_t f=0; f < 10; f++) {
+    frame(ws2812fx);
+    CHECK(ws2812fx.getPixelColor(0) == ws2812fx.color_wheel(f));
+  }
+
+  // the 16 colors every 17th entry, blended in between
+  size_t used = heap_used;
+  CHECK(ws2812fx.setPalette(0, PALETTE_RAINBOW));
+  CHECK(heap_used > used);
+  CHECK(ws2812fx.getPaletteColor(0, 0) == 0xFF0000);
+  CHECK(ws2812fx.getPaletteColor(0, 6 * 17) == 0x00FF00);
+  CHECK(ws2812fx.getPaletteColor(0, 10 * 17) == 0x0000FF);
+  CHECK(ws2812fx.getPaletteColor(0, 255) == 0xD5002B);
+  uint16_t off = 0;
+  for(uint16_t i=0; i < 256; i++) {
+    uint8_t j = i / 17, k = i % 17;
+    uint32_t a = ws2812fx.getPaletteColor(0, j * 17);
+    uint32_t b = ws2812fx.getPaletteColor(0, min(j + 1, 15) * 17);
+    uint32_t c = 0;
+    for(uint8_t shift=0; shift < 24; shift += 8) {
+      int16_t ca = (a >> shift) & 0xFF, cb = (b >> shift) & 0xFF;
+      c |= (uint32_t)(uint8_t)(ca + (cb - ca) * k / 17) << shift;
+    }
+    if(ws2812fx.getPaletteColor(0, i) != c) off++;
+  }
+  CHECK(off == 0);
+
+  // the mode takes its colors from the table now
+  ws2812fx.setMode(FX_MODE_RAINBOW); // from the first color again
+  for(uint8_t f=0; f < 10; f++) {
+    frame(ws2812fx);
+    CHECK(ws2812fx.getPixelColor(0) == ws2812fx.getPaletteColor(0, f));
+  }
+
+  // a mode with a palette of its own works its colors out without a table,
+  // they're the same as with the palette expanded
+  CHECK(ws2812fx.setPalette(2, PALETTE_OCEAN));
+  uint16_t differ = 0;
+  for(uint8_t f=0; f < 50; f++) {
+    frame(ws2812fx);
+    for(uint16_t i=0; i < 20; i++) {
+      if(ws2812fx.getPixelColor(20 + i) != ws2812fx.getPixelColor(40 + i)) differ++;
+    }
+  }
+  CHECK(differ == 0);
+  CHECK(ws2812fx.setPalette(2, PALETTE_NONE));
+
+  // a crossfade moves PALETTE_FADE_ENTRIES entries per frame, up to step each
+  uint32_t before[256], target[256];
+  CHECK(ws2812fx.setPalette(3, PALETTE_HEAT)); // an unused segment, for the colors
+  for(uint16_t i=0; i < 256; i++) target[i] = ws2812fx.getPaletteColor(3, i);
+  CHECK(ws2812fx.setPalette(3, PALETTE_NONE));
+  for(uint16_t i=0; i < 256; i++) before[i] = ws2812fx.getPaletteColor(0, i);
+  size_t allocs = heap_allocs;
+  CHECK(ws2812fx.fadeToPalette(0, PALETTE_HEAT, 4));
+  uint8_t most;
+  frame(ws2812fx);
+  uint16_t count = moved(ws2812fx, before, &most);
+  CHECK(count > 0 && count <= PALETTE_FADE_ENTRIES);
+  CHECK(most == 4);
+  for(uint16_t i=PALETTE_FADE_ENTRIES; i < 256; i++) CHECK(ws2812fx.getPaletteColor(0, i) == before[i]);
+
+  // at full speed a pass over the table gets there
+  CHECK(ws2812fx.fadeToPalette(0, PALETTE_HEAT, 255));
+  for(uint8_t f=0; f < 256 / PALETTE_FADE_ENTRIES; f++) {
+    frame(ws2812fx);
+    for(uint16_t i=0; i < (f + 1) * PALETTE_FADE_ENTRIES; i++) CHECK(ws2812fx.getPaletteColor(0, i) == target[i]);
+  }
+  CHECK(heap_allocs == allocs); // the table is reused
+
+  // back to the color wheel, slowly: the table ends exactly on it, then goes
+  CHECK(ws2812fx.fadeToPalette(0, PALETTE_NONE, 4));
+  bool wheel = false;
+  uint16_t f = 0;
+  while(heap_used > used && f++ < 1000) {
+    wheel = true;
+    for(uint16_t i=0; i < 256; i++) {
+      if(ws2812fx.getPaletteColor(0, i) != ws2812fx.color_wheel(i)) wheel = false;
+    }
+    frame(ws2812fx);
+  }
+  CHECK(heap_used == used);
+  CHECK(wheel); // on the frame before it was freed
+  ws2812fx.setMode(FX_MODE_RAINBOW);
+  for(uint8_t f=0; f < 10; f++) {
+    frame(ws2812fx);
+    CHECK(ws2812fx.getPixelColor(0) == ws2812fx.color_wheel(f));
+  }
+
+  return done("palette");
+}
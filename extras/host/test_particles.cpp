@@ -0,0 +1,59 @@
+/*
+  test_particles.cpp - The particle modes keep to their pool, allocate it
+  once and light up the strip.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+static void run(WS2812FX& ws2812fx, int frames) {
+  for(int i=0; i<frames; i++) {
+    advance_ms(16);
+    ws2812fx.service();
+  }
+}
+
+int main() {
+  uint8_t modes[] = {FX_MODE_MULTI_COMET, FX_MODE_METEOR_SHOWER, FX_MODE_BOUNCING_BALLS, FX_MODE_FIREWORKS_ROCKETS};
+  uint32_t colors[] = {RED, GREEN, BLUE};
+
+  for(uint8_t m=0; m<sizeof(modes); m++) {
+    WS2812FX ws2812fx(60, 5, NEO_GRB + NEO_KHZ800);
+    ws2812fx.init();
+    ws2812fx.setBrightness(255);
+    ws2812fx.setSegment(0, 0, 59, modes[m], colors, 1000, m % 2);
+    ws2812fx.start();
+    run(ws2812fx, 10);
+
+    size_t allocs = heap_allocs;
+    uint16_t most = 0;
+    int lit = 0;
+    for(int f=0; f<3000; f++) {
+      run(ws2812fx, 1);
+      most = max(most, ws2812fx.getParticleCount(0));
+      for(uint16_t i=0; i<60; i++) lit += ws2812fx.getPixelColor(i) != 0;
+    }
+    CHECK(heap_allocs == allocs);
+    CHECK(most > 0 && most <= DEFAULT_PARTICLES);
+    CHECK(lit > 3000); // more than one LED per frame on average
+  }
+
+  // a smaller pool drops the particles beyond it
+  WS2812FX ws2812fx(100, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setSegment(0, 0, 99, FX_MODE_MULTI_COMET, RED, 1000, true);
+  ws2812fx.start();
+  ws2812fx.setParticles(0, 64);
+  run(ws2812fx, 500);
+  CHECK(ws2812fx.getParticleCount(0) > 4);
+  ws2812fx.setParticles(0, 4);
+  CHECK(ws2812fx.getParticleCount(0) <= 4);
+  uint16_t most = 0;
+  for(int f=0; f<500; f++) {
+    run(ws2812fx, 1);
+    most = max(most, ws2812fx.getParticleCount(0));
+  }
+  CHECK(most > 0 && most <= 4);
+
+  return done("particles");
+}
@@ -0,0 +1,79 @@
+/*
+  test_pixel_buffer.cpp - setLength() on a pixel buffer of the sketch
+  (setPixelBuffer()) never allocates, stays within its capacity and switches
+  off the LEDs cut off.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+static uint8_t pixelBuffer[1000 * 6];
+
+static void frame(WS2812FX& ws2812fx) {
+  advance_ms(20);
+  ws2812fx.service();
+}
+
+static void resize(WS2812FX& ws2812fx, uint16_t n) {
+  ws2812fx.setLength(n);
+  ws2812fx.setSegment(0, 0, n - 1, FX_MODE_STATIC, RED, 1000, false);
+  frame(ws2812fx);
+}
+
+int main() {
+  WS2812FX ws2812fx(300, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, 299, FX_MODE_STATIC, RED, 1000, false);
+  ws2812fx.start();
+  CHECK(ws2812fx.getCapacity() == 0); // on the heap
+
+  size_t allocs = heap_allocs;
+  for(int i=0; i<100; i++) resize(ws2812fx, 100 + (i * 37) % 900);
+  CHECK(heap_allocs > allocs);
+
+  CHECK(ws2812fx.setPixelBuffer(pixelBuffer, sizeof(pixelBuffer)) == 1000);
+  CHECK(ws2812fx.getCapacity() == 1000);
+  allocs = heap_allocs;
+  for(int i=0; i<100; i++) resize(ws2812fx, 100 + (i * 37) % 900);
+  CHECK(heap_allocs == allocs);
+
+  // the LEDs cut off are sent black once, then the shorter strip
+  resize(ws2812fx, 800);
+  CHECK(Adafruit_NeoPixel::lastShowLen == 800);
+  ws2812fx.setLength(20);
+  frame(ws2812fx);
+  CHECK(Adafruit_NeoPixel::lastShowLen == 800);
+  CHECK(Adafruit_NeoPixel::lastShow[1] == 0xFF); // GRB, red
+  int lit = 0;
+  for(int i=20*3; i<800*3; i++) lit += Adafruit_NeoPixel::lastShow[i] != 0;
+  CHECK(lit == 0);
+  frame(ws2812fx);
+  ws2812fx.show();
+  CHECK(Adafruit_NeoPixel::lastShowLen == 20);
+
+  // no further than the buffer
+  ws2812fx.setLength(5000);
+  CHECK(ws2812fx.getLength() == 1000);
+  ws2812fx.decreaseLength(10);
+  CHECK(ws2812fx.getLength() == 990);
+
+  // back on the heap, which only has room for 600 LEDs
+  ws2812fx.setPixelBuffer(NULL, 0);
+  CHECK(ws2812fx.getCapacity() == 0);
+  CHECK(ws2812fx.getLength() == 990);
+  heap_limit = 600 * 3;
+  ws2812fx.setLength(1000);
+  heap_limit = (size_t)-1;
+  CHECK(ws2812fx.getLength() == 600);
+  CHECK(ws2812fx.getSegments()[0].stop == 599);
+
+  // buffers too small for the strip cut it down, or are refused
+  ws2812fx.setLength(10);
+  CHECK(ws2812fx.setPixelBuffer(pixelBuffer, 30) == 5);
+  CHECK(ws2812fx.getLength() == 5);
+  CHECK(ws2812fx.setPixelBuffer(pixelBuffer, 3) == 0);
+  CHECK(ws2812fx.getLength() == 5);
+
+  return done("pixel buffer");
+}
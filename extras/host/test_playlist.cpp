@@ -0,0 +1,116 @@
+/*
+  test_playlist.cpp - A playlist plays copies of its patterns: changing the
+  segments while a pattern plays leaves the patterns alone, changes to a
+  pattern show the next time it's played. The next pattern is staged in a
+  second table while the current one plays, a switch swaps the tables and
+  only clears what the new modes don't draw over.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+static void frame(WS2812FX& ws2812fx) {
+  advance_ms(1001);
+  ws2812fx.service();
+}
+
+int main() {
+  WS2812FX::pattern patterns[] = {
+    {128, 0, 1, {{FX_MODE_STATIC, {RED}, 1000, 0, 29, false, 0}}},
+    { 64, 0, 2, {{FX_MODE_BLINK, {RED}, 1000, 0, 14, false, 0},
+                 {FX_MODE_SCAN, {GREEN}, 1000, 15, 29, false, 0}}}
+  };
+  WS2812FX::pattern saved[2];
+  memcpy(saved, patterns, sizeof(saved));
+
+  WS2812FX ws2812fx(30, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setSegment(0, 0, 29, FX_MODE_RAINBOW, BLUE, 1000, false);
+  ws2812fx.start();
+  CHECK(ws2812fx.setPlaylist(patterns, 2));
+  frame(ws2812fx);
+  CHECK(ws2812fx.getSegments() != patterns[0].segments);
+  CHECK(ws2812fx.getMode() == FX_MODE_STATIC);
+
+  // the sketch changes the pattern playing, the playlist stays as it was
+  ws2812fx.setMode(FX_MODE_FIRE_FLICKER);
+  ws2812fx.setColor(BLUE);
+  ws2812fx.setSegment(1, 10, 29, FX_MODE_COMET, WHITE, 500, true);
+  frame(ws2812fx);
+  CHECK(ws2812fx.getNumSegments() == 2);
+  CHECK(memcmp(saved, patterns, sizeof(saved)) == 0);
+  ws2812fx.resetSegments();
+  frame(ws2812fx);
+  CHECK(memcmp(saved, patterns, sizeof(saved)) == 0);
+
+  // a change to the pattern itself shows when it's played next
+  patterns[1].segments[1].mode = FX_MODE_LARSON_SCANNER;
+  ws2812fx.nextPattern();
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 1);
+  CHECK(ws2812fx.getNumSegments() == 2);
+  CHECK(ws2812fx.getSegments()[1].mode == FX_MODE_LARSON_SCANNER);
+  ws2812fx.nextPattern();
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 0);
+  CHECK(ws2812fx.getNumSegments() == 1);
+  CHECK(ws2812fx.getMode() == FX_MODE_STATIC);
+  CHECK(ws2812fx.getColor() == RED);
+
+  // stopped, the regular segments are back
+  CHECK(ws2812fx.setPlaylist(NULL, 0));
+  CHECK(ws2812fx.getMode() == FX_MODE_RAINBOW);
+  CHECK(ws2812fx.getColor() == BLUE);
+
+  // timed, the tables take turns and the next pattern is copied while the current one plays
+  WS2812FX::pattern timed[] = {
+    {255, 2, 1, {{FX_MODE_STATIC, {RED}, 1000, 0, 29, false, 0}}},
+    {255, 2, 2, {{FX_MODE_STATIC, {GREEN}, 1000, 0, 9, false, 0},
+                 {FX_MODE_COLOR_WIPE, {BLUE}, 1000, 15, 29, false, 0}}}
+  };
+  CHECK(ws2812fx.setPlaylist(timed, 2));
+  frame(ws2812fx);
+  WS2812FX::segment* first = ws2812fx.getSegments();
+  CHECK(ws2812fx.getPixelColor(20) == RED);
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 1);
+  CHECK(ws2812fx.getSegments() != first);
+  for(uint16_t i=0; i < 30; i++) { // no red left over, between the segments or behind the wipe
+    uint32_t c = ws2812fx.getPixelColor(i);
+    CHECK(i < 10 ? c == GREEN : (c == BLACK || c == BLUE));
+  }
+  timed[0].segments[0].colors[0] = WHITE; // staged already, shows the time after
+  frame(ws2812fx);
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 0);
+  CHECK(ws2812fx.getSegments() == first);
+  CHECK(ws2812fx.getColor() == RED);
+  timed[1].segments[0].colors[0] = YELLOW; // nextPattern() copies it again
+  ws2812fx.nextPattern();
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 1);
+  CHECK(ws2812fx.getPixelColor(0) == YELLOW);
+  frame(ws2812fx);
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 0);
+  CHECK(ws2812fx.getColor() == WHITE);
+
+  // a switch costs no allocation and no copy of the playlist's segments
+  size_t allocs = heap_allocs;
+  timed[1].segments[0].colors[0] = MAGENTA;
+  frame(ws2812fx);
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPatternIndex() == 1);
+  CHECK(ws2812fx.getPixelColor(0) == YELLOW);
+  CHECK(heap_allocs == allocs);
+  CHECK(ws2812fx.setPlaylist(NULL, 0));
+
+  // no memory for the pattern tables, the regular segments keep playing
+  heap_limit = 2 * MAX_NUM_SEGMENTS * sizeof(WS2812FX::segment) - 1;
+  CHECK(!ws2812fx.setPlaylist(patterns, 2));
+  heap_limit = (size_t)-1;
+  frame(ws2812fx);
+  CHECK(ws2812fx.getMode() == FX_MODE_RAINBOW);
+
+  return done("playlist");
+}
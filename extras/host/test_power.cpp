@@ -0,0 +1,115 @@
+/*
+  test_power.cpp - The current limiter keeps the estimate under the budget
+  from the frame after an overshoot on, leaves the output alone while under
+  budget and its estimate matches the bytes sent, also for expanded segments.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define LEDS 100
+
+// the estimate for the frame sent last, from the bytes themselves
+static uint32_t shown_mA(void) {
+  uint32_t sum = 0;
+  for(uint16_t i=0; i < LEDS * 3; i++) sum += Adafruit_NeoPixel::lastShow[i];
+  return LEDS * 1 + sum / 255 * 20;
+}
+
+static void frame(WS2812FX& ws2812fx) {
+  advance_ms(10);
+  ws2812fx.service();
+}
+
+int main() {
+  WS2812FX ws2812fx(LEDS, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, LEDS - 1, FX_MODE_STATIC, WHITE, 1000, false);
+  ws2812fx.start();
+  frame(ws2812fx);
+  CHECK(ws2812fx.getPowerEstimate() == LEDS + LEDS * 3 * 20);
+  uint8_t full[LEDS * 3];
+  memcpy(full, Adafruit_NeoPixel::lastShow, sizeof(full));
+
+  // a budget above the draw changes nothing
+  ws2812fx.setMaxCurrent(10000);
+  frame(ws2812fx);
+  CHECK(memcmp(full, Adafruit_NeoPixel::lastShow, sizeof(full)) == 0);
+
+  // a lower one dims the static frame on the next call, not when the segment is due again
+  ws2812fx.setMaxCurrent(2000);
+  unsigned long shows = Adafruit_NeoPixel::showCount;
+  frame(ws2812fx);
+  CHECK(Adafruit_NeoPixel::showCount == shows + 1);
+  CHECK(shown_mA() <= 2000 && shown_mA() > 2000 * 9 / 10);
+  CHECK(ws2812fx.getPowerEstimate() == shown_mA());
+
+  // and then it stays put, the frame isn't sent again and again
+  shows = Adafruit_NeoPixel::showCount;
+  for(int i=0; i<10; i++) frame(ws2812fx);
+  CHECK(Adafruit_NeoPixel::showCount == shows);
+
+  // from dark and dim to full white, no frame sent is over the budget
+  uint32_t steps[] = {BLACK, 0x100000, WHITE, BLACK, WHITE};
+  ws2812fx.setMaxCurrent(0);
+  ws2812fx.setColor(BLACK);
+  frame(ws2812fx);
+  ws2812fx.setMaxCurrent(3000);
+  for(int s=0; s<5; s++) {
+    ws2812fx.setColor(steps[s]);
+    CHECK(shown_mA() <= 3000);
+    for(int i=0; i<5; i++) {
+      shows = Adafruit_NeoPixel::showCount;
+      frame(ws2812fx);
+      if(Adafruit_NeoPixel::showCount != shows) CHECK(shown_mA() <= 3000);
+    }
+  }
+  CHECK(shown_mA() <= 3000 && shown_mA() > 3000 * 8 / 10);
+
+  // the same for an animated mode, frame by frame
+  ws2812fx.setMode(FX_MODE_BLINK);
+  ws2812fx.setSpeed(200);
+  for(int i=0; i<100; i++) {
+    shows = Adafruit_NeoPixel::showCount;
+    frame(ws2812fx);
+    if(Adafruit_NeoPixel::showCount != shows) CHECK(shown_mA() <= 3000);
+  }
+  ws2812fx.setMode(FX_MODE_STATIC);
+
+  // a budget below the idle current makes it dark, but can be raised again
+  ws2812fx.setMaxCurrent(50);
+  frame(ws2812fx);
+  frame(ws2812fx);
+  CHECK(shown_mA() == LEDS);
+  ws2812fx.setMaxCurrent(2000);
+  for(int i=0; i<20; i++) frame(ws2812fx);
+  CHECK(shown_mA() <= 2000 && shown_mA() > 2000 * 9 / 10);
+
+  // off again, full brightness
+  ws2812fx.setMaxCurrent(0);
+  frame(ws2812fx);
+  CHECK(memcmp(full, Adafruit_NeoPixel::lastShow, sizeof(full)) == 0);
+
+  // mirrored, grouped and cloned segments, the estimate counts the expanded frame
+  ws2812fx.resetSegments();
+  ws2812fx.setSegment(0, 0, 39, FX_MODE_RAINBOW_CYCLE, RED, 100, false);
+  ws2812fx.setSegmentOptions(0, 3, true);
+  ws2812fx.setSegment(1, 40, 69, FX_MODE_STATIC, BLUE, 1000, false);
+  ws2812fx.setSegment(2, 70, 99, FX_MODE_STATIC, RED, 1000, true);
+  ws2812fx.setSegmentOptions(2, 1, false, 0);
+  ws2812fx.setMaxCurrent(100000);
+  for(int i=0; i<20; i++) {
+    frame(ws2812fx);
+    CHECK(ws2812fx.getPowerEstimate() == shown_mA());
+  }
+  ws2812fx.setSegment(1, 40, 59, FX_MODE_STATIC, GREEN, 1000, false);
+  ws2812fx.setSegment(2, 60, 99, FX_MODE_STATIC, RED, 1000, false);
+  ws2812fx.setSegmentOptions(2, 1, false, 1); // longer than its source
+  for(int i=0; i<20; i++) {
+    frame(ws2812fx);
+    CHECK(ws2812fx.getPowerEstimate() == shown_mA());
+  }
+
+  return done("power");
+}
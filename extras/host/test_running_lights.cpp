@@ -0,0 +1,68 @@
+/*
+  test_running_lights.cpp - Running Lights draws the same frames as the
+  original formula at every length, in both directions. With the frame
+  cache, the rotated frames may be off by one here and there.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define MAX_LEN 300
+
+// the mode as it was written first, pixel i of a segment of len at step
+static uint32_t reference(uint16_t len, uint16_t step, uint16_t i, uint32_t color) {
+  uint8_t w = ((color >> 24) & 0xFF);
+  uint8_t r = ((color >> 16) & 0xFF);
+  uint8_t g = ((color >>  8) & 0xFF);
+  uint8_t b = (color         & 0xFF);
+  float radPerLed = (2.0 * 3.14159) / len;
+  int lum = map((int)(sin((i + step) * radPerLed) * 128), -128, 128, 0, 255);
+  return ((uint32_t)((w * lum) / 256) << 24) | ((uint32_t)((r * lum) / 256) << 16) |
+    ((uint32_t)((g * lum) / 256) << 8) | ((b * lum) / 256);
+}
+
+static uint8_t distance(uint32_t a, uint32_t b) {
+  uint8_t d = 0;
+  for(uint8_t shift=0; shift < 32; shift += 8) {
+    d = max(d, (uint8_t)abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF)));
+  }
+  return d;
+}
+
+int main() {
+  uint32_t color = 0x40FF8020;
+  WS2812FX ws2812fx(MAX_LEN, 5, NEO_GRBW + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.start();
+
+  for(uint8_t cached=0; cached < 2; cached++) {
+    ws2812fx.setFrameCache(0, cached ? MAX_LEN * 4 : 0);
+    ws2812fx.resetStats();
+    for(uint8_t reverse=0; reverse < 2; reverse++) {
+      for(uint16_t len=1; len <= MAX_LEN; len++) {
+        ws2812fx.resetSegments(); // from step 0
+        ws2812fx.setSegment(0, 0, len - 1, FX_MODE_RUNNING_LIGHTS, color, 1000, reverse);
+        uint8_t worst = 0;
+        for(uint16_t frame=0; frame < len + 2; frame++) {
+          advance_ms(1001);
+          ws2812fx.service();
+          uint16_t step = frame % len;
+          for(uint16_t i=0; i < len; i++) {
+            uint32_t c = ws2812fx.getPixelColor(reverse ? i : len - 1 - i);
+            worst = max(worst, distance(c, reference(len, step, i, color)));
+          }
+        }
+        if(cached) {
+          CHECK(worst <= 1);
+        } else if(worst != 0) {
+          printf("length %u, %s: %u off\n", len, reverse ? "reverse" : "forward", worst);
+          CHECK(worst == 0);
+        }
+      }
+    }
+    CHECK(cached ? ws2812fx.getStats().cache_hits > 0 : ws2812fx.getStats().cache_hits == 0);
+  }
+
+  return done("running lights");
+}
@@ -0,0 +1,38 @@
+/*
+  test_segments.cpp - The runtime sized WS2812FX allocates its segment
+  tables once, for MAX_NUM_SEGMENTS segments, or none at all.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+int main() {
+  size_t allocs = heap_allocs;
+  WS2812FX* ws2812fx = new WS2812FX(30, 5, NEO_GRB + NEO_KHZ800);
+  CHECK(ws2812fx->getMaxSegments() == MAX_NUM_SEGMENTS);
+  CHECK(ws2812fx->getNumSegments() == 1);
+  ws2812fx->init();
+  ws2812fx->setSegment(MAX_NUM_SEGMENTS - 1, 20, 29, FX_MODE_STATIC, RED, 1000, false);
+  CHECK(ws2812fx->getNumSegments() == MAX_NUM_SEGMENTS);
+  delete ws2812fx;
+  size_t calls = heap_allocs - allocs;
+
+  // one byte short of the segment tables, the instance must not settle for fewer
+  size_t tables = MAX_NUM_SEGMENTS * (sizeof(WS2812FX::segment) + sizeof(WS2812FX::segment_runtime));
+  heap_limit = tables - 1;
+  allocs = heap_allocs;
+  ws2812fx = new WS2812FX(30, 5, NEO_GRB + NEO_KHZ800);
+  heap_limit = (size_t)-1;
+  CHECK(heap_allocs - allocs <= calls); // no retries with fewer segments
+  CHECK(ws2812fx->getMaxSegments() == 0);
+  CHECK(ws2812fx->getNumSegments() == 0);
+  ws2812fx->init();
+  ws2812fx->setSegment(0, 0, 29, FX_MODE_STATIC, RED, 1000, false);
+  ws2812fx->start();
+  advance_ms(20);
+  ws2812fx->service();
+  CHECK(ws2812fx->getNumSegments() == 0);
+  delete ws2812fx;
+
+  return done("segments");
+}
@@ -0,0 +1,110 @@
+/*
+  test_shift.cpp - Running Random, which moves its pixels with shift(),
+  draws the same frames as the original pixel by pixel copy, at every
+  length and in both directions. shift() on a layer moves the layer's
+  pixels and leaves the segments below alone.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define MAX_LEN 120
+#define UNUSED_SEGMENT 9 // no palette, getPaletteColor() gives the color wheel
+
+// the original mode, pixel by pixel
+static uint8_t wheel_index(uint8_t pos) {
+  uint8_t r = 0, d = 0;
+  while(d < 42) {
+    r = random(256);
+    uint8_t x = abs(pos - r);
+    d = min(x, (uint8_t)(255 - x));
+  }
+  return r;
+}
+
+static uint8_t aux;
+static bool step;
+
+static void reference(WS2812FX& ws2812fx, uint32_t* pixels, uint16_t len, bool reverse) {
+  for(uint16_t i=len - 1; i > 0; i--) {
+    if(reverse) {
+      pixels[len - 1 - i] = pixels[len - i];
+    } else {
+      pixels[i] = pixels[i - 1];
+    }
+  }
+  if(!step) {
+    aux = wheel_index(aux);
+    pixels[reverse ? len - 1 : 0] = ws2812fx.getPaletteColor(UNUSED_SEGMENT, aux);
+  }
+  step = !step;
+}
+
+// draws a ramp the first time, then leaves its pixels alone
+static uint16_t ramp(WS2812FX::span& s, void* user) {
+  if(s.runtime->counter_mode_call == 0) {
+    for(uint16_t i=0; i < s.length; i++) s.setPixel(i, i + 1);
+  }
+  return 60000;
+}
+
+int main() {
+  WS2812FX ws2812fx(MAX_LEN + 5, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.start();
+
+  static uint32_t pixels[MAX_LEN];
+  for(uint8_t reverse=0; reverse < 2; reverse++) {
+    for(uint16_t len=1; len <= MAX_LEN; len++) {
+      ws2812fx.resetSegments();
+      ws2812fx.clear();
+      ws2812fx.setSegment(0, 5, 5 + len - 1, FX_MODE_RUNNING_RANDOM, RED, 1000, reverse);
+      memset(pixels, 0, sizeof(pixels));
+      aux = 0;
+      step = false;
+      bool same = true;
+      for(uint16_t frame=0; frame < len + 20 && same; frame++) {
+        advance_ms(1001);
+        randomSeed(frame + len);
+        ws2812fx.service();
+        randomSeed(frame + len);
+        reference(ws2812fx, pixels, len, reverse);
+        for(uint16_t i=0; i < len; i++) same = same && ws2812fx.getPixelColor(5 + i) == pixels[i];
+        same = same && ws2812fx.getPixelColor(4) == BLACK && ws2812fx.getPixelColor(5 + len) == BLACK;
+      }
+      if(!same) printf("length %u, %s: not the original frames\n", len, reverse ? "reverse" : "forward");
+      CHECK(same);
+    }
+  }
+
+  // a layer over a black segment, BLEND_MAX shows it as it is
+  ws2812fx.resetSegments();
+  ws2812fx.setSegment(0, 0, 39, FX_MODE_STATIC, (uint32_t)BLACK, 1000, false);
+  ws2812fx.setSegment(1, 10, 29, ws2812fx.addCustomMode(F("Ramp"), ramp), RED, 1000, false);
+  ws2812fx.setSegmentLayer(1, BLEND_MAX);
+  advance_ms(1001);
+  ws2812fx.service();
+  for(uint8_t i=0; i < 20; i++) CHECK(Adafruit_NeoPixel::lastShow[(10 + i) * 3 + 2] == i + 1); // blue of GRB
+
+  ws2812fx.shift(1, 3); // the first 3 keep their colors
+  ws2812fx.show();
+  for(uint8_t i=0; i < 20; i++) {
+    CHECK(Adafruit_NeoPixel::lastShow[(10 + i) * 3 + 2] == (i < 3 ? i + 1 : i - 2));
+    CHECK(ws2812fx.getPixelColor(10 + i) == BLACK); // the segment below is untouched
+  }
+  ws2812fx.shift(1, -5);
+  ws2812fx.show();
+  for(uint8_t i=0; i < 20; i++) {
+    CHECK(Adafruit_NeoPixel::lastShow[(10 + i) * 3 + 2] == (i < 15 ? i + 3 : i - 2));
+  }
+  CHECK(Adafruit_NeoPixel::lastShow[9 * 3 + 2] == 0 && Adafruit_NeoPixel::lastShow[30 * 3 + 2] == 0);
+
+  // as long as the layer, or longer, there's nothing to move
+  ws2812fx.shift(1, 20);
+  ws2812fx.shift(1, -25);
+  ws2812fx.show();
+  CHECK(Adafruit_NeoPixel::lastShow[10 * 3 + 2] == 3 && Adafruit_NeoPixel::lastShow[29 * 3 + 2] == 17);
+
+  return done("shift");
+}
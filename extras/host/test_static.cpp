@@ -0,0 +1,56 @@
+/*
+  test_static.cpp - Static segments are only drawn again when their settings
+  change, or when the sketch drew over them, however often it did.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+// long enough for the segment to be due
+static void frame(WS2812FX& ws2812fx) {
+  advance_ms(1001);
+  ws2812fx.service();
+}
+
+static bool all(WS2812FX& ws2812fx, uint16_t n, uint32_t color) {
+  for(uint16_t i=0; i<n; i++) {
+    if(ws2812fx.getPixelColor(i) != color) return false;
+  }
+  return true;
+}
+
+int main() {
+  WS2812FX ws2812fx(10, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, 9, FX_MODE_STATIC, RED, 1000, false);
+  ws2812fx.start();
+  frame(ws2812fx);
+  CHECK(all(ws2812fx, 10, RED));
+
+  // nothing changed, nothing sent
+  unsigned long shows = Adafruit_NeoPixel::showCount;
+  for(int i=0; i<10; i++) frame(ws2812fx);
+  CHECK(Adafruit_NeoPixel::showCount == shows);
+
+  // any number of pixels drawn by the sketch between two frames
+  for(int writes=1; writes <= 600; writes++) {
+    for(int i=0; i<writes; i++) ws2812fx.setPixelColor(i % 10, i + 1); // a new color every time
+    frame(ws2812fx);
+    if(!all(ws2812fx, 10, RED)) {
+      printf("not drawn again after %d writes\n", writes);
+      CHECK(false);
+      break;
+    }
+  }
+  ws2812fx.clear();
+  frame(ws2812fx);
+  CHECK(all(ws2812fx, 10, RED));
+
+  // a new color is drawn
+  ws2812fx.setColor(BLUE);
+  frame(ws2812fx);
+  CHECK(all(ws2812fx, 10, BLUE));
+
+  return done("static");
+}
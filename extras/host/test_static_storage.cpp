@@ -0,0 +1,80 @@
+/*
+  test_static_storage.cpp - StaticWS2812FX, RGB and RGBW, draws and sends
+  the same frames as WS2812FX with the same settings, through all original
+  modes on three segments (one of them grouped and mirrored), and never
+  touches the heap doing so.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+#define LEDS 90
+
+// three segments running original modes (those before Custom), from their first frame
+static void modes(WS2812FX& ws2812fx, uint8_t m) {
+  ws2812fx.setSegment(0, 0, 29, m % FX_MODE_CUSTOM, RED, 500, false);
+  ws2812fx.setSegment(1, 30, 59, (m + 19) % FX_MODE_CUSTOM, GREEN, 500, true);
+  ws2812fx.setSegment(2, 60, 89, (m + 38) % FX_MODE_CUSTOM, BLUE, 500, false);
+  ws2812fx.start();
+}
+
+static void setup(WS2812FX& ws2812fx) {
+  ws2812fx.init();
+  ws2812fx.setBrightness(200);
+  ws2812fx.setMaxCurrent(2000);
+  modes(ws2812fx, 0);
+  ws2812fx.setSegmentOptions(2, 2, true);
+}
+
+template<neoPixelType TYPE> static void compare(const char* name) {
+  uint8_t bpp = (TYPE == NEO_GRBW + NEO_KHZ800) ? 4 : 3;
+  static uint8_t sent[LEDS * 4];
+
+  size_t allocs = heap_allocs;
+  StaticWS2812FX<LEDS, 3, TYPE> fixed(5);
+  setup(fixed);
+  CHECK(heap_allocs == allocs);
+  WS2812FX dynamic(LEDS, 5, TYPE);
+  setup(dynamic);
+  CHECK(heap_allocs > allocs); // the regular one takes its buffers from the heap
+
+  uint16_t differ = 0;
+  for(uint8_t m=0; m < FX_MODE_CUSTOM; m++) {
+    modes(fixed, m);
+    modes(dynamic, m);
+    for(uint16_t f=0; f < 60; f++) {
+      advance_ms(17);
+      randomSeed(m * 100 + f);
+      fixed.service();
+      memcpy(sent, Adafruit_NeoPixel::lastShow, LEDS * bpp);
+      randomSeed(m * 100 + f);
+      dynamic.service();
+      if(memcmp(fixed.getPixels(), dynamic.getPixels(), LEDS * bpp) != 0 ||
+        memcmp(sent, Adafruit_NeoPixel::lastShow, LEDS * bpp) != 0) differ++;
+    }
+  }
+  if(differ) printf("%s: %u frames differ\n", name, differ);
+  CHECK(differ == 0);
+}
+
+int main() {
+  compare<NEO_GRB + NEO_KHZ800>("RGB");
+  compare<NEO_GRBW + NEO_KHZ800>("RGBW");
+
+  // on its own, not a single allocation from construction to the last frame
+  size_t allocs = heap_allocs;
+  {
+    StaticWS2812FX<LEDS, 3, NEO_GRBW + NEO_KHZ800> fixed(5);
+    setup(fixed);
+    for(uint8_t m=0; m < FX_MODE_CUSTOM; m++) {
+      modes(fixed, m);
+      for(uint16_t f=0; f < 20; f++) {
+        advance_ms(17);
+        fixed.service();
+      }
+    }
+  }
+  CHECK(heap_allocs == allocs);
+
+  return done("static storage");
+}
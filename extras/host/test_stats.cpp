@@ -0,0 +1,69 @@
+/*
+  test_stats.cpp - A frame in which no pixel changed isn't sent and counts
+  in shows_saved, one that changed is sent, and a frame a custom mode
+  rendered is always sent, since there's no telling what it wrote.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+// the same color every frame
+static uint16_t steady(WS2812FX::span& s, void* user) {
+  for(uint16_t i=0; i < s.length; i++) s.setPixel(i, RED);
+  return 100;
+}
+
+// frames, shows and shows_saved of ten frames
+static void ten(WS2812FX& ws2812fx, uint32_t* frames, uint32_t* shows, uint32_t* saved) {
+  ws2812fx.resetStats();
+  unsigned long sent = Adafruit_NeoPixel::showCount;
+  for(uint8_t f=0; f < 10; f++) {
+    advance_ms(1001); // all due
+    ws2812fx.service();
+  }
+  *frames = ws2812fx.getStats().frames;
+  *shows = ws2812fx.getStats().shows;
+  *saved = ws2812fx.getStats().shows_saved;
+  CHECK(Adafruit_NeoPixel::showCount - sent == *shows);
+}
+
+int main() {
+  WS2812FX ws2812fx(20, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  uint32_t frames, shows, saved;
+
+  // blinking between the same two colors, only the first frame is sent
+  uint32_t same[] = {RED, RED, BLACK};
+  ws2812fx.setSegment(0, 0, 19, FX_MODE_BLINK, same, 1000, false);
+  ws2812fx.start();
+  ten(ws2812fx, &frames, &shows, &saved);
+  CHECK(frames == 10 && shows == 1 && saved == 9);
+
+  // from then on none, the brightness is sent when it's set
+  ten(ws2812fx, &frames, &shows, &saved);
+  CHECK(frames == 10 && shows == 0 && saved == 10);
+  unsigned long sent = Adafruit_NeoPixel::showCount;
+  ws2812fx.setBrightness(128);
+  CHECK(Adafruit_NeoPixel::showCount == sent + 1);
+  ten(ws2812fx, &frames, &shows, &saved);
+  CHECK(frames == 10 && shows == 0 && saved == 10);
+
+  // blinking for real, every frame is sent
+  uint32_t two[] = {BLUE, GREEN, BLACK};
+  ws2812fx.setSegment(0, 0, 19, FX_MODE_BLINK, two, 1000, false);
+  ten(ws2812fx, &frames, &shows, &saved);
+  CHECK(frames == 10 && shows == 10 && saved == 0);
+
+  // a custom mode drawing the same pixels is sent every frame, also along
+  // with a segment which didn't change
+  uint8_t mode = ws2812fx.addCustomMode(F("Steady"), steady);
+  ws2812fx.setSegment(0, 0, 9, mode, RED, 1000, false);
+  ws2812fx.setSegment(1, 10, 19, FX_MODE_BLINK, same, 1000, false);
+  ws2812fx.start();
+  ten(ws2812fx, &frames, &shows, &saved);
+  CHECK(frames == 10 && shows == 10 && saved == 0);
+  CHECK(ws2812fx.getPixelColor(0) == RED && ws2812fx.getPixelColor(10) == RED);
+
+  return done("stats");
+}
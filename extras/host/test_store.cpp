@@ -0,0 +1,167 @@
+/*
+  test_store.cpp - WS2812FXStore on a file backed EEPROM: patterns come
+  back as saved, unchanged ones aren't written again, segments no longer
+  used are gone after a restart, and a power loss at any write while
+  saving a pattern loads either the old or the new pattern, never a mix.
+*/
+
+#include "WS2812FX.h"
+#include "WS2812FXStore.h"
+#include <EEPROM.h>
+#include "host.h"
+
+#define REGION STORE_MAX_SIZE
+#define SEGMENT_ID(n, i) (STORE_USER_RECORDS + (n) * (MAX_NUM_SEGMENTS + 1) + 1 + (i))
+
+static uint8_t eeprom_read(uint16_t a) { return EEPROM.read(a); }
+static void eeprom_write(uint16_t a, uint8_t v) { EEPROM.write(a, v); }
+static void eeprom_commit(void) { EEPROM.commit(); }
+
+static WS2812FX::pattern make_pattern(uint8_t seed, uint8_t num_segments) {
+  WS2812FX::pattern p = {};
+  p.brightness = 10 + seed;
+  p.duration = 1000 + seed * 7;
+  p.numSegments = num_segments;
+  for(uint8_t i=0; i < num_segments; i++) {
+    WS2812FX::segment& seg = p.segments[i];
+    seg.start = i * 10;
+    seg.stop = i * 10 + 9;
+    seg.mode = (seed * 3 + i) % MODE_COUNT;
+    seg.speed = 200 + seed * 31 + i;
+    seg.reverse = (seed + i) & 1;
+    seg.options = (seed & 1) ? SEGMENT_OPTION_MIRROR | 2 : 0;
+    seg.colors[0] = 0x010203 * (seed + i + 1);
+    seg.colors[1] = (seed & 2) ? 0x80000000 | seed : 0;
+    seg.colors[2] = 0;
+  }
+  return p;
+}
+
+static bool same(const WS2812FX::pattern& a, const WS2812FX::pattern& b) {
+  if(a.brightness != b.brightness || a.duration != b.duration || a.numSegments != b.numSegments) return false;
+  for(uint8_t i=0; i < a.numSegments; i++) {
+    const WS2812FX::segment &x = a.segments[i], &y = b.segments[i];
+    if(x.start != y.start || x.stop != y.stop || x.mode != y.mode || x.speed != y.speed ||
+       x.reverse != y.reverse || x.options != y.options ||
+       memcmp(x.colors, y.colors, sizeof(x.colors)) != 0) return false;
+  }
+  return true;
+}
+
+// power up: a new store on what is in the file
+static WS2812FXStore* restart(WS2812FXStore* store) {
+  delete store;
+  EEPROM.begin(REGION);
+  store = new WS2812FXStore(0, REGION, eeprom_read, eeprom_write, eeprom_commit);
+  store->begin();
+  return store;
+}
+
+// all patterns saved with the given seed
+static WS2812FXStore* setup(WS2812FXStore* store, uint8_t seed) {
+  store = restart(store);
+  store->format();
+  for(uint8_t n=0; n < STORE_MAX_PATTERNS; n++) store->savePattern(n, make_pattern(seed + n, 1 + n % MAX_NUM_SEGMENTS));
+  store->commit();
+  return restart(store);
+}
+
+// saves b over a with the power cut after every write in turn
+static void torn_writes(WS2812FX::pattern& a, WS2812FX::pattern& b) {
+  WS2812FXStore* store = setup(NULL, 0);
+  store->savePattern(0, a);
+  store = restart(store);
+  unsigned long writes = EEPROM.getWrites();
+  store->savePattern(0, b);
+  unsigned long total = EEPROM.getWrites() - writes;
+  CHECK(total > 0);
+
+  unsigned long olds = 0, news = 0;
+  for(unsigned long cut=0; cut <= total; cut++) {
+    store = setup(store, 0);
+    store->savePattern(0, a);
+    store = restart(store);
+    EEPROM.cutPowerAfter(cut);
+    store->savePattern(0, b);
+    store = restart(store);
+
+    WS2812FX::pattern p = {};
+    CHECK(store->loadPattern(0, p));
+    if(same(p, a)) olds++;
+    else if(same(p, b)) news++;
+    else printf("cut after %lu of %lu writes: mixed pattern\n", cut, total);
+    if(cut == total) CHECK(same(p, b));
+
+    // the next save over the remains of the torn one
+    WS2812FX::pattern c = make_pattern(99, 3);
+    writes = EEPROM.getWrites();
+    CHECK(store->savePattern(0, c));
+    unsigned long again = EEPROM.getWrites() - writes;
+    EEPROM.cutPowerAfter(again / 2);
+    store->savePattern(0, b);
+    store = restart(store);
+    CHECK(store->loadPattern(0, p) && (same(p, c) || same(p, b)));
+    CHECK(store->loadPattern(1, p) && same(p, make_pattern(1, 2)));
+  }
+  CHECK(olds + news == total + 1);
+  CHECK(olds > 0 && news > 0);
+  delete store;
+}
+
+int main(int argc, char** argv) {
+  char path[300];
+  snprintf(path, sizeof(path), "%s.eeprom", argv[0]);
+  remove(path);
+  EEPROM.setFile(path);
+
+  // saved and loaded after a restart
+  WS2812FXStore* store = setup(NULL, 0);
+  CHECK(store->getNumSlots() >= STORE_MAX_RECORDS + MAX_NUM_SEGMENTS + 1);
+  uint8_t config[4] = {1, 2, 3, 4}, loaded[4] = {};
+  CHECK(store->saveRecord(0, config, sizeof(config)));
+  store = restart(store);
+  CHECK(store->loadRecord(0, loaded, sizeof(loaded)) == sizeof(config) && memcmp(config, loaded, sizeof(config)) == 0);
+  for(uint8_t n=0; n < STORE_MAX_PATTERNS; n++) {
+    WS2812FX::pattern p = {};
+    CHECK(store->loadPattern(n, p) && same(p, make_pattern(n, 1 + n % MAX_NUM_SEGMENTS)));
+  }
+
+  // unchanged patterns aren't written again
+  uint32_t bytes = store->getBytesWritten();
+  for(uint8_t n=0; n < STORE_MAX_PATTERNS; n++) store->savePattern(n, make_pattern(n, 1 + n % MAX_NUM_SEGMENTS));
+  CHECK(store->getBytesWritten() == bytes);
+
+  // segments a pattern no longer uses don't come back with begin()
+  WS2812FX::pattern wide = make_pattern(20, MAX_NUM_SEGMENTS), narrow = make_pattern(21, 2);
+  CHECK(store->savePattern(2, wide));
+  store = restart(store);
+  uint8_t buf[STORE_MAX_PAYLOAD];
+  CHECK(store->loadRecord(SEGMENT_ID(2, MAX_NUM_SEGMENTS - 1), buf, sizeof(buf)) > 0);
+  CHECK(store->savePattern(2, narrow));
+  store = restart(store);
+  for(uint8_t i=2; i < MAX_NUM_SEGMENTS; i++) CHECK(store->loadRecord(SEGMENT_ID(2, i), buf, sizeof(buf)) == 0);
+  WS2812FX::pattern p = {};
+  CHECK(store->loadPattern(2, p) && same(p, narrow));
+
+  // all patterns with all segments fit into STORE_MAX_SIZE, saved over and over
+  bool ok = true;
+  for(int round=0; round < 50; round++) {
+    for(uint8_t n=0; n < STORE_MAX_PATTERNS; n++) ok = store->savePattern(n, make_pattern(round + n, MAX_NUM_SEGMENTS)) && ok;
+    for(uint8_t id=0; id < STORE_USER_RECORDS; id++) ok = store->saveRecord(id, (uint8_t*)&round, sizeof(round)) && ok;
+  }
+  CHECK(ok);
+  store = restart(store);
+  for(uint8_t n=0; n < STORE_MAX_PATTERNS; n++) CHECK(store->loadPattern(n, p) && same(p, make_pattern(49 + n, MAX_NUM_SEGMENTS)));
+  delete store;
+
+  // power loss at every write, to more, fewer and as many segments
+  WS2812FX::pattern a = make_pattern(40, 4);
+  WS2812FX::pattern more = make_pattern(41, 7), fewer = make_pattern(42, 1), as_many = make_pattern(43, 4);
+  torn_writes(a, more);
+  torn_writes(a, fewer);
+  torn_writes(a, as_many);
+
+  EEPROM.end();
+  remove(path);
+  return done("store");
+}
@@ -0,0 +1,59 @@
+/*
+  test_trigger.cpp - trigger() queues events for the next frame, renders
+  only the segments in the mask and counts the events which didn't fit.
+  On a stopped strip, only the triggered segments are rendered.
+*/
+
+#include "WS2812FX.h"
+#include "host.h"
+
+int main() {
+  WS2812FX ws2812fx(20, 5, NEO_GRB + NEO_KHZ800);
+  ws2812fx.init();
+  ws2812fx.setBrightness(255);
+  ws2812fx.setSegment(0, 0, 9, FX_MODE_RANDOM_COLOR, RED, SPEED_MAX, false);
+  ws2812fx.setSegment(1, 10, 19, FX_MODE_RANDOM_COLOR, RED, SPEED_MAX, false);
+  ws2812fx.start();
+  advance_ms(20);
+  ws2812fx.service();
+  uint32_t first = ws2812fx.getPixelColor(0), second = ws2812fx.getPixelColor(10);
+
+  // not due for a long time, only the triggered segment changes
+  advance_ms(20);
+  ws2812fx.trigger(1UL << 1);
+  ws2812fx.service();
+  CHECK(ws2812fx.getPixelColor(0) == first);
+  CHECK(ws2812fx.getPixelColor(10) != second);
+  CHECK(ws2812fx.getStats().triggers == 1);
+
+  // the queue holds TRIGGER_QUEUE_SIZE - 1 events
+  for(int i=0; i < TRIGGER_QUEUE_SIZE + 2; i++) ws2812fx.trigger();
+  CHECK(ws2812fx.getStats().triggers_dropped == 3);
+  advance_ms(20);
+  ws2812fx.service();
+  CHECK(ws2812fx.getStats().triggers == TRIGGER_QUEUE_SIZE);
+
+  ws2812fx.resetStats();
+  CHECK(ws2812fx.getStats().triggers == 0 && ws2812fx.getStats().triggers_dropped == 0);
+  ws2812fx.trigger();
+  advance_ms(20);
+  ws2812fx.service();
+  CHECK(ws2812fx.getStats().triggers == 1 && ws2812fx.getStats().triggers_dropped == 0);
+
+  // stopped, the other segment stays off even though it's long overdue
+  ws2812fx.stop();
+  advance_ms(100000);
+  ws2812fx.service();
+  CHECK(ws2812fx.getPixelColor(0) == BLACK && ws2812fx.getPixelColor(10) == BLACK);
+  unsigned long shows = Adafruit_NeoPixel::showCount;
+  ws2812fx.trigger(1UL << 1);
+  ws2812fx.service();
+  CHECK(ws2812fx.getPixelColor(0) == BLACK);
+  CHECK(ws2812fx.getPixelColor(10) != BLACK);
+  CHECK(Adafruit_NeoPixel::showCount == shows + 1);
+  advance_ms(100000);
+  ws2812fx.service();
+  CHECK(Adafruit_NeoPixel::showCount == shows + 1);
+
+  return done("trigger");
+}